@@ -0,0 +1,186 @@
+#ifndef SKINDIFF_H
+#define SKINDIFF_H
+
+// C++ API of the skindiff engine for packages with `LinkingTo: skindiff`
+// (and skindiff in Imports, so that it is loaded).
+//
+// The engine types (Parameters, System, Geometry, MatrixBuilder, TDMatrix,
+// the band solvers in algorithms.h) come in as headers. Everything that is
+// defined in the skindiff library -- constructing and running a System,
+// validation, meshing, matrix assembly -- is reached through the callables
+// registered by skindiff, wrapped below:
+//
+//     sc::Parameters p;
+//     ... fill in p ...
+//     auto sys = sc::api::makeSystem(p);          // throws on invalid p
+//     if (sc::api::run(*sys) == sc::System::Result::Executed)
+//     {
+//         const auto& sink = sys->sinkMass();      // inline accessors
+//     }
+//
+// No R objects are involved. The first call of each wrapper looks up its
+// callable with R_GetCCallable and must happen on the R main thread;
+// afterwards independent Systems may be created and run from any thread.
+// Objects are shared with the library, so consumers must be built with the
+// same compiler and C++ standard library as skindiff; checkVersion()
+// guards against a skindiff that was rebuilt with different headers.
+
+#include "skindiff/algorithms.h"
+#include "skindiff/api.h"
+
+#include <R_ext/Rdynload.h>
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sc::api
+{
+    namespace detail
+    {
+        // Via void (*)(), the generic function pointer type, to keep
+        // -Wcast-function-type quiet.
+        template <typename Fn>
+        Fn callable(const char* name)
+        {
+            using Generic = void (*)();
+            return reinterpret_cast<Fn>(
+                reinterpret_cast<Generic>(R_GetCCallable("skindiff", name)));
+        }
+
+        constexpr std::size_t kErrorSize = 512;
+    }
+
+    // API version of the installed library (SKINDIFF_API_VERSION it was
+    // built with).
+    inline int libraryVersion()
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_api_version)>(
+            "skindiff_api_version");
+        return fn();
+    }
+
+    // Throws std::runtime_error unless the library was built with these
+    // headers' API version.
+    inline void checkVersion()
+    {
+        const auto v = libraryVersion();
+        if (v != SKINDIFF_API_VERSION)
+        {
+            throw std::runtime_error("skindiff API version " + std::to_string(v) +
+                                     ", headers are version " +
+                                     std::to_string(SKINDIFF_API_VERSION));
+        }
+    }
+
+    // The validation error for `p`, if any.
+    inline std::optional<std::string> validate(const Parameters& p)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_validate)>(
+            "skindiff_validate");
+        char error[detail::kErrorSize] = {};
+        if (fn(&p, error, sizeof(error))) return std::nullopt;
+        return std::string(error);
+    }
+
+    struct SystemDeleter
+    {
+        void operator()(System* sys) const
+        {
+            static const auto fn = detail::callable<decltype(&skindiff_system_delete)>(
+                "skindiff_system_delete");
+            fn(sys);
+        }
+    };
+    using SystemPtr = std::unique_ptr<System, SystemDeleter>;
+
+    // A System for `p`; throws std::invalid_argument if `p` is invalid.
+    // `hook` (optional) is polled once per simulated minute and stops the
+    // run by returning true.
+    inline SystemPtr makeSystem(const Parameters& p, StopHook hook = nullptr,
+                                void* data = nullptr)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_system_new)>(
+            "skindiff_system_new");
+        char error[detail::kErrorSize] = {};
+        SystemPtr sys(fn(&p, hook, data, error, sizeof(error)));
+        if (!sys) throw std::invalid_argument(error);
+        return sys;
+    }
+
+    // System::run(); rethrows engine failures as std::runtime_error.
+    inline System::Result run(System& sys)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_system_run)>(
+            "skindiff_system_run");
+        char error[detail::kErrorSize] = {};
+        const auto result = fn(&sys, error, sizeof(error));
+        if (result < 0) throw std::runtime_error(error);
+        return static_cast<System::Result>(result);
+    }
+
+    // System::resume(); throws std::runtime_error if `cp` does not fit or
+    // the engine fails.
+    inline System::Result resume(System& sys, const Checkpoint& cp)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_system_resume)>(
+            "skindiff_system_resume");
+        char error[detail::kErrorSize] = {};
+        const auto result = fn(&sys, &cp, error, sizeof(error));
+        if (result < 0) throw std::runtime_error(error);
+        return static_cast<System::Result>(result);
+    }
+
+    // System::checkpoint().
+    inline std::optional<Checkpoint> checkpoint(const System& sys)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_system_checkpoint)>(
+            "skindiff_system_checkpoint");
+        Checkpoint cp;
+        if (!fn(&sys, &cp)) return std::nullopt;
+        return cp;
+    }
+
+    // System::metrics().
+    inline RunMetrics metrics(const System& sys)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_system_metrics)>(
+            "skindiff_system_metrics");
+        RunMetrics out;
+        fn(&sys, &out);
+        return out;
+    }
+
+    // chooseResolution() for p.sys.auto_resolution_tol; apply the choice to
+    // p.sys before makeSystem(). Throws std::runtime_error on failure.
+    inline ResolutionChoice chooseResolution(const Parameters& p)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_choose_resolution)>(
+            "skindiff_choose_resolution");
+        char error[detail::kErrorSize] = {};
+        ResolutionChoice out;
+        if (!fn(&p, &out, error, sizeof(error))) throw std::runtime_error(error);
+        return out;
+    }
+
+    // Geometry::create() and MatrixBuilder::buildMatrix().
+    inline bool createGeometry(Geometry& geometry, std::vector<Compartment>& compartments,
+                               int ss_per_um, Sink* sink = nullptr)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_geometry_create)>(
+            "skindiff_geometry_create");
+        return fn(&geometry, &compartments, ss_per_um, sink);
+    }
+
+    inline bool buildMatrix(MatrixBuilder& builder, const std::vector<Compartment>& compartments,
+                            const Geometry& geometry, Sink* sink = nullptr)
+    {
+        static const auto fn = detail::callable<decltype(&skindiff_build_matrix)>(
+            "skindiff_build_matrix");
+        return fn(&builder, &compartments, &geometry, sink);
+    }
+}
+
+#endif  // SKINDIFF_H
@@ -0,0 +1,345 @@
+#ifndef SC_ALGORITHMS_H
+#define SC_ALGORITHMS_H
+
+#include "tdmatrix.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace sc::algorithm
+{
+    // Solve M*x = rhs for a tri-diagonal M using the Thomas algorithm.
+    // The matrix is not modified. The solution overwrites rhs.
+    inline void thomasIP(const TDMatrix& matrix, std::vector<double>& rhs)
+    {
+        const auto size = matrix.size();
+        assert(size > 0);
+        assert(static_cast<std::size_t>(size) == rhs.size());
+
+        auto c_star = matrix.fullUpper();
+
+        c_star[0] = c_star[0] / matrix.diag(0);
+        for (int i = 1; i < size - 1; ++i)
+        {
+            c_star[i] = c_star[i] / (matrix.diag(i) - c_star[i - 1] * matrix.lower(i - 1));
+        }
+
+        rhs[0] = rhs[0] / matrix.diag(0);
+        for (int i = 1; i < size; ++i)
+        {
+            rhs[i] = (rhs[i] - rhs[i - 1] * matrix.lower(i - 1)) /
+                     (matrix.diag(i) - c_star[i - 1] * matrix.lower(i - 1));
+        }
+
+        for (int i = size - 2; i >= 0; --i)
+        {
+            rhs[i] = rhs[i] - c_star[i] * rhs[i + 1];
+        }
+    }
+
+    // Factor M in place into the prepared form used by thomasReUseIP and
+    // crankNicolsonStepIP. No-op if M is already prepared. Call this up front
+    // when a matrix is shared read-only between threads, since the solvers
+    // otherwise factor lazily on first use.
+    //
+    // Storage convention after preparation:
+    //   m_diag[i]  holds 1 / d_prepared[i]  (reciprocal -- so the forward sweep
+    //                                        is multiply-only, no divides)
+    //   m_upper[i] holds c_star[i]
+    //   m_lower[i] holds the original sub-diagonal (unchanged)
+    inline void prepareThomas(TDMatrix& matrix)
+    {
+        if (matrix.isPrepared()) return;
+        assert(!matrix.isPreparedUL());
+
+        const auto size = matrix.size();
+        assert(size > 0);
+
+        auto& c_star  = matrix.fullUpper();
+        auto& c_diag  = matrix.fullDiag();
+        auto& c_lower = matrix.fullLower();
+
+        // Fuse the c_star and c_diag updates into one pass, then invert
+        // c_diag so the per-step solve uses multiplies only.
+        if (size > 1)
+        {
+            c_star[0] = c_star[0] / c_diag[0];
+            for (int i = 1; i < size - 1; ++i)
+            {
+                c_diag[i] = c_diag[i] - c_star[i - 1] * c_lower[i - 1];
+                c_star[i] = c_star[i] / c_diag[i];
+            }
+            c_diag[size - 1] = c_diag[size - 1] - c_star[size - 2] * c_lower[size - 2];
+        }
+        for (int i = 0; i < size; ++i) c_diag[i] = 1.0 / c_diag[i];
+        matrix.setPrepared(true);
+    }
+
+    // Mirror image of prepareThomas: factor M = U L bottom-up, so that
+    // elimination runs from the last row to the first and the
+    // back-substitution from the first row to the last. Storage convention
+    // after preparation:
+    //   m_diag[i]  holds 1 / e[i]           (e: the bottom-up pivots)
+    //   m_lower[i] holds g[i] = l[i] / e[i + 1]
+    //   m_upper[i] holds the original super-diagonal (unchanged)
+    inline void prepareThomasUL(TDMatrix& matrix)
+    {
+        if (matrix.isPreparedUL()) return;
+        assert(!matrix.isPrepared());
+
+        const auto size = matrix.size();
+        assert(size > 0);
+
+        auto&       e = matrix.fullDiag();
+        auto&       g = matrix.fullLower();
+        const auto& u = matrix.fullUpper();
+        for (int i = size - 2; i >= 0; --i)
+        {
+            g[i] = g[i] / e[i + 1];
+            e[i] = e[i] - u[i] * g[i];
+        }
+        for (int i = 0; i < size; ++i) e[i] = 1.0 / e[i];
+        matrix.setPreparedUL(true);
+    }
+
+    // Solve M*x = rhs reusing the LU factorization stored in an already
+    // prepared M (see prepareThomas). M is not touched, so several threads
+    // may solve with the same matrix.
+    inline void thomasReUseIP(const TDMatrix& matrix, std::vector<double>& rhs)
+    {
+        const auto size = matrix.size();
+        assert(size > 0);
+        assert(static_cast<std::size_t>(size) == rhs.size());
+        assert(matrix.isPrepared());
+
+        const auto& c_star  = matrix.fullUpper();
+        const auto& c_diag  = matrix.fullDiag();
+        const auto& c_lower = matrix.fullLower();
+
+        rhs[0] = rhs[0] * c_diag[0];
+        for (int i = 1; i < size; ++i)
+        {
+            rhs[i] = (rhs[i] - rhs[i - 1] * c_lower[i - 1]) * c_diag[i];
+        }
+
+        for (int i = size - 2; i >= 0; --i)
+        {
+            rhs[i] = rhs[i] - c_star[i] * rhs[i + 1];
+        }
+    }
+
+    // Solve M*x = rhs reusing the LU factorization stored in M.
+    // First call mutates M into the prepared form (see prepareThomas);
+    // subsequent calls with the same M skip the factorization and reuse it.
+    inline void thomasReUseIP(TDMatrix& matrix, std::vector<double>& rhs)
+    {
+        prepareThomas(matrix);
+        thomasReUseIP(static_cast<const TDMatrix&>(matrix), rhs);
+    }
+
+    // Fused Crank-Nicolson sub-step:  vec <- lhs^{-1} * rhs * vec
+    // Equivalent to inlineMultiply(rhs, vec) followed by thomasReUseIP(lhs, vec),
+    // but does one pass instead of two: the multiplied value stays in a register
+    // and never round-trips through the cache between the multiply and the
+    // forward solve. The backward sweep is unchanged (it can't fuse because it
+    // depends on the fully-forwarded vector).
+    //
+    // Only rows [from, to] are stepped (the active window). Exact if every
+    // row above `from` is an identity row of both matrices (a clamped
+    // donor); rows below `to` are left as they are, which is accurate as
+    // long as the state there is still at its trivial value.
+    //
+    // This overload takes an already-prepared lhs (see prepareThomas) and
+    // touches neither matrix, so several threads may step independent
+    // vectors with the same pair.
+    inline void crankNicolsonStepIP(const TDMatrix& rhs_mat, const TDMatrix& lhs,
+                                    std::vector<double>& vec, int from, int to)
+    {
+        const auto size = lhs.size();
+        assert(size > 1);
+        assert(static_cast<std::size_t>(size) == vec.size());
+        assert(rhs_mat.size() == size);
+        assert(lhs.isPrepared());
+        assert(0 <= from && from <= to && to < size);
+
+        const auto& c_star  = lhs.fullUpper();
+        const auto& c_diag  = lhs.fullDiag();
+        const auto& c_lower = lhs.fullLower();
+
+        const auto& m_diag  = rhs_mat.fullDiag();
+        const auto& m_upper = rhs_mat.fullUpper();
+        const auto& m_lower = rhs_mat.fullLower();
+
+        // First row: M*vec uses lower only below the top cell; the cell
+        // above an inner window is an identity row, so its old, forwarded
+        // and final values coincide.
+        double tmp_prev = vec[from];              // old vec[i-1] for the M*vec recurrence
+        {
+            double mul = m_diag[from] * vec[from];
+            double fwd = 0.0;
+            if (from > 0)
+            {
+                mul += m_lower[from - 1] * vec[from - 1];
+                fwd  = vec[from - 1] * c_lower[from - 1];
+            }
+            if (from < size - 1) mul += m_upper[from] * vec[from + 1];
+            vec[from] = (mul - fwd) * c_diag[from];
+        }
+
+        // Interior: compute M*vec at index i and apply the forward solve in
+        // the same step. tmp_prev carries the unmodified vec[i-1] forward
+        // through the M*vec recurrence (same trick as inlineMultiply).
+        const auto last_inner = std::min(to, size - 2);
+        for (int i = from + 1; i <= last_inner; ++i)
+        {
+            const double old_vec_i = vec[i];
+            const double mul_i = m_lower[i - 1] * tmp_prev
+                               + m_diag[i]      * old_vec_i
+                               + m_upper[i]     * vec[i + 1];
+            vec[i] = (mul_i - vec[i - 1] * c_lower[i - 1]) * c_diag[i];
+            tmp_prev = old_vec_i;
+        }
+
+        // Last cell: M*vec uses only lower and diag.
+        if (to == size - 1 && to > from)
+        {
+            const auto idx = size - 1;
+            const double mul_last = m_lower[idx - 1] * tmp_prev + m_diag[idx] * vec[idx];
+            vec[idx] = (mul_last - vec[idx - 1] * c_lower[idx - 1]) * c_diag[idx];
+        }
+
+        // Backward sweep: unchanged.
+        for (int i = to - 1; i >= from; --i)
+        {
+            vec[i] = vec[i] - c_star[i] * vec[i + 1];
+        }
+    }
+
+    // Full-range sub-step.
+    inline void crankNicolsonStepIP(const TDMatrix& rhs_mat, const TDMatrix& lhs,
+                                    std::vector<double>& vec)
+    {
+        crankNicolsonStepIP(rhs_mat, lhs, vec, 0, lhs.size() - 1);
+    }
+
+    // As above; lhs is mutated into the prepared form on first call.
+    // rhs is read-only.
+    inline void crankNicolsonStepIP(const TDMatrix& rhs_mat, TDMatrix& lhs,
+                                    std::vector<double>& vec)
+    {
+        prepareThomas(lhs);
+        crankNicolsonStepIP(rhs_mat, static_cast<const TDMatrix&>(lhs), vec);
+    }
+
+    // n_steps Crank-Nicolson sub-steps, vec <- (lhs^{-1} * rhs)^n_steps * vec,
+    // alternating an LU-prepared (see prepareThomas) and a UL-prepared (see
+    // prepareThomasUL) copy of the same lhs. An LU step ends with a downward
+    // back-substitution and the following UL step starts with a downward
+    // elimination; the two fuse into a single pass, as do the upward UL
+    // back-substitution and the next LU elimination. n sub-steps thus take
+    // n + 1 passes over the vector instead of 2 n, which about halves the
+    // memory traffic once the vector no longer fits in cache. Both matrices
+    // are only read, so several threads may share them.
+    inline void crankNicolsonStepsIP(const TDMatrix& rhs_mat, const TDMatrix& lu,
+                                     const TDMatrix& ul, std::vector<double>& vec, int n_steps)
+    {
+        const auto size = lu.size();
+        assert(size > 1);
+        assert(static_cast<std::size_t>(size) == vec.size());
+        assert(rhs_mat.size() == size && ul.size() == size);
+        assert(lu.isPrepared() && ul.isPreparedUL());
+        if (n_steps <= 0) return;
+
+        const auto last = size - 1;
+
+        const auto& c_star  = lu.fullUpper();
+        const auto& c_diag  = lu.fullDiag();
+        const auto& c_lower = lu.fullLower();
+
+        const auto& e_inv = ul.fullDiag();
+        const auto& g     = ul.fullLower();
+        const auto& u     = ul.fullUpper();
+
+        const auto& m_diag  = rhs_mat.fullDiag();
+        const auto& m_upper = rhs_mat.fullUpper();
+        const auto& m_lower = rhs_mat.fullLower();
+
+        // Upward: M * vec and the LU elimination of the first step.
+        {
+            double tmp_prev = vec[0];
+            vec[0] = (m_diag[0] * vec[0] + m_upper[0] * vec[1]) * c_diag[0];
+            for (int i = 1; i < last; ++i)
+            {
+                const double old_vec_i = vec[i];
+                const double mul_i = m_lower[i - 1] * tmp_prev
+                                   + m_diag[i]      * old_vec_i
+                                   + m_upper[i]     * vec[i + 1];
+                vec[i] = (mul_i - vec[i - 1] * c_lower[i - 1]) * c_diag[i];
+                tmp_prev = old_vec_i;
+            }
+            const double mul_last = m_lower[last - 1] * tmp_prev + m_diag[last] * vec[last];
+            vec[last] = (mul_last - vec[last - 1] * c_lower[last - 1]) * c_diag[last];
+        }
+
+        for (int k = 1; k <= n_steps; ++k)
+        {
+            const bool lu_step = (k % 2) == 1;
+            if (k == n_steps)
+            {
+                // Final back-substitution.
+                if (lu_step)
+                {
+                    for (int i = last - 1; i >= 0; --i) vec[i] = vec[i] - c_star[i] * vec[i + 1];
+                }
+                else
+                {
+                    for (int i = 1; i <= last; ++i) vec[i] = vec[i] - g[i - 1] * vec[i - 1];
+                }
+                break;
+            }
+
+            if (lu_step)
+            {
+                // Downward: LU back-substitution of step k gives x_i; with
+                // x_{i+2}, x_{i+1}, x_i final, row i + 1 of M * x and its UL
+                // elimination for step k + 1 follow.
+                double x_hi  = vec[last];
+                double x_mid = vec[last - 1] - c_star[last - 1] * x_hi;
+                vec[last] = (m_lower[last - 1] * x_mid + m_diag[last] * x_hi) * e_inv[last];
+                for (int i = last - 2; i >= 0; --i)
+                {
+                    const double x_i = vec[i] - c_star[i] * x_mid;
+                    const int    j   = i + 1;
+                    const double mul = m_lower[i] * x_i + m_diag[j] * x_mid + m_upper[j] * x_hi;
+                    vec[j] = (mul - u[j] * vec[j + 1]) * e_inv[j];
+                    x_hi  = x_mid;
+                    x_mid = x_i;
+                }
+                vec[0] = (m_diag[0] * x_mid + m_upper[0] * x_hi - u[0] * vec[1]) * e_inv[0];
+            }
+            else
+            {
+                // Upward: the mirror image, UL back-substitution of step k
+                // fused with M * x and the LU elimination of step k + 1.
+                double x_lo  = vec[0];
+                double x_mid = vec[1] - g[0] * x_lo;
+                vec[0] = (m_diag[0] * x_lo + m_upper[0] * x_mid) * c_diag[0];
+                for (int i = 2; i <= last; ++i)
+                {
+                    const double x_i = vec[i] - g[i - 1] * x_mid;
+                    const int    j   = i - 1;
+                    const double mul = m_lower[j - 1] * x_lo + m_diag[j] * x_mid + m_upper[j] * x_i;
+                    vec[j] = (mul - vec[j - 1] * c_lower[j - 1]) * c_diag[j];
+                    x_lo  = x_mid;
+                    x_mid = x_i;
+                }
+                vec[last] = (m_lower[last - 1] * x_lo + m_diag[last] * x_mid -
+                             vec[last - 1] * c_lower[last - 1]) * c_diag[last];
+            }
+        }
+    }
+}
+
+#endif  // SC_ALGORITHMS_H
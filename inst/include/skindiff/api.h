@@ -0,0 +1,73 @@
+#ifndef SC_API_H
+#define SC_API_H
+
+#include "autoresolution.h"
+#include "compartment.h"
+#include "geometry.h"
+#include "matrixbuilder.h"
+#include "metrics.h"
+#include "parameter.h"
+#include "sink.h"
+#include "system.h"
+
+#include <cstddef>
+#include <vector>
+
+// Version of the C-callable API below and of the layout of the types in
+// these headers. Callers compile the headers themselves and hand objects
+// to the installed library, so it is bumped whenever a callable's
+// signature or any public type changes.
+#define SKINDIFF_API_VERSION 7
+
+namespace sc::api
+{
+    // Polled once per simulated minute; returning true stops the run
+    // (System::Result::Stopped).
+    using StopHook = bool (*)(int t, void* data);
+}
+
+// Entry points registered with R_RegisterCCallable("skindiff", <name>, ...).
+// They are defined in the package library, so code outside it reaches them
+// through R_GetCCallable (see <skindiff.h>), never by linking. None throws:
+// failures come back through the return value, with a message copied into
+// `error` (`error_size` bytes, always NUL-terminated) where there is one.
+extern "C"
+{
+    int skindiff_api_version();
+
+    // true if `p` is valid; the error otherwise.
+    bool skindiff_validate(const sc::Parameters* p, char* error, std::size_t error_size);
+
+    // A ready-to-run System for valid `p`, or nullptr. `hook` may be null.
+    // Release with skindiff_system_delete.
+    sc::System* skindiff_system_new(const sc::Parameters* p, sc::api::StopHook hook,
+                                    void* data, char* error, std::size_t error_size);
+    void skindiff_system_delete(sc::System* sys);
+
+    // System::run() as an int (System::Result), -1 if it threw.
+    int skindiff_system_run(sc::System* sys, char* error, std::size_t error_size);
+
+    // System::resume() as an int like skindiff_system_run; -1 also if
+    // `cp` does not fit (System::resumeError).
+    int skindiff_system_resume(sc::System* sys, const sc::Checkpoint* cp, char* error,
+                               std::size_t error_size);
+    // System::checkpoint() into `out`; false if there is none.
+    bool skindiff_system_checkpoint(const sc::System* sys, sc::Checkpoint* out);
+    // System::metrics() into `out`.
+    void skindiff_system_metrics(const sc::System* sys, sc::RunMetrics* out);
+
+    // chooseResolution() with plain probe Systems; false if `p` is invalid,
+    // has no sys.auto_resolution_tol or a probe run failed.
+    bool skindiff_choose_resolution(const sc::Parameters* p, sc::ResolutionChoice* out,
+                                    char* error, std::size_t error_size);
+
+    // Geometry::create() and MatrixBuilder::buildMatrix().
+    bool skindiff_geometry_create(sc::Geometry* geometry,
+                                  std::vector<sc::Compartment>* compartments, int ss_per_um,
+                                  sc::Sink* sink);
+    bool skindiff_build_matrix(sc::MatrixBuilder* builder,
+                               const std::vector<sc::Compartment>* compartments,
+                               const sc::Geometry* geometry, sc::Sink* sink);
+}
+
+#endif  // SC_API_H
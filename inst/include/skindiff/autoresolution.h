@@ -0,0 +1,43 @@
+#ifndef SC_AUTORESOLUTION_H
+#define SC_AUTORESOLUTION_H
+
+#include "parameter.h"
+#include "system.h"
+
+#include <functional>
+#include <memory>
+
+namespace sc
+{
+    // Mesh settings picked by chooseResolution() and the relative errors
+    // predicted for them.
+    struct ResolutionChoice
+    {
+        int    resolution = 1;
+        double max_module = 50.0;
+        double sink_error = 0.0;   // final sink mass, relative to itself
+        double cdp_error  = 0.0;   // final profile, max-norm relative to its peak
+    };
+
+    // Creates the System for a probe run, e.g. one that forwards interrupts.
+    using SystemFactory = std::function<std::unique_ptr<System>(Parameters)>;
+
+    // Picks `resolution` and `max_module` for p.sys.auto_resolution_tol.
+    //
+    // Three probe runs (plain Systems unless `make` is given) estimate the
+    // error of the final sink mass and concentration profile by Richardson
+    // extrapolation:
+    //   A  at p.sys.resolution with the sub-steps p.sys.max_module gives,
+    //   B  at twice the resolution with the sub-steps of A,
+    //   C  at the resolution of A with twice its sub-steps.
+    // A - B is then the spatial error of A (order 2, or 4 for the compact
+    // scheme), A - C its time error (order 2). The choice is the pair with
+    // the fewest cells x sub-steps per minute whose modelled error meets
+    // the tolerance; resolutions are capped at 64 times the starting one,
+    // beyond which the prediction may exceed the tolerance.
+    //
+    // Throws std::runtime_error if a probe run fails or is stopped.
+    ResolutionChoice chooseResolution(const Parameters& p, const SystemFactory& make = {});
+}
+
+#endif  // SC_AUTORESOLUTION_H
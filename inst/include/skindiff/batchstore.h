@@ -0,0 +1,147 @@
+#ifndef SC_BATCHSTORE_H
+#define SC_BATCHSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // Column of a batch file: one integer or double per scenario, or a
+    // series of doubles of any length.
+    struct BatchColumn
+    {
+        enum class Kind : std::uint8_t
+        {
+            Int    = 0,
+            Double = 1,
+            Series = 2
+        };
+
+        std::string name;
+        Kind        kind = Kind::Double;
+    };
+
+    // One scenario's values, per kind in the order of the columns of that
+    // kind.
+    struct BatchRow
+    {
+        std::vector<std::int64_t>        ints;
+        std::vector<double>              doubles;
+        std::vector<std::vector<double>> series;
+    };
+
+    // Writes scenarios to a chunked columnar file as they come in. Rows
+    // are buffered column by column until a chunk is full, then written
+    // with a directory of where each column starts, so memory does not
+    // grow with the number of scenarios. close() (or the destructor)
+    // writes the final partial chunk and the chunk index the file is read
+    // back through; a file that was never closed cannot be read.
+    //
+    // Layout (native byte order): header with the column names and kinds,
+    // the chunks, and an index of (offset, rows) per chunk whose position
+    // the header records. Within a chunk an Int column holds int64s, a
+    // Double column doubles, a Series column rows + 1 element offsets and
+    // then the concatenated values.
+    class BatchWriter
+    {
+      public:
+        // Creates (truncates) `path`. Throws std::runtime_error if it
+        // cannot be written.
+        BatchWriter(const std::string& path, std::vector<BatchColumn> columns,
+                    std::size_t chunk_rows);
+        ~BatchWriter();
+
+        BatchWriter(const BatchWriter&)            = delete;
+        BatchWriter& operator=(const BatchWriter&) = delete;
+
+        // Throws std::invalid_argument if `row` does not match the columns
+        // and std::runtime_error if a write fails. Not thread-safe.
+        void add(const BatchRow& row);
+        void close();
+
+        [[nodiscard]] const std::vector<BatchColumn>& columns() const noexcept
+        {
+            return m_columns;
+        }
+        [[nodiscard]] std::size_t rows() const noexcept { return m_rows; }
+
+      private:
+        void flushChunk();
+
+        std::string              m_path;
+        std::ofstream            m_out;
+        std::vector<BatchColumn> m_columns;
+        std::size_t              m_chunk_rows = 1;
+        std::size_t              m_n_int = 0, m_n_double = 0, m_n_series = 0;
+        std::size_t              m_rows  = 0;
+
+        // The pending chunk, column by column.
+        std::size_t                              m_pending = 0;
+        std::vector<std::vector<std::int64_t>>   m_ints;
+        std::vector<std::vector<double>>         m_doubles;
+        std::vector<std::vector<std::uint64_t>>  m_series_offsets;
+        std::vector<std::vector<double>>         m_series_values;
+
+        // Index of the chunks written: file offset and row count.
+        std::vector<std::uint64_t> m_index_offsets;
+        std::vector<std::uint64_t> m_index_rows;
+    };
+
+    // Reads columns of a closed batch file for any subset of its rows
+    // (numbered in file order), touching only the chunks that hold them.
+    class BatchReader
+    {
+      public:
+        // nullptr if `path` is not a complete batch file.
+        [[nodiscard]] static std::unique_ptr<BatchReader> open(const std::string& path);
+
+        [[nodiscard]] const std::vector<BatchColumn>& columns() const noexcept
+        {
+            return m_columns;
+        }
+        // Index of the column `name`, -1 if there is none.
+        [[nodiscard]] int find(const std::string& name) const noexcept;
+        [[nodiscard]] std::size_t rows() const noexcept { return m_rows; }
+
+        // Values of column `col` (of the matching kind) at `rows`, in that
+        // order. Throw std::out_of_range for a row or column out of range
+        // or of another kind, std::runtime_error if the file is damaged.
+        [[nodiscard]] std::vector<std::int64_t> ints(std::size_t col,
+                                                     const std::vector<std::size_t>& rows);
+        [[nodiscard]] std::vector<double> doubles(std::size_t col,
+                                                  const std::vector<std::size_t>& rows);
+        [[nodiscard]] std::vector<std::vector<double>> series(
+            std::size_t col, const std::vector<std::size_t>& rows);
+
+      private:
+        BatchReader() = default;
+
+        struct Chunk
+        {
+            std::uint64_t offset = 0;
+            std::uint64_t rows   = 0;
+            std::uint64_t first  = 0;   // file row of its first entry
+        };
+
+        // Calls fun(chunk, local rows, positions in `rows`) once per chunk
+        // holding any of `rows`.
+        template <typename Fun>
+        void byChunk(std::size_t col, BatchColumn::Kind kind,
+                     const std::vector<std::size_t>& rows, Fun&& fun);
+        // Start of column `col` in chunk `c`.
+        std::uint64_t columnAt(const Chunk& c, std::size_t col);
+        void read(std::uint64_t at, void* dst, std::size_t bytes);
+
+        std::ifstream            m_in;
+        std::uint64_t            m_size = 0;
+        std::vector<BatchColumn> m_columns;
+        std::vector<Chunk>       m_chunks;
+        std::size_t              m_rows = 0;
+    };
+}
+
+#endif  // SC_BATCHSTORE_H
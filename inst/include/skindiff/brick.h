@@ -0,0 +1,127 @@
+#ifndef SC_BRICK_H
+#define SC_BRICK_H
+
+#include "compartment.h"
+#include "geometry.h"
+#include "parameter.h"
+#include "sink.h"
+#include "tdmatrix.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace sc
+{
+    // Two-dimensional brick-and-mortar model of one layer, coupled to the
+    // 1-D stack above and below it.
+    //
+    // The layer is a staggered wall of bricks (corneocytes) in a lipid
+    // mortar. By symmetry it is enough to mesh half a period laterally,
+    // from the centre of one brick to the centre of the vertical gap next
+    // to it, with reflecting sides. The mesh is a tensor grid of rows
+    // (depth) and columns (lateral); every cell is brick or lipid. The
+    // unknown is the activity u = c/K, as in the 1-D stack, so the face
+    // conductances are harmonic means of K * D in both directions.
+    //
+    // Time stepping is Peaceman-Rachford ADI with half-steps tau = dt / 2:
+    //
+    //   (W - tau Lx) s*      = (W + tau Ly) s^n
+    //   (W - tau Ly) s^{n+1} = (W + tau Lx) s*
+    //
+    // Lx holds the lateral couplings (2-D cells only), Ly the vertical
+    // ones, the 1-D stack and the faces between the two. Each half-step is
+    // a set of independent tri-diagonal line solves, run in parallel. The
+    // vertical sweep couples every column to the 1-D cell just above (v)
+    // and just below (d) the layer; the columns are solved for the two
+    // unknown boundary values, which are then eliminated into a single
+    // tri-diagonal system over the 1-D cells in which v and d are
+    // neighbours. All matrices are constant and prepared once.
+    class BrickLayer
+    {
+      public:
+        BrickLayer() = default;
+
+        // `layer` indexes `compartments` (the donor is 0); `op` is the
+        // per-minute 1-D operator of the whole stack and `n_ts` its
+        // sub-step count (MatrixBuilder). Returns false if the structure
+        // does not fit the layer.
+        bool build(const BrickParams& brick, const std::vector<Compartment>& compartments,
+                   std::size_t layer, const Geometry& geometry, const Sink& sink,
+                   const TDMatrix& op, int n_ts, double max_module, int n_threads);
+
+        // Sets the 2-D field from the layer's cells in the 1-D state:
+        // bricks start in partition equilibrium with the mortar around them.
+        void init(const std::vector<double>& state);
+
+        // One minute of ADI steps. Updates the 1-D cells outside the layer
+        // and the 2-D field; the layer's own 1-D cells are left alone.
+        void advanceMinute(std::vector<double>& state);
+
+        // Writes the laterally averaged 2-D concentration into the layer's
+        // 1-D cells (as u = c / K_layer), conserving mass, so the 1-D
+        // mass and CDP logging applies unchanged.
+        void project(std::vector<double>& state) const;
+
+        [[nodiscard]] int rows()     const noexcept { return m_ny; }
+        [[nodiscard]] int cols()     const noexcept { return m_nx; }
+        [[nodiscard]] int subSteps() const noexcept { return m_n_sub; }
+        // Cell centres (um): lateral from the brick centre, depth from the
+        // top of the layer.
+        [[nodiscard]] const std::vector<double>& lateral() const noexcept { return m_x; }
+        [[nodiscard]] const std::vector<double>& depth()   const noexcept { return m_y; }
+        // Concentration c = K u (mg/um^3), row-major rows() x cols().
+        [[nodiscard]] std::vector<double> concentrations() const;
+
+      private:
+        [[nodiscard]] std::size_t at(int i, int j) const noexcept
+        {
+            return static_cast<std::size_t>(i) * static_cast<std::size_t>(m_nx) +
+                   static_cast<std::size_t>(j);
+        }
+        // Position of 1-D cell i in the compact system (layer cells removed).
+        [[nodiscard]] int compact(int i) const noexcept { return i <= m_v ? i : i - m_gap; }
+
+        // Returns K * D per 2-D cell.
+        std::vector<double> buildMesh(const BrickParams& brick, const Compartment& comp);
+        void buildCoupling(const std::vector<Compartment>& compartments, std::size_t layer,
+                           const Geometry& geometry, const Sink& sink, const TDMatrix& op,
+                           const std::vector<double>& kd);
+        void buildStepMatrices(int n_ts, double max_module);
+        void step(std::vector<double>& state);
+
+        int m_nx = 0, m_ny = 0;
+        int m_n_sub   = 1;
+        int m_workers = 1;
+        double m_tau  = 0.5;
+
+        std::vector<double> m_x, m_y;          // cell centres
+        std::vector<double> m_dy;              // row heights
+        std::vector<double> m_f;               // column width / half period
+        std::vector<double> m_K;               // per 2-D cell
+        std::vector<double> m_w;               // capacities K * A * f_j * dy_i
+        std::vector<double> m_gx;              // lateral faces, ny x (nx - 1)
+        std::vector<double> m_gy;              // vertical faces, (ny - 1) x nx
+        std::vector<double> m_a_top, m_a_bot;  // faces to cells v / d, per column
+        std::vector<double> m_s;               // activity field
+        std::vector<double> m_s_star;          // half-step field
+
+        // 1-D side. The layer occupies cells [m_from, m_to]; v = m_from - 1
+        // and d = m_to + 1 (possibly the sink).
+        int    m_from = 0, m_to = 0, m_v = 0, m_d = 0, m_gap = 0;
+        bool   m_top_clamped = false;
+        bool   m_sink_below  = false;
+        double m_w_v = 1.0, m_w_d = 1.0;
+        double m_K_layer = 1.0;
+        std::vector<double> m_edges;           // layer's 1-D cell edges (um)
+        TDMatrix            m_op;              // 1-D operator, layer cut out
+
+        // Prepared line matrices and the column responses to unit values
+        // of u_v / u_d, column-major (nx x ny).
+        std::vector<TDMatrix> m_row_mat, m_col_mat;
+        std::vector<double>   m_z_top, m_z_bot;
+        TDMatrix              m_compact;
+        std::vector<double>   m_rhs;
+    };
+}
+
+#endif  // SC_BRICK_H
@@ -0,0 +1,84 @@
+#ifndef SC_CDPSTORE_H
+#define SC_CDPSTORE_H
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // Concentration-depth profiles of one series in a file instead of in
+    // memory (LogParams::cdp_dir). The file starts with a header holding
+    // the depth grid and a time index with room for `capacity` entries;
+    // the profiles follow back to back, so the data are the column-major
+    // [depth, time] matrix. The profile count in the header is only
+    // written by sync() and on destruction, so a CdpMapping of the file
+    // sees the profiles appended up to the last of those.
+    class CdpStore
+    {
+      public:
+        // Creates (truncates) `path`. Throws std::runtime_error if it
+        // cannot be written.
+        CdpStore(std::string path, const std::vector<double>& depths_um, std::size_t capacity);
+        // Syncs, ignoring a failure.
+        ~CdpStore();
+
+        CdpStore(const CdpStore&)            = delete;
+        CdpStore& operator=(const CdpStore&) = delete;
+
+        // Throws std::runtime_error if the write fails or the time index
+        // is full.
+        void append(double t, const std::vector<double>& profile);
+        // Writes the profile count and flushes the file. Throws
+        // std::runtime_error if that fails.
+        void sync();
+        // Profile k (< size()) read back from the file.
+        [[nodiscard]] std::vector<double> read(std::size_t k);
+
+        [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+        [[nodiscard]] const std::string& path() const noexcept { return m_path; }
+
+      private:
+        std::string  m_path;
+        std::fstream m_file;
+        std::size_t  m_depths   = 0;
+        std::size_t  m_capacity = 0;
+        std::size_t  m_size     = 0;
+    };
+
+    // A store file mapped copy-on-write: writes through data() stay
+    // private to the mapping, and the pages are read from the file as they
+    // are touched, so the profiles never have to fit into memory at once.
+    class CdpMapping
+    {
+      public:
+        // nullptr if `path` cannot be mapped or is not a store file.
+        [[nodiscard]] static std::unique_ptr<CdpMapping> open(const std::string& path);
+        ~CdpMapping();
+
+        CdpMapping(const CdpMapping&)            = delete;
+        CdpMapping& operator=(const CdpMapping&) = delete;
+
+        [[nodiscard]] std::size_t depths() const noexcept { return m_depths; }
+        [[nodiscard]] std::size_t times() const noexcept { return m_times; }
+        [[nodiscard]] const double* depth() const noexcept { return m_depth; }
+        [[nodiscard]] const double* time() const noexcept { return m_time; }
+        // depths() x times() values, column-major [depth, time].
+        [[nodiscard]] double* data() const noexcept { return m_data; }
+
+      private:
+        CdpMapping() = default;
+
+        void*       m_base   = nullptr;
+        std::size_t m_bytes  = 0;
+        std::size_t m_depths = 0;
+        std::size_t m_times  = 0;
+        double*     m_depth  = nullptr;
+        double*     m_time   = nullptr;
+        double*     m_data   = nullptr;
+    };
+}
+
+#endif  // SC_CDPSTORE_H
@@ -0,0 +1,46 @@
+#ifndef SC_CHECKPOINT_H
+#define SC_CHECKPOINT_H
+
+#include "logger.h"
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // State of a System at the end of a run, from which a System over the
+    // same stack continues (System::resume). Several Systems may resume
+    // from one checkpoint, so a shared prefix is computed once.
+    struct Checkpoint
+    {
+        int  t               = 0;      // min
+        bool vehicle_removed = false;
+        // Activity u over the mesh at t (sink and PK cells included) and
+        // the space steps of that mesh, which a resuming System must match.
+        std::vector<double> state;
+        std::vector<double> space_steps;
+        // Logged series up to t, indexed like System::compartmentMass() /
+        // cdp(), with the names they belong to.
+        std::vector<std::string> names;
+        std::vector<MassSeries>  mass;
+        std::vector<CdpSeries>   cdp;
+        MassSeries               sink_mass;
+        MassSeries               plasma;
+        // Stop-condition references (initial donor and sink mass, mg) and
+        // the steady-state detector's firing time, -1 if it has not fired.
+        double donor_mg0       = 0.0;
+        double sink_mg0        = 0.0;
+        int    steady_state_at = -1;
+    };
+
+    // Binary form: a tagged, versioned stream in native byte order, for
+    // reading back on the same kind of machine. readCheckpoint returns
+    // nullopt for anything that is not a complete checkpoint of this
+    // version.
+    void writeCheckpoint(std::ostream& out, const Checkpoint& cp);
+    [[nodiscard]] std::optional<Checkpoint> readCheckpoint(std::istream& in);
+}
+
+#endif  // SC_CHECKPOINT_H
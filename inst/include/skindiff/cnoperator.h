@@ -0,0 +1,105 @@
+#ifndef SC_CNOPERATOR_H
+#define SC_CNOPERATOR_H
+
+#include "tdmatrix.h"
+
+#include <vector>
+
+namespace sc
+{
+    // Prepared Crank-Nicolson sub-step operator, vec <- lhs^{-1} rhs vec,
+    // packed for streaming.
+    //
+    // A CN pair (rhs, lhs) as built by MatrixBuilder is six bands, which
+    // the band kernels in algorithms.h read as six separate streams. The
+    // pair is redundant: with rhs = 2 + dt A and lhs = 2 - dt A its
+    // off-diagonals are each other's negatives (the clamped and sink rows
+    // keep the relation), so the lhs lower band is the negated rhs one and
+    // need not be stored. The upward pass of a sub-step (rhs product and
+    // LU elimination) reads one interleaved, aligned array holding each
+    // row's rhs coefficients and reciprocal pivot; the downward pass
+    // (back-substitution) reads c_star alone, so neither pass pulls in
+    // bytes it does not use.
+    //
+    // Optionally the UL pivots (see algorithm::prepareThomasUL) are kept
+    // as well, for fused multi-sub-step sweeps (steps()); their
+    // elimination coefficients follow from the rhs lower band likewise.
+    //
+    // The compact scheme's mass matrix breaks the relation (lhs = 2 M -
+    // dt A, rhs = 2 M + dt A); the elimination coefficients -lhs lower
+    // are then kept in an array of their own and only step() is
+    // available.
+    //
+    // Also optionally, a single-precision copy serves mixed-precision
+    // stepping: with u = a + x for a double anchor a, a sub-step
+    // L u' = R u becomes L x' = R x + (R - L) a. The defect (R - L) a is
+    // formed in double once per anchor (defect()); the sub-steps then
+    // move only floats (stepSingle()), half the bytes of a double sweep.
+    class CnOperator
+    {
+      public:
+        CnOperator() = default;
+
+        // Packs an unprepared CN pair. `with_ul` also prepares the UL
+        // pivots used by steps(), `with_single` the single-precision copy;
+        // neither is available with a mass matrix.
+        void build(const TDMatrix& rhs, const TDMatrix& lhs, bool with_ul = false,
+                   bool with_single = false);
+
+        [[nodiscard]] int  size()  const noexcept { return static_cast<int>(m_cells.size()); }
+        [[nodiscard]] bool empty() const noexcept { return m_cells.empty(); }
+        [[nodiscard]] bool hasUL() const noexcept { return !m_ul_inv.empty(); }
+        [[nodiscard]] bool hasSingle() const noexcept { return !m_cells_single.empty(); }
+        [[nodiscard]] bool hasMass() const noexcept { return !m_elim.empty(); }
+
+        // One sub-step on rows [from, to] (the active window, see
+        // algorithm::crankNicolsonStepIP), or on every row. The operator
+        // is only read, so several threads may step independent vectors.
+        void step(std::vector<double>& vec, int from, int to) const;
+        void step(std::vector<double>& vec) const { step(vec, 0, size() - 1); }
+
+        // n_steps sub-steps. With UL pivots they alternate LU and UL
+        // sweeps and take n_steps + 1 passes (see
+        // algorithm::crankNicolsonStepsIP), else n_steps single steps.
+        void steps(std::vector<double>& vec, int n_steps) const;
+
+        // Mixed precision (needs the single-precision copy): the defect
+        // s = (rhs - lhs) a, accumulated in double, and one sub-step
+        // x <- lhs^{-1} (rhs x + s) in single precision.
+        void defect(const std::vector<double>& a, std::vector<float>& s) const;
+        void stepSingle(std::vector<float>& x, const std::vector<float>& s) const;
+
+      private:
+        template <bool kMass>
+        void stepRows(std::vector<double>& vec, int from, int to) const;
+
+        // Row i of the rhs and the reciprocal LU pivot of row i of the lhs.
+        // lower is 0 in the first row, upper in the last.
+        struct alignas(32) Cell
+        {
+            double lower;
+            double diag;
+            double upper;
+            double inv;
+        };
+        struct alignas(16) CellSingle
+        {
+            float lower;
+            float diag;
+            float upper;
+            float inv;
+        };
+
+        std::vector<Cell>   m_cells;
+        std::vector<double> m_c_star;   // LU back-substitution coefficients
+        std::vector<double> m_ul_inv;   // reciprocal UL pivots, empty if unused
+        std::vector<double> m_elim;     // -lhs lower of row i, empty without a mass matrix
+
+        // Single-precision copy, empty if unused.
+        std::vector<CellSingle> m_cells_single;
+        std::vector<float>      m_c_star_single;
+        std::vector<double>     m_defect_diag;   // rhs diag - lhs diag
+    };
+}
+
+#endif  // SC_CNOPERATOR_H
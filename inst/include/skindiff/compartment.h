@@ -16,6 +16,7 @@ namespace sc
         double area_um2    = 1.0;   // cross-sectional area, in um^2
         double c_init      = 0.0;   // mg / um^3
         bool   finite_dose = true;
+        bool   lumped      = false;  // well mixed: a single cell, no internal resistance
 
         int geo_from = 0;  // first space-step index belonging to this compartment
         int geo_to   = 0;  // last (inclusive)
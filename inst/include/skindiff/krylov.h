@@ -0,0 +1,125 @@
+#ifndef SC_KRYLOV_H
+#define SC_KRYLOV_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace sc::algorithm
+{
+    struct GmresResult
+    {
+        int    applications = 0;     // calls of the operator
+        double residual     = 0.0;   // final ||b - A x|| / ||b||
+        bool   converged    = false;
+    };
+
+    // Restarted GMRES(m) for A x = b with a matrix-free operator:
+    // apply(v, out) must set out = A v. x holds the initial guess on entry
+    // and the solution on exit. Modified Gram-Schmidt with Givens
+    // rotations; the iteration stops once the relative residual drops
+    // below `tol` or `max_apply` operator calls are spent.
+    template <typename Apply>
+    GmresResult gmres(Apply&& apply, const std::vector<double>& b, std::vector<double>& x,
+                      double tol, int max_apply, int restart = 30)
+    {
+        const auto n = b.size();
+        assert(x.size() == n);
+        GmresResult result;
+
+        auto norm = [](const std::vector<double>& v) {
+            double s = 0.0;
+            for (const auto e : v) s += e * e;
+            return std::sqrt(s);
+        };
+        const auto b_norm = norm(b);
+        if (b_norm == 0.0)
+        {
+            std::fill(x.begin(), x.end(), 0.0);
+            result.converged = true;
+            return result;
+        }
+
+        const auto m = static_cast<std::size_t>(std::max(1, restart));
+        std::vector<std::vector<double>> V(m + 1, std::vector<double>(n));
+        std::vector<std::vector<double>> H(m + 1, std::vector<double>(m, 0.0));
+        std::vector<double> cs(m), sn(m), g(m + 1), w(n);
+
+        while (true)
+        {
+            // r = b - A x
+            apply(x, w);
+            ++result.applications;
+            for (std::size_t i = 0; i < n; ++i) V[0][i] = b[i] - w[i];
+            const auto beta = norm(V[0]);
+            result.residual = beta / b_norm;
+            if (result.residual <= tol)
+            {
+                result.converged = true;
+                return result;
+            }
+            if (result.applications >= max_apply) return result;
+
+            for (auto& e : V[0]) e /= beta;
+            std::fill(g.begin(), g.end(), 0.0);
+            g[0] = beta;
+
+            std::size_t k = 0;
+            for (; k < m && result.applications < max_apply; ++k)
+            {
+                apply(V[k], w);
+                ++result.applications;
+                for (std::size_t j = 0; j <= k; ++j)
+                {
+                    double h = 0.0;
+                    for (std::size_t i = 0; i < n; ++i) h += w[i] * V[j][i];
+                    H[j][k] = h;
+                    for (std::size_t i = 0; i < n; ++i) w[i] -= h * V[j][i];
+                }
+                const auto h_next = norm(w);
+                H[k + 1][k] = h_next;
+                if (h_next > 0.0)
+                {
+                    for (std::size_t i = 0; i < n; ++i) V[k + 1][i] = w[i] / h_next;
+                }
+
+                for (std::size_t j = 0; j < k; ++j)
+                {
+                    const auto t = cs[j] * H[j][k] + sn[j] * H[j + 1][k];
+                    H[j + 1][k]  = -sn[j] * H[j][k] + cs[j] * H[j + 1][k];
+                    H[j][k]      = t;
+                }
+                const auto r = std::hypot(H[k][k], H[k + 1][k]);
+                cs[k] = r > 0.0 ? H[k][k] / r : 1.0;
+                sn[k] = r > 0.0 ? H[k + 1][k] / r : 0.0;
+                H[k][k]     = r;
+                H[k + 1][k] = 0.0;
+                g[k + 1] = -sn[k] * g[k];
+                g[k]     = cs[k] * g[k];
+
+                if (std::abs(g[k + 1]) <= tol * b_norm || h_next == 0.0)
+                {
+                    ++k;
+                    break;
+                }
+            }
+
+            // x += V_k y with H_k y = g_k (upper triangular).
+            std::vector<double> y(k);
+            for (std::size_t j = k; j-- > 0;)
+            {
+                double s = g[j];
+                for (std::size_t l = j + 1; l < k; ++l) s -= H[j][l] * y[l];
+                y[j] = H[j][j] != 0.0 ? s / H[j][j] : 0.0;
+            }
+            for (std::size_t j = 0; j < k; ++j)
+            {
+                for (std::size_t i = 0; i < n; ++i) x[i] += y[j] * V[j][i];
+            }
+        }
+    }
+}
+
+#endif  // SC_KRYLOV_H
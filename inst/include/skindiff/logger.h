@@ -0,0 +1,144 @@
+#ifndef SC_LOGGER_H
+#define SC_LOGGER_H
+
+#include "cdpstore.h"
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace sc
+{
+    // Where `v` falls on the increasing grid `x` for linear interpolation
+    // held at the end values outside it, found as R's approx(rule = 2)
+    // does: the value there is at(y[i], y[j]). Needs a non-empty grid and
+    // a `v` that is not NaN.
+    struct GridPoint
+    {
+        std::size_t i = 0, j = 0;
+        double      f = 0.0;
+
+        [[nodiscard]] double at(double yi, double yj) const noexcept
+        {
+            return i == j ? yi : yi + (yj - yi) * f;
+        }
+    };
+
+    inline GridPoint locate(const std::vector<double>& x, double v) noexcept
+    {
+        std::size_t i = 0, j = x.size() - 1;
+        if (v <= x[i]) return {i, i, 0.0};
+        if (v >= x[j]) return {j, j, 0.0};
+        while (i + 1 < j)
+        {
+            const auto m = (i + j) / 2;
+            if (v < x[m]) j = m;
+            else          i = m;
+        }
+        if (v == x[i]) return {i, i, 0.0};
+        return {i, j, (v - x[i]) / (x[j] - x[i])};
+    }
+
+    // Time-series of a scalar (mass per compartment, mass per sink).
+    struct MassSeries
+    {
+        bool   enabled      = true;
+        int    log_interval = 1;            // minutes
+        std::vector<double> times;          // minutes
+        std::vector<double> values;         // in user-selected scaling unit
+
+        void reserve_for_total(int total_minutes)
+        {
+            if (!enabled) return;
+            const auto cap =
+                1u + static_cast<unsigned>(std::floor(total_minutes / std::max(1, log_interval)));
+            times.reserve(cap);
+            values.reserve(cap);
+        }
+
+        void record(double t, double value)
+        {
+            times.push_back(t);
+            values.push_back(value);
+        }
+
+        // Value at time `t` (minutes), linear between the samples and held
+        // beyond them; NaN if there are none or `t` is NaN.
+        [[nodiscard]] double at(double t) const noexcept
+        {
+            if (values.empty() || std::isnan(t)) return std::numeric_limits<double>::quiet_NaN();
+            const auto p = locate(times, t);
+            return p.at(values[p.i], values[p.j]);
+        }
+
+        [[nodiscard]] bool should_log(double t) const noexcept
+        {
+            if (!enabled) return false;
+            return static_cast<int>(t) % log_interval == 0;
+        }
+    };
+
+    // Time-series of a 1-D concentration profile (CDP) for a single compartment.
+    // depths_um is fixed for the lifetime of the series; conc_per_time has one
+    // entry per logged time-point, each of length depths_um.size() -- unless
+    // the profiles go to `store`, which then holds them and conc_per_time
+    // stays empty.
+    struct CdpSeries
+    {
+        bool   enabled      = false;
+        int    log_interval = 1;            // minutes
+        std::vector<double> depths_um;
+        std::vector<double> times;          // minutes
+        std::vector<std::vector<double>> conc_per_time;  // [time_idx][depth_idx]
+        std::shared_ptr<CdpStore> store;
+
+        void reserve_for_total(int total_minutes)
+        {
+            if (!enabled) return;
+            const auto cap =
+                1u + static_cast<unsigned>(std::floor(total_minutes / std::max(1, log_interval)));
+            times.reserve(cap);
+            if (!store) conc_per_time.reserve(cap);
+        }
+
+        void record(double t, std::vector<double> profile)
+        {
+            if (store) store->append(t, profile);
+            else       conc_per_time.push_back(std::move(profile));
+            times.push_back(t);
+        }
+
+        // Profile k (< times.size()), from wherever it is kept.
+        [[nodiscard]] std::vector<double> profile(std::size_t k) const
+        {
+            return store ? store->read(k) : conc_per_time[k];
+        }
+
+        // Profile at time `t` (minutes), interpolated per depth as
+        // MassSeries::at; NaN everywhere if there is none or `t` is NaN.
+        [[nodiscard]] std::vector<double> profileAt(double t) const
+        {
+            if (times.empty() || std::isnan(t))
+            {
+                return std::vector<double>(depths_um.size(),
+                                           std::numeric_limits<double>::quiet_NaN());
+            }
+            const auto p = locate(times, t);
+            auto out = profile(p.i);
+            if (p.i == p.j) return out;
+            const auto next = profile(p.j);
+            for (std::size_t d = 0; d < out.size(); ++d) out[d] = p.at(out[d], next[d]);
+            return out;
+        }
+
+        [[nodiscard]] bool should_log(double t) const noexcept
+        {
+            if (!enabled) return false;
+            return static_cast<int>(t) % log_interval == 0;
+        }
+    };
+}
+
+#endif  // SC_LOGGER_H
@@ -0,0 +1,85 @@
+#ifndef SC_METRICS_H
+#define SC_METRICS_H
+
+#include "parameter.h"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace sc
+{
+    // State of the run at one instant, as seen by MetricsAccumulator.
+    // Masses are in the scaling unit, the concentration per ml.
+    struct MetricsSample
+    {
+        double t          = 0.0;   // min
+        double sink_mass  = 0.0;   // mass that has crossed into the sink
+        double conc       = 0.0;   // receptor (or, with a PK model, plasma) concentration
+        double donor_mass = std::numeric_limits<double>::quiet_NaN();   // NaN once removed
+    };
+
+    // Summary of a run; NaN where a quantity is undefined or a level was
+    // never reached. Times are in minutes, fluxes per minute.
+    struct RunMetrics
+    {
+        static constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+        int    samples = 0;
+        double q_total = 0.0;      // sink mass at the last sample
+        // Least-squares line through the sink mass over the steady-state
+        // window: its slope, x-intercept (if the slope is positive) and R^2.
+        double j_ss  = kNaN;
+        double t_lag = kNaN;
+        double r2_ss = kNaN;
+        // Largest mean flux over one sample interval, at its midpoint.
+        double j_max   = kNaN;
+        double t_j_max = kNaN;
+        // Trapezoidal AUC (conc x min), peak and time of the peak of the
+        // receptor concentration.
+        double auc   = 0.0;
+        double c_max = kNaN;
+        double t_max = kNaN;
+        // Donor halving time and the share of the initial donor mass gone
+        // at its last sample.
+        double t_donor_half = kNaN;
+        double depletion    = kNaN;
+        // Time at which the sink had gained MetricsParams::permeated[k] of
+        // the initial donor mass.
+        std::vector<double> t_permeated;
+    };
+
+    // Streaming form of the post-hoc metrics of a logged run: every sample
+    // updates running sums in O(1), so a run can be summarised at the
+    // resolution of its sub-steps without storing, or even logging, any of
+    // them. Crossing times are interpolated linearly between samples.
+    // A sample at the time of the previous one (a donor refill) only
+    // updates the donor and the concentration peak.
+    class MetricsAccumulator
+    {
+      public:
+        MetricsAccumulator() = default;
+
+        // Starts over from `first` for a run of `sim_time` minutes.
+        void start(const MetricsParams& p, int sim_time, const MetricsSample& first);
+        void add(const MetricsSample& s);
+
+        [[nodiscard]] bool active() const noexcept { return m_active; }
+        [[nodiscard]] RunMetrics result() const;
+
+      private:
+        bool          m_active = false;
+        double        m_ss_from = 0.0, m_ss_to = 0.0;   // min
+        double        m_sink0 = 0.0, m_donor0 = 0.0, m_donor_last = 0.0;
+        std::vector<double> m_targets;   // sink mass gain of each permeated level
+        MetricsSample m_prev;
+        RunMetrics    m_out;
+
+        // Welford co-moments of (t, sink mass) over the window.
+        std::size_t m_n = 0;
+        double      m_mean_t = 0.0, m_mean_q = 0.0;
+        double      m_m_tt = 0.0, m_m_qq = 0.0, m_c_tq = 0.0;
+    };
+}
+
+#endif  // SC_METRICS_H
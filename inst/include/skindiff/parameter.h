@@ -0,0 +1,233 @@
+#ifndef SC_PARAMETER_H
+#define SC_PARAMETER_H
+
+#include "geometry.h"
+#include "matrixbuilder.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sc
+{
+    enum class Scaling
+    {
+        MG,
+        UG,
+        NG
+    };
+
+    [[nodiscard]] std::string_view toString(Scaling s) noexcept;
+    [[nodiscard]] std::optional<Scaling> scalingFromString(std::string_view str) noexcept;
+    [[nodiscard]] double scaleFactor(Scaling s) noexcept;
+
+    // Declarative early-termination criteria on model outputs. A condition
+    // is met once its quantity reaches `value`; the run then ends at the
+    // (interpolated) crossing time.
+    enum class StopKind
+    {
+        PermeatedFraction,    // mass gained by the sink / initial donor mass >= value
+        DonorFractionBelow,   // donor mass / initial donor mass <= value
+        ReceptorConcAbove     // receptor concentration (mg/ml) >= value
+    };
+
+    [[nodiscard]] std::string_view toString(StopKind k) noexcept;
+    [[nodiscard]] std::optional<StopKind> stopKindFromString(std::string_view str) noexcept;
+
+    struct StopCondition
+    {
+        StopKind kind  = StopKind::PermeatedFraction;
+        double   value = 0.5;
+    };
+
+    // Summary metrics accumulated during the run (see MetricsAccumulator).
+    struct MetricsParams
+    {
+        bool   enabled = false;
+        // Steady-state line fit window, as fractions of sys.simulation_time.
+        double ss_from = 0.7;
+        double ss_to   = 1.0;
+        // Fractions of the initial donor mass whose arrival in the sink is
+        // timed.
+        std::vector<double> permeated;
+    };
+
+    struct VehicleParams
+    {
+        std::string name   = "Vehicle";
+        double c_init      = 1.0;   // mg/ml
+        double app_area    = 1.0;   // cm^2
+        double D           = 1.0;   // um^2/min
+        int    height      = 10;    // um
+        int    replace_after = 0;   // min, 0 = disabled
+        int    remove_at     = 0;   // min, 0 = disabled
+        bool   finite_dose   = true;
+        bool   lumped        = false;   // well-mixed single node, D unused
+        bool   log_mass      = true;
+        bool   log_cdp       = false;
+
+        [[nodiscard]] bool replaces() const noexcept { return replace_after > 0; }
+        [[nodiscard]] bool removed() const noexcept { return remove_at > 0; }
+    };
+
+    // 2-D brick-and-mortar microstructure for a layer (see BrickLayer).
+    // The layer's own D and K describe the lipid mortar; the bricks
+    // (corneocytes) carry their own. Lengths in um; brick courses are
+    // stretched to fill the layer height exactly.
+    struct BrickParams
+    {
+        bool   enabled       = false;
+        double width         = 40.0;   // brick width
+        double thickness     = 0.8;    // brick thickness
+        double mortar        = 0.1;    // lipid gap, vertical and lateral
+        double D_brick       = 1.0;    // um^2/min
+        double K_brick       = 1.0;    // partition coefficient relative to vehicle
+        int    brick_cells   = 4;      // mesh cells across a brick's thickness
+        int    lateral_cells = 8;      // ... across half a brick's width
+        int    mortar_cells  = 2;      // ... across a mortar gap
+    };
+
+    struct LayerParams
+    {
+        std::string name;
+        double c_init        = 0.0;   // mg/ml
+        double D             = 1.0;   // um^2/min
+        double K             = 1.0;   // partition coefficient relative to vehicle
+        double cross_section = 1.0;   // (0, 1]
+        int    height        = 10;    // um
+        bool   log_mass      = true;
+        bool   log_cdp       = false;
+        BrickParams brick;
+    };
+
+    // A parallel route from the vehicle to the sink next to the main layer
+    // stack (e.g. the follicular shunt). Each layer's cross_section is its
+    // fraction of the application area. See Pathways.
+    struct PathwayParams
+    {
+        std::string              name;
+        std::vector<LayerParams> layers;   // top to bottom
+    };
+
+    // Linear systemic PK model fed by the sink (see Sink): a central
+    // compartment with clearance CL and, if k12 > 0, a peripheral one.
+    struct PkParams
+    {
+        bool   enabled = false;
+        double V1      = 1.0;   // ml, central volume
+        double CL      = 0.0;   // ml/min
+        double k12     = 0.0;   // 1/min, central -> peripheral
+        double k21     = 0.0;   // 1/min, peripheral -> central
+    };
+
+    struct SinkParams
+    {
+        std::string name = "Sink";
+        double c_init    = 0.0;   // mg/ml
+        double Vd        = 1.0;   // ml
+        bool   log_mass  = true;
+        PkParams pk;
+    };
+
+    struct SystemParams
+    {
+        int    resolution      = 1;     // sub-steps per um at the smallest-D compartment
+        double max_module      = 50.0;  // sub-step stability target
+        int    simulation_time = 600;   // min
+        int    n_threads       = 0;     // worker threads, 0 = one per hardware thread
+
+        // Fourth-order compact spatial scheme (MatrixBuilder::setCompact)
+        // instead of the second-order one; reaches a given accuracy with
+        // far fewer cells per layer.
+        bool   compact_scheme  = false;
+
+        // Parareal time-parallel stepping. The run is cut into
+        // `parareal_slices` time slices per event-free segment; the CN
+        // stepper is the fine propagator, backward Euler with steps of
+        // `parareal_coarse_step` minutes the coarse one.
+        int    parareal_slices      = 0;     // 0 / 1 = serial stepping
+        int    parareal_coarse_step = 60;    // min
+        int    parareal_max_iter    = 0;     // 0 = number of slices (exact)
+        double parareal_tol         = 1e-8;  // relative max-norm between iterates
+
+        // Steady-state fast-forward for infinite-dose runs: once the
+        // relative per-minute change of the state drops below this value,
+        // stepping stops and the sink mass is extrapolated linearly.
+        double steady_state_tol = 0.0;   // 0 = disabled
+
+        // Reduced-order model: replace time stepping by a Galerkin
+        // projection onto at most this many states, evaluated in closed
+        // form (see ReducedModel). Meant for fitting loops.
+        int    reduced_order = 0;        // 0 = full model
+
+        // Active window: serial stepping only sweeps the cells between the
+        // clamped donor and the diffusion front, where the state differs
+        // from zero by more than this fraction of its largest value.
+        double active_window_tol = 0.0;  // 0 = disabled
+
+        // Fused sub-steps: run each minute's CN sub-steps with alternating
+        // LU / UL factorizations of the lhs, so that consecutive sweeps
+        // share a pass over the state (algorithm::crankNicolsonStepsIP).
+        bool   fused_sweeps = false;
+
+        // Packed operator: serial sub-steps read the CN pair as one
+        // interleaved stream (CnOperator) instead of the six bands of the
+        // prepared TDMatrix pair. Fewer bytes per cell, but slower on
+        // meshes far beyond the cache; mixed precision always uses it.
+        bool   packed_operator = false;
+
+        // Mixed precision: sub-steps run in single precision on the change
+        // of the state over each minute, driven by the double-precision
+        // defect of the state at its start; the state itself, and every
+        // mass integrated from it, stays double (CnOperator::stepSingle).
+        bool   mixed_precision = false;
+
+        // Periodic steady state for repeated dosing (vehicle.replace_after):
+        // the run starts from the skin profile that every application
+        // period reproduces, found by GMRES on the one-period map to this
+        // relative residual.
+        double periodic_tol = 0.0;       // 0 = disabled
+
+        // Automatic mesh: `resolution` and `max_module` are only the
+        // starting point of chooseResolution(), which picks the cheapest
+        // pair whose estimated relative error in the final sink mass and
+        // concentration profile stays below this value.
+        double auto_resolution_tol = 0.0;  // 0 = disabled
+
+        // Pipelined logging: serial stepping hands copies of the state at
+        // each log time to a logging thread through a ring of this many
+        // preallocated snapshots, blocking while all of them are in use.
+        int    log_buffer = 0;             // 0 = log on the stepping thread
+
+        [[nodiscard]] bool parareal() const noexcept { return parareal_slices > 1; }
+    };
+
+    struct LogParams
+    {
+        Scaling scaling           = Scaling::MG;
+        int     mass_log_interval = 1;   // min
+        int     cdp_log_interval  = 1;   // min
+        bool    enabled           = true;  // false: no series at all
+        // If set, an existing directory that takes one file per logged
+        // concentration-depth profile series (CdpStore) instead of memory.
+        std::string cdp_dir;
+    };
+
+    struct Parameters
+    {
+        SystemParams              sys;
+        LogParams                 log;
+        SinkParams                sink;
+        VehicleParams             vehicle;
+        std::vector<LayerParams>  layers;
+        std::vector<PathwayParams> pathways;   // parallel to `layers`
+        std::vector<StopCondition> stop;   // any one met ends the run
+        MetricsParams             metrics;
+    };
+
+    // Returns std::nullopt on success, error message otherwise.
+    [[nodiscard]] std::optional<std::string> validate(const Parameters& p);
+}
+
+#endif  // SC_PARAMETER_H
@@ -0,0 +1,100 @@
+#ifndef SC_PATHWAYS_H
+#define SC_PATHWAYS_H
+
+#include "compartment.h"
+#include "geometry.h"
+#include "parameter.h"
+#include "sink.h"
+#include "tdmatrix.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace sc
+{
+    // Parallel 1-D pathways (e.g. the follicular shunt) next to the main
+    // stack, all fed by the same vehicle and draining into the same sink.
+    //
+    // The unknowns split into chains -- the vehicle cells above its last
+    // cell v, the main skin cells, and one chain per pathway -- and two
+    // shared nodes, v and the sink s. Every chain is tri-diagonal and only
+    // touches the shared nodes through its first and last row, so the
+    // Crank-Nicolson system is block-diagonal with a border of two rows and
+    // columns. With tau = dt / 2 and L = I - tau A it is solved as
+    //
+    //   x_c = y_c + r_c x_S       per chain (one Thomas solve for y_c)
+    //   S x_S = g                 2 x 2 Schur complement for v and s
+    //
+    // where r_c = L_cc^{-1} tau A_cS are the chains' responses to unit
+    // values of the shared nodes and S = L_SS - sum_c L_Sc r_c. Both are
+    // constant and prepared once, so a step costs one fused CN sweep per
+    // chain plus an axpy, i.e. about what the single stack costs.
+    class Pathways
+    {
+      public:
+        Pathways() = default;
+
+        // `op` is the per-minute operator of the main stack and `n_ts` its
+        // sub-step count (MatrixBuilder). Pathway layers are meshed like the
+        // main stack, relative to their own smallest D.
+        void build(const std::vector<PathwayParams>& pathways,
+                   const std::vector<Compartment>& compartments, const Geometry& geometry,
+                   const Sink& sink, const TDMatrix& op, int n_ts, int resolution,
+                   double max_module);
+
+        [[nodiscard]] bool empty() const noexcept { return m_layers.empty(); }
+        [[nodiscard]] int  subSteps() const noexcept { return m_n_sub; }
+
+        // One minute of steps on the main state and the pathway states.
+        void advanceMinute(std::vector<double>& state);
+
+        // Pathway layers, all pathways in order. geo_from / geo_to index
+        // the cells of the layer's own pathway.
+        [[nodiscard]] const std::vector<Compartment>& compartments() const noexcept
+        {
+            return m_layers;
+        }
+        [[nodiscard]] double              mass(std::size_t k, double scale) const;
+        [[nodiscard]] std::vector<double> profile(std::size_t k, double scale) const;
+        [[nodiscard]] std::vector<double> depths(std::size_t k) const;
+
+      private:
+        // A tri-diagonal run of cells between the shared nodes. `top` /
+        // `bot` name the shared node above row 0 / below the last row
+        // (-1 = none); to_* are the chain rows' couplings to them and
+        // from_* the shared rows' couplings back (per minute).
+        struct Chain
+        {
+            TDMatrix rhs, lhs;                  // I +/- tau A_cc, lhs prepared
+            std::vector<double> x;
+            std::vector<double> r_top, r_bot;   // responses, empty if zero
+            std::vector<double> h, K;           // pathway chains only
+            int    top = -1, bot = -1;
+            double to_top = 0.0, to_bot = 0.0;
+            double from_top = 0.0, from_bot = 0.0;
+        };
+
+        static constexpr int kV = 0;   // last vehicle cell
+        static constexpr int kS = 1;   // sink
+
+        void addChain(const TDMatrix& a, int top, int bot, double to_top, double to_bot,
+                      double from_top, double from_bot);
+        void prepare();
+        void step();
+        [[nodiscard]] const Chain& chainOf(std::size_t k) const;
+
+        std::vector<Chain>       m_chains;   // [vehicle], main, pathways
+        std::vector<Compartment> m_layers;
+        std::vector<std::size_t> m_layer_chain;
+        std::size_t m_first_pathway = 0;
+
+        double m_diag_S[2] = {0.0, 0.0};     // shared nodes' own couplings
+        double m_x_S[2]    = {0.0, 0.0};
+        double m_S_inv[2][2] = {{1.0, 0.0}, {0.0, 1.0}};
+        int    m_v = 0, m_s = 0;             // shared nodes in the main state
+        int    m_n_sub = 1;
+        double m_tau   = 0.5;
+    };
+}
+
+#endif  // SC_PATHWAYS_H
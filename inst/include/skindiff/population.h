@@ -0,0 +1,158 @@
+#ifndef SC_POPULATION_H
+#define SC_POPULATION_H
+
+#include "parameter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // Mergeable quantile sketch: a merging t-digest (Dunning & Ertl 2019)
+    // with the k1 scale function, so centroids stay small in the tails
+    // and the sketch holds O(compression) of them however many values it
+    // has seen. Values are buffered and folded in batches; the result
+    // depends on the order of add() and merge() calls only through that
+    // folding, so the same sequence of calls gives the same sketch.
+    class TDigest
+    {
+      public:
+        explicit TDigest(double compression = 100.0);
+
+        // Non-finite values are ignored.
+        void add(double x, double weight = 1.0);
+        void merge(const TDigest& other);
+
+        // Total weight added.
+        [[nodiscard]] double count() const noexcept { return m_count; }
+        // Estimated q-quantile, q in [0, 1], interpolated between centroid
+        // centres and exact at the extremes; NaN if the sketch is empty.
+        [[nodiscard]] double quantile(double q) const;
+        [[nodiscard]] std::size_t centroids() const;
+
+      private:
+        struct Centroid
+        {
+            double mean   = 0.0;
+            double weight = 0.0;
+        };
+
+        void fold() const;
+
+        double                        m_compression;
+        double                        m_count = 0.0;
+        double                        m_min   = 0.0;
+        double                        m_max   = 0.0;
+        mutable std::vector<Centroid> m_centroids;   // by mean
+        mutable std::vector<Centroid> m_buffer;      // not yet folded
+    };
+
+    // A parameter drawn for each subject of simulatePopulation(), by its
+    // path as for SensitivityFactor, from
+    //   Normal:     mean a, standard deviation b;
+    //   LogNormal:  log-mean a (the log of the median), log-sd b;
+    //   Uniform:    [a, b];
+    //   LogUniform: [a, b], log-uniformly.
+    struct PopulationFactor
+    {
+        enum class Dist
+        {
+            Normal,
+            LogNormal,
+            Uniform,
+            LogUniform
+        };
+
+        std::string path;
+        Dist        dist = Dist::Normal;
+        double      a    = 0.0;
+        double      b    = 1.0;
+    };
+
+    // Draws the factors of each subject through a Gaussian copula: standard
+    // normals correlated by the Cholesky factor of `correlation` (row-major
+    // n x n; empty for independent factors) and mapped through each
+    // factor's distribution. Subject i's draw depends only on the seed and
+    // i, not on which thread draws it or in what order.
+    class PopulationSampler
+    {
+      public:
+        // Throws std::invalid_argument if `correlation` is not a symmetric
+        // positive-definite matrix with a unit diagonal.
+        PopulationSampler(std::vector<PopulationFactor> factors,
+                          const std::vector<double>& correlation, std::uint64_t seed);
+
+        [[nodiscard]] std::vector<double> draw(std::uint64_t subject) const;
+
+      private:
+        std::vector<PopulationFactor> m_factors;
+        std::vector<double>           m_chol;   // lower triangle, row-major
+        std::uint64_t                 m_seed;
+    };
+
+    // A series summarised over the population at each output time:
+    // sink mass gained per cm^2 of vehicle.app_area (Permeated), mean
+    // concentration (scaling units / ml) in the vehicle or the layer
+    // `name` (Compartment), or the PK plasma concentration (Plasma).
+    struct PopulationSeries
+    {
+        enum class Kind
+        {
+            Permeated,
+            Compartment,
+            Plasma
+        };
+
+        Kind        kind = Kind::Permeated;
+        std::string name;   // Compartment only
+    };
+
+    struct PopulationSummary
+    {
+        std::size_t n_times  = 0;
+        std::size_t subjects = 0;   // run
+        std::size_t failed   = 0;   // of those, left out
+        // One sketch per series and time: [series * n_times + time].
+        std::vector<TDigest> sketches;
+
+        [[nodiscard]] const TDigest& at(std::size_t series, std::size_t time) const
+        {
+            return sketches[series * n_times + time];
+        }
+    };
+
+    // Why the population cannot run, if it cannot: an unknown path, a
+    // parameter given twice, a distribution with a bad spread or a
+    // non-positive LogUniform range, a malformed correlation matrix, an
+    // unknown compartment, plasma without PK, or an output time outside
+    // the run.
+    [[nodiscard]] std::optional<std::string> populationError(
+        const Parameters& base, const std::vector<PopulationFactor>& factors,
+        const std::vector<double>& correlation, const std::vector<PopulationSeries>& series,
+        const std::vector<double>& times);
+
+    // Runs `n` subjects: `base` with the factors drawn by a
+    // PopulationSampler, `chunk` subjects at a time on up to n_threads
+    // threads. Each chunk's series are read at `times` (min) and folded in
+    // subject order into one TDigest per series and time, then dropped, so
+    // memory is O(series x times) whatever `n`, and the summary does not
+    // depend on the thread count. Runs are serial and log only the series
+    // asked for; a subject whose run fails or whose drawn parameters are
+    // invalid is counted in `failed` and left out. `between_chunks` (if
+    // any) is called on the calling thread after each chunk. Throws
+    // std::invalid_argument if populationError() has an error.
+    PopulationSummary simulatePopulation(const Parameters& base,
+                                         const std::vector<PopulationFactor>& factors,
+                                         const std::vector<double>& correlation,
+                                         const std::vector<PopulationSeries>& series,
+                                         const std::vector<double>& times, std::size_t n,
+                                         std::uint64_t seed, int n_threads, std::size_t chunk,
+                                         double compression = 100.0,
+                                         const std::function<void()>& between_chunks = {});
+}
+
+#endif  // SC_POPULATION_H
@@ -0,0 +1,156 @@
+#ifndef SC_SENSITIVITY_H
+#define SC_SENSITIVITY_H
+
+#include "parameter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // Sobol' low-discrepancy sequence in up to kMaxDims dimensions, with
+    // the direction numbers of Joe & Kuo (new-joe-kuo-6.21201) and points
+    // in Gray-code order, as their generator produces them.
+    class SobolSequence
+    {
+      public:
+        static constexpr std::size_t kMaxDims = 40;
+        static constexpr int         kBits    = 32;
+
+        // Throws std::invalid_argument for 0 or more than kMaxDims
+        // dimensions.
+        explicit SobolSequence(std::size_t dims);
+
+        [[nodiscard]] std::size_t dims() const noexcept { return m_dims; }
+        // Point i (the first is the origin), in [0, 1)^dims.
+        [[nodiscard]] std::vector<double> point(std::uint64_t i) const;
+
+      private:
+        std::size_t                m_dims = 0;
+        std::vector<std::uint32_t> m_v;   // [dim * kBits + bit]
+    };
+
+    // Running Saltelli estimators of first-order and total Sobol' indices.
+    // Each base sample contributes the outputs at its points A and B and
+    // at the d points AB_j (A with coordinate j from B) and is then
+    // dropped, so memory does not grow with the number of samples:
+    //   S_j  = mean(f(B) (f(AB_j) - f(A))) / V     (Saltelli 2010)
+    //   ST_j = mean((f(A) - f(AB_j))^2) / (2 V)    (Jansen)
+    // with V the variance of all f(A) and f(B). The sums are kept relative
+    // to a reference value and f(B) centred at the end, so outputs far
+    // from zero do not cancel. A sample with a non-finite output is left
+    // out for that output.
+    class SobolAccumulator
+    {
+      public:
+        SobolAccumulator(std::size_t n_factors, std::size_t n_outputs);
+
+        // f_a and f_b: n_outputs values each; f_ab: n_factors x n_outputs,
+        // row j for AB_j.
+        void add(const std::vector<double>& f_a, const std::vector<double>& f_b,
+                 const std::vector<std::vector<double>>& f_ab);
+
+        [[nodiscard]] std::size_t samples(std::size_t output) const
+        {
+            return m_out[output].n;
+        }
+        // NaN without two samples or without variance.
+        [[nodiscard]] double first(std::size_t factor, std::size_t output) const;
+        [[nodiscard]] double total(std::size_t factor, std::size_t output) const;
+        [[nodiscard]] double mean(std::size_t output) const;
+        [[nodiscard]] double variance(std::size_t output) const;
+
+      private:
+        struct Output
+        {
+            std::size_t n = 0;   // base samples
+            bool        referenced = false;
+            double      ref = 0.0;
+            // Welford mean and squared deviations of the f(A), f(B) less ref.
+            std::size_t m = 0;
+            double      mean = 0.0, m2 = 0.0;
+            std::vector<double> first, delta, total;   // per factor
+        };
+
+        std::size_t         m_factors = 0;
+        std::vector<Output> m_out;
+    };
+
+    // Maps a point of the unit cube to the outputs of the model. Called on
+    // worker threads, concurrently.
+    using SobolModel = std::function<std::vector<double>(const std::vector<double>&)>;
+
+    // First-order and total indices of the `n_outputs` outputs of `model`
+    // with respect to its `n_factors` inputs, from a Saltelli design over
+    // `n_base` Sobol' points in 2 n_factors dimensions (the origin
+    // skipped): n_base (n_factors + 2) evaluations, run `chunk` base
+    // samples at a time on up to n_threads threads and reduced in order,
+    // so the result does not depend on the thread count. `between_chunks`
+    // (if any) is called on the calling thread after each chunk.
+    SobolAccumulator sobolIndices(std::size_t n_factors, std::size_t n_outputs,
+                                  std::size_t n_base, const SobolModel& model, int n_threads,
+                                  std::size_t chunk,
+                                  const std::function<void()>& between_chunks = {});
+
+    // A parameter varied by parameterSensitivity(): its path as in the
+    // parameter columns of a batch file ("vehicle.D", "layers.SC.K",
+    // "pathways.Follicle.layers.Shunt.height", "sink.pk.CL", ...) and its
+    // range, sampled uniformly or, with `log`, log-uniformly. Integer
+    // parameters (heights) are rounded.
+    struct SensitivityFactor
+    {
+        std::string path;
+        double      lower = 0.0;
+        double      upper = 1.0;
+        bool        log   = false;
+    };
+
+    // An output of parameterSensitivity(). Per-area values use
+    // vehicle.app_area: sink mass gained per cm^2 at `time` (Permeated)
+    // or over the run (QTotal), and the steady-state and peak flux.
+    struct SensitivityOutput
+    {
+        enum class Kind
+        {
+            Permeated,
+            QTotal,
+            JSS,
+            TLag,
+            JMax,
+            TDonorHalf,
+            AUC,
+            CMax,
+            TMax
+        };
+
+        Kind   kind = Kind::JSS;
+        double time = 0.0;   // min, Permeated only
+    };
+
+    // Sets the parameter at `path` (see SensitivityFactor); false if there
+    // is no such numeric parameter.
+    bool setParameter(Parameters& p, const std::string& path, double value);
+
+    // Why the analysis cannot run, if it cannot: an unknown path, an
+    // empty or (for `log`) non-positive range, too many factors, an output
+    // time outside the run, or a range end that makes `base` invalid.
+    [[nodiscard]] std::optional<std::string> sensitivityError(
+        const Parameters& base, const std::vector<SensitivityFactor>& factors,
+        const std::vector<SensitivityOutput>& outputs);
+
+    // sobolIndices() of `outputs` over runs of `base` with `factors` set
+    // from each point. The runs are serial and log only what the outputs
+    // need; a run that fails or whose parameters are invalid gives NaN.
+    // Throws std::invalid_argument if sensitivityError() has an error.
+    SobolAccumulator parameterSensitivity(const Parameters& base,
+                                          const std::vector<SensitivityFactor>& factors,
+                                          const std::vector<SensitivityOutput>& outputs,
+                                          std::size_t n_base, int n_threads, std::size_t chunk,
+                                          const std::function<void()>& between_chunks = {});
+}
+
+#endif  // SC_SENSITIVITY_H
@@ -0,0 +1,49 @@
+#ifndef SC_SINK_H
+#define SC_SINK_H
+
+#include <string>
+
+namespace sc
+{
+    // The bottom boundary of the compartment stack.
+    //
+    // The sink behaves as a perfect Dirichlet boundary for the diffusion
+    // problem -- the membrane sees u_sink = 0 regardless of `Vd`. The sink
+    // cell itself is a virtual mass accumulator; its stored value is
+    // Vd-scaled so that integrating it recovers the cumulative mass that
+    // crossed the membrane.
+    //
+    // Optionally the mass that crosses feeds a linear systemic PK model:
+    // a central compartment of volume `pk_V1` with first-order
+    // elimination `pk_ke` and, if `pk_k12 > 0`, exchange with a peripheral
+    // compartment (`pk_k12`, `pk_k21`). Its state lives in one or two
+    // extra cells below the sink cell (see MatrixBuilder::buildMatrix),
+    // stepped in the same Crank-Nicolson system as the skin. The central
+    // compartment starts with the sink's initial mass.
+    //
+    // Geometry indices are filled in by Geometry::create(); geo_from is
+    // the sink cell, geo_to the last PK cell (= geo_from without PK).
+    struct Sink
+    {
+        std::string name;
+        double area_um2 = 1.0;   // um^2
+        double Vd       = 1.0;   // ml
+        double c_init   = 0.0;   // mg / um^3
+
+        bool   pk     = false;
+        double pk_V1  = 1.0;   // ml
+        double pk_ke  = 0.0;   // 1/min, CL / V1
+        double pk_k12 = 0.0;   // 1/min, central -> peripheral
+        double pk_k21 = 0.0;   // 1/min, peripheral -> central
+
+        int geo_from = 0;
+        int geo_to   = 0;
+
+        [[nodiscard]] int pkCells() const noexcept
+        {
+            return pk ? (pk_k12 > 0.0 ? 2 : 1) : 0;
+        }
+    };
+}
+
+#endif  // SC_SINK_H
@@ -0,0 +1,318 @@
+#ifndef SC_SYSTEM_H
+#define SC_SYSTEM_H
+
+#include "brick.h"
+#include "checkpoint.h"
+#include "cnoperator.h"
+#include "compartment.h"
+#include "geometry.h"
+#include "logger.h"
+#include "matrixbuilder.h"
+#include "metrics.h"
+#include "parameter.h"
+#include "pathways.h"
+#include "sink.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sc
+{
+    // Owns the discretized stack and the time-series loggers and runs the
+    // Crank-Nicolson time-stepping loop.
+    class System
+    {
+      public:
+        enum class Result
+        {
+            Executed,
+            Failed,
+            Stopped
+        };
+
+        explicit System(Parameters parameters);
+        virtual ~System() = default;
+
+        Result run();
+
+        // Continues from `cp` up to parameters().sys.simulation_time, in
+        // place of run(). The logged series before cp.t are the
+        // checkpoint's; vehicle events at or before cp.t are those the
+        // checkpoint went through, later ones follow parameters(). Failed
+        // if resumeError(cp) is set.
+        Result resume(const Checkpoint& cp);
+        // Why this System cannot resume from `cp`, if it cannot: a
+        // different mesh or compartment list, cp.t not before the end of
+        // the run, a run mode without a single state vector
+        // (reduced-order, brick-and-mortar, pathways, periodic start) or
+        // metrics, which cover the whole run.
+        [[nodiscard]] std::optional<std::string> resumeError(const Checkpoint& cp) const;
+        // The state after a run() / resume() that reached its end; nullopt
+        // after a stopped run, a met stop condition or the run modes above.
+        [[nodiscard]] std::optional<Checkpoint> checkpoint() const;
+
+        [[nodiscard]] const Parameters& parameters() const noexcept { return m_parameters; }
+        [[nodiscard]] const Geometry&   geometry()   const noexcept { return m_geometry; }
+        [[nodiscard]] const std::vector<Compartment>& compartments() const noexcept
+        {
+            return m_compartments;
+        }
+        [[nodiscard]] const Sink& sink() const noexcept { return m_sink; }
+        // The stepping matrices; timesteps() is the sub-step count per minute.
+        [[nodiscard]] const MatrixBuilder& matrixBuilder() const noexcept
+        {
+            return m_matrix_builder;
+        }
+        [[nodiscard]] const std::vector<double>& concentrations() const noexcept
+        {
+            return m_concentrations;
+        }
+
+        [[nodiscard]] const std::vector<MassSeries>& compartmentMass() const noexcept
+        {
+            return m_mass_series;
+        }
+        [[nodiscard]] const MassSeries& sinkMass() const noexcept { return m_sink_mass; }
+        // Central-compartment (plasma) concentration of the sink's PK model
+        // in scaling units / ml, logged with the masses; disabled without PK.
+        [[nodiscard]] const MassSeries& plasma() const noexcept { return m_plasma; }
+        [[nodiscard]] const std::vector<CdpSeries>& cdp() const noexcept { return m_cdp_series; }
+        // Original-compartment names, one per entry in compartmentMass() / cdp().
+        // The vectors stay aligned to the original compartment list even after
+        // a donor-removal event, so pre-removal donor data is preserved.
+        [[nodiscard]] const std::vector<std::string>& compartmentNames() const noexcept
+        {
+            return m_compartment_names;
+        }
+        // The logged mass and profile series with their names, for a
+        // caller that keeps them after dropping the System. The series are
+        // moved out and left empty here, so take a checkpoint() first.
+        struct LoggedSeries
+        {
+            std::vector<std::string> names;   // as compartmentNames()
+            std::vector<MassSeries>  mass;
+            MassSeries               sink_mass;
+            std::vector<CdpSeries>   cdp;
+        };
+        [[nodiscard]] LoggedSeries takeSeries();
+        // Summary metrics of the last run, sampled after every sub-step; all
+        // empty unless parameters().metrics.enabled.
+        [[nodiscard]] RunMetrics metrics() const { return m_metrics.result(); }
+        // Minute at which the steady-state detector fired and stepping was
+        // replaced by linear extrapolation, or -1 if it never did.
+        [[nodiscard]] int steadyStateTime() const noexcept { return m_steady_state_at; }
+        // Crossing time (min) of the stop condition that ended the run and
+        // its index in parameters().stop, or -1 / -1 if none was met.
+        [[nodiscard]] double stopTime()  const noexcept { return m_stop_time; }
+        [[nodiscard]] int    stopIndex() const noexcept { return m_stop_index; }
+        // Reduced-order runs: basis size actually used, and an estimate (not
+        // a bound) of the final sink-mass error in scaling units, -1 if the
+        // basis was too small to embed a lower-order model. Both -1 for full
+        // runs.
+        [[nodiscard]] int    reducedOrder()         const noexcept { return m_reduced_order; }
+        [[nodiscard]] double reducedErrorEstimate() const noexcept { return m_reduced_error; }
+        // Periodic-steady-state runs: periods stepped to find the start
+        // profile (GMRES and the final check included), the relative
+        // max-norm change of that profile over one period, and the sink
+        // mass gained per period (scaling units). -1 for other runs.
+        [[nodiscard]] int    periodicPeriods()  const noexcept { return m_periodic_periods; }
+        [[nodiscard]] double periodicResidual() const noexcept { return m_periodic_residual; }
+        [[nodiscard]] double periodicFlux()     const noexcept { return m_periodic_flux; }
+        // The brick-and-mortar layer and its compartment index, or nullptr /
+        // -1 if every layer is 1-D. Its 2-D field is current after run().
+        [[nodiscard]] const BrickLayer* brickLayer() const noexcept
+        {
+            return m_brick_layer >= 0 ? &m_brick : nullptr;
+        }
+        [[nodiscard]] int brickLayerIndex() const noexcept { return m_brick_layer; }
+        // Parallel pathways next to the main stack; empty if there are none.
+        // Their layers are logged after the main compartments.
+        [[nodiscard]] const Pathways& pathways() const noexcept { return m_pathways; }
+
+      protected:
+        // Hooks for derived classes (e.g. R bindings) to inject progress / cancellation.
+        virtual bool initRun()                       { return true; }
+        virtual bool tearDownRun()                   { return true; }
+        virtual void progressCallback(int /*t*/)     {}
+        virtual bool testForStop(int /*t*/)          { return false; }
+
+      private:
+        // Logged values at one time point, sampled off the main loop (e.g.
+        // by a parareal worker) and committed to the series afterwards.
+        // Entries are indexed by active compartment; series that do not log
+        // at `t` are left empty / zero.
+        struct LogRecord
+        {
+            double t = 0.0;
+            std::vector<double>              mass;
+            std::vector<std::vector<double>> cdp;
+            double                           sink_mass = 0.0;
+            double                           plasma    = 0.0;
+        };
+
+        // run() / resume() without publishing the stored profiles, which
+        // those do however the run ends.
+        [[nodiscard]] Result runFromStart();
+        [[nodiscard]] Result resumeFrom(const Checkpoint& cp);
+        void syncCdpStores();
+
+        void buildGeometryAndMatrices();
+        void initConcentrations();
+        void initLoggers();
+        // Room in a store's time index for the log times from minute
+        // t_from on, the end of the run and a stop crossing.
+        [[nodiscard]] std::size_t cdpStoreCapacity(int t_from) const noexcept;
+        void loadStepMatrices();
+        void recordAt(double t);
+        [[nodiscard]] bool      shouldLogAt(int t) const noexcept;
+        // With all_series, samples every enabled series regardless of its
+        // log interval (for records that are re-committed at later times).
+        [[nodiscard]] LogRecord sampleRecord(double t, const std::vector<double>& state,
+                                             bool all_series = false) const;
+        void commitRecord(const LogRecord& record, bool all_series = false);
+        void replaceTopCompartment();
+        void removeTopCompartment();
+        // Compact scheme: the donor of `state` was just filled; advances
+        // the fill by MatrixBuilder::fillShift().
+        void shiftFill(std::vector<double>& state) const;
+
+        // Time loop helpers. The stepping matrices are prepared up front,
+        // so advanceMinute() is safe to call from several threads on
+        // independent state vectors.
+        void advanceMinute(std::vector<double>& state) const;
+        // One CN sub-step on rows [from, to] (the active window), or on
+        // every row, with whichever operator loadStepMatrices() prepared.
+        void subStep(std::vector<double>& state, int from, int to) const;
+        void subStep(std::vector<double>& state) const
+        {
+            subStep(state, 0, static_cast<int>(state.size()) - 1);
+        }
+        // Serial stepping restricted to the active window (see
+        // SystemParams::active_window_tol), which grows with the front.
+        void initWindow();
+        void widenWindow(const std::vector<double>& state, double threshold);
+        [[nodiscard]] double windowThreshold(const std::vector<double>& state) const;
+        void advanceActive(std::vector<double>& state);
+        // Streaming metrics (see MetricsAccumulator).
+        [[nodiscard]] MetricsSample metricsSample(double t, const std::vector<double>& state) const;
+        void advanceSampled(int t, std::vector<double>& state);
+        void applyEvents(int t);
+        [[nodiscard]] int  nextEventTime(int t) const noexcept;
+        [[nodiscard]] bool stepSerial(int t_from, int t_to);
+        // Steps from minute t to the end of the run (serially or by Parareal
+        // segments); false if stopped.
+        [[nodiscard]] bool stepFrom(int t);
+        [[nodiscard]] bool runParareal(int t_from, int t_to);
+
+        // Steady-state fast-forward (infinite-dose donor only).
+        [[nodiscard]] bool watchSteadyState() const noexcept;
+        [[nodiscard]] bool isSteady(const std::vector<double>& previous,
+                                    const std::vector<double>& current) const noexcept;
+        [[nodiscard]] bool fastForward(int t_ss, int t_to, const std::vector<double>& previous);
+
+        // Periodic steady state of repeated dosing (see
+        // SystemParams::periodic_tol): sets the skin cells to it.
+        [[nodiscard]] bool solvePeriodic();
+
+        // Reduced-order run (see ReducedModel).
+        [[nodiscard]] std::vector<double> cellWeights() const;
+        [[nodiscard]] bool runReduced();
+
+        // Run with a 2-D brick-and-mortar layer (see BrickLayer).
+        [[nodiscard]] bool runBrick();
+
+        // Run with parallel pathways (see Pathways).
+        [[nodiscard]] bool runPathways();
+
+        // Stop conditions. Only the donor and sink masses enter any of the
+        // criteria, so a probe of both is all that is needed to evaluate
+        // them at a given state.
+        struct StopProbe
+        {
+            double donor_mg      = 0.0;
+            double sink_mg       = 0.0;
+            bool   donor_present = true;
+        };
+
+        [[nodiscard]] StopProbe probeStop(const std::vector<double>& state) const;
+        [[nodiscard]] double    stopMargin(const StopCondition& c, const StopProbe& p) const noexcept;
+        // Index of the condition first met on the way from `a` to `b`
+        // (linear in between), or -1. `frac` receives its position in [0, 1].
+        [[nodiscard]] int       earliestStop(const StopProbe& a, const StopProbe& b,
+                                             double& frac) const noexcept;
+        void locateStop(int t, const std::vector<double>& start);
+        void finishAtStop(double t, int index);
+
+        Parameters               m_parameters;
+        std::vector<Compartment> m_compartments;
+        // Internal state: the activity u = c/K, in units of mg/um^3.
+        // Convert to physical concentration c via c_i = m_concentrations[i] *
+        // m_K_per_cell[i]. The sink cell follows the Vd-scaling convention
+        // (cell mass = c_sink_pk * Vd).
+        std::vector<double>      m_concentrations;
+        // Per-cell partition coefficient K (= K_layer per skin cell, K = 1
+        // in the sink). Multiply m_concentrations[i] by m_K_per_cell[i] to
+        // recover the physical concentration.
+        std::vector<double>      m_K_per_cell;
+        Sink                     m_sink;
+        Geometry                 m_geometry;
+        MatrixBuilder            m_matrix_builder;
+
+        // The series vectors are indexed by *original* compartment position
+        // (immutable after init). m_active_to_orig maps the current
+        // m_compartments index to that position, so a donor-removal event
+        // shrinks m_compartments but leaves the donor's mass / CDP series
+        // intact in m_mass_series[0] / m_cdp_series[0].
+        std::vector<std::string> m_compartment_names;
+        std::vector<int>         m_active_to_orig;
+        std::vector<MassSeries>  m_mass_series;
+        MassSeries               m_sink_mass;
+        MassSeries               m_plasma;
+        std::vector<CdpSeries>   m_cdp_series;
+
+        // Prepared CN pair and sub-step count for the current stack, plus
+        // a UL-prepared copy of the lhs for fused sweeps; or, with
+        // sys.packed_operator or mixed precision, the packed operator
+        // instead (the bands are then left empty).
+        TDMatrix   m_step_rhs;
+        TDMatrix   m_step_lhs;
+        TDMatrix   m_step_lhs_ul;
+        CnOperator m_step_op;
+        int        m_n_ts = 1;
+        // One CN sub-step of MatrixBuilder::fillShift(); empty unless compact.
+        CnOperator m_fill_op;
+
+        // Active window [from, to] of the serial stepper (to < 0: not yet
+        // known) and the look-ahead beyond the front, in cells.
+        int m_window_from = 0;
+        int m_window_to   = -1;
+        int m_window_pad  = 0;
+
+        MetricsAccumulator m_metrics;
+
+        // Minute the state is at after a completed run, -1 otherwise (see
+        // checkpoint()).
+        int    m_checkpoint_t    = -1;
+        bool   m_vehicle_removed = false;
+        int    m_steady_state_at = -1;
+        double m_stop_time       = -1.0;
+        int    m_stop_index      = -1;
+        double m_donor_mg0       = 0.0;
+        double m_sink_mg0        = 0.0;
+        int    m_reduced_order   = -1;
+        double m_reduced_error   = -1.0;
+        int    m_periodic_periods  = -1;
+        double m_periodic_residual = -1.0;
+        double m_periodic_flux     = -1.0;
+        BrickLayer m_brick;
+        int        m_brick_layer = -1;
+        Pathways   m_pathways;
+        int    m_sim_time      = 1;
+        int    m_replace_after = 0;
+        int    m_remove_at     = 0;
+        double m_scale         = 1.0;
+    };
+}
+
+#endif  // SC_SYSTEM_H
@@ -1,7 +1,9 @@
 #ifndef SC_TDMATRIX_H
 #define SC_TDMATRIX_H
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <vector>
 
@@ -14,7 +16,8 @@ namespace sc
     // for the index structure starting with (0, 0).
     //
     // After a Thomas-style solve, the matrix may be in factored form;
-    // isPrepared() / setPrepared() track that state.
+    // isPrepared() / setPrepared() track that state, isPreparedUL() /
+    // setPreparedUL() the bottom-up (UL) factored form.
     class TDMatrix
     {
       public:
@@ -79,15 +82,51 @@ namespace sc
 
         [[nodiscard]] bool isPrepared() const noexcept { return m_prepared; }
         void setPrepared(bool prep) noexcept { m_prepared = prep; }
+        [[nodiscard]] bool isPreparedUL() const noexcept { return m_prepared_ul; }
+        void setPreparedUL(bool prep) noexcept { m_prepared_ul = prep; }
 
       private:
         std::vector<double> m_diag;
         std::vector<double> m_lower;
         std::vector<double> m_upper;
         int  m_size     = 0;
-        bool m_prepared = false;
+        bool m_prepared    = false;
+        bool m_prepared_ul = false;
     };
 
+    inline double TDMatrix::absMax() const noexcept
+    {
+        if (m_size < 1) return 0.0;
+
+        double max_el = 0.0;
+        for (int i = 0; i < m_size - 1; ++i)
+        {
+            max_el = std::max({max_el, std::abs(m_diag[i]), std::abs(m_lower[i]),
+                               std::abs(m_upper[i])});
+        }
+        max_el = std::max(max_el, std::abs(m_diag[m_size - 1]));
+        return max_el;
+    }
+
+    inline bool TDMatrix::isDiagonalDominant() const noexcept
+    {
+        for (int i = 1; i < m_size - 1; ++i)
+        {
+            if (m_diag[i] < (m_upper[i] + m_lower[i - 1]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline void TDMatrix::multiplyBy(double val) noexcept
+    {
+        for (auto& d : m_diag)  d *= val;
+        for (auto& d : m_upper) d *= val;
+        for (auto& d : m_lower) d *= val;
+    }
+
     inline std::vector<double> TDMatrix::operator*(const std::vector<double>& vec) const
     {
         assert(static_cast<std::size_t>(m_size) == vec.size());
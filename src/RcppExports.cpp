@@ -1,54 +1,208 @@
-// Generated by using Rcpp::compileAttributes() -> do not edit by hand
-// Generator token: 10BE3573-1514-4C36-9D1C-5A225CD40393
-
-#include <Rcpp.h>
-
-using namespace Rcpp;
-
-#ifdef RCPP_USE_GLOBAL_ROSTREAM
-Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
-Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
-#endif
-
-// cpp_validate
-Rcpp::List cpp_validate(Rcpp::List params);
-RcppExport SEXP _skindiff_cpp_validate(SEXP paramsSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_validate(params));
-    return rcpp_result_gen;
-END_RCPP
-}
-// cpp_simulate
-Rcpp::List cpp_simulate(Rcpp::List params, bool show_progress);
-RcppExport SEXP _skindiff_cpp_simulate(SEXP paramsSEXP, SEXP show_progressSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
-    Rcpp::traits::input_parameter< bool >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_simulate(params, show_progress));
-    return rcpp_result_gen;
-END_RCPP
-}
-// cpp_run_tests
-Rcpp::RObject cpp_run_tests();
-RcppExport SEXP _skindiff_cpp_run_tests() {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    rcpp_result_gen = Rcpp::wrap(cpp_run_tests());
-    return rcpp_result_gen;
-END_RCPP
-}
-
-static const R_CallMethodDef CallEntries[] = {
-    {"_skindiff_cpp_validate", (DL_FUNC) &_skindiff_cpp_validate, 1},
-    {"_skindiff_cpp_simulate", (DL_FUNC) &_skindiff_cpp_simulate, 2},
-    {"_skindiff_cpp_run_tests", (DL_FUNC) &_skindiff_cpp_run_tests, 0},
-    {NULL, NULL, 0}
-};
-
-RcppExport void R_init_skindiff(DllInfo *dll) {
-    R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
-    R_useDynamicSymbols(dll, FALSE);
-}
+// Generated by using Rcpp::compileAttributes() -> do not edit by hand
+// Generator token: 10BE3573-1514-4C36-9D1C-5A225CD40393
+
+#include <Rcpp.h>
+
+using namespace Rcpp;
+
+#ifdef RCPP_USE_GLOBAL_ROSTREAM
+Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
+Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
+#endif
+
+// cpp_validate
+Rcpp::List cpp_validate(Rcpp::List params);
+RcppExport SEXP _skindiff_cpp_validate(SEXP paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_validate(params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_simulate
+Rcpp::List cpp_simulate(Rcpp::List params, bool show_progress, bool checkpoint, Rcpp::Nullable<Rcpp::RawVector> resume);
+RcppExport SEXP _skindiff_cpp_simulate(SEXP paramsSEXP, SEXP show_progressSEXP, SEXP checkpointSEXP, SEXP resumeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< bool >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< bool >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::RawVector> >::type resume(resumeSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_simulate(params, show_progress, checkpoint, resume));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_simulate_batch
+Rcpp::List cpp_simulate_batch(Rcpp::List params_list, int n_threads);
+RcppExport SEXP _skindiff_cpp_simulate_batch(SEXP params_listSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type params_list(params_listSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_simulate_batch(params_list, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_fork
+Rcpp::List cpp_fork(Rcpp::RawVector from, Rcpp::List params_list, int n_threads, bool checkpoint);
+RcppExport SEXP _skindiff_cpp_fork(SEXP fromSEXP, SEXP params_listSEXP, SEXP n_threadsSEXP, SEXP checkpointSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type params_list(params_listSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type checkpoint(checkpointSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_fork(from, params_list, n_threads, checkpoint));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_result_mass
+Rcpp::List cpp_result_mass(SEXP run, Rcpp::Nullable<Rcpp::NumericVector> divisor);
+RcppExport SEXP _skindiff_cpp_result_mass(SEXP runSEXP, SEXP divisorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP >::type run(runSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::NumericVector> >::type divisor(divisorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_result_mass(run, divisor));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_result_at
+SEXP cpp_result_at(SEXP run, std::string name, Rcpp::NumericVector t);
+RcppExport SEXP _skindiff_cpp_result_at(SEXP runSEXP, SEXP nameSEXP, SEXP tSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP >::type run(runSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type t(tSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_result_at(run, name, t));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_result_rate
+SEXP cpp_result_rate(SEXP run, std::string name);
+RcppExport SEXP _skindiff_cpp_result_rate(SEXP runSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP >::type run(runSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_result_rate(run, name));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_result_profile_at
+SEXP cpp_result_profile_at(SEXP run, std::string name, double t);
+RcppExport SEXP _skindiff_cpp_result_profile_at(SEXP runSEXP, SEXP nameSEXP, SEXP tSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP >::type run(runSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< double >::type t(tSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_result_profile_at(run, name, t));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_batch
+double cpp_batch(std::string path, Rcpp::Function next_chunk, int n_chunks, int chunk_rows, int n_threads);
+RcppExport SEXP _skindiff_cpp_batch(SEXP pathSEXP, SEXP next_chunkSEXP, SEXP n_chunksSEXP, SEXP chunk_rowsSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Function >::type next_chunk(next_chunkSEXP);
+    Rcpp::traits::input_parameter< int >::type n_chunks(n_chunksSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_rows(chunk_rowsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_batch(path, next_chunk, n_chunks, chunk_rows, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_sensitivity
+Rcpp::List cpp_sensitivity(Rcpp::List params, std::vector<std::string> paths, std::vector<double> lower, std::vector<double> upper, std::vector<bool> log, std::vector<int> output_kinds, std::vector<double> output_times, int n_base, int n_threads, int chunk);
+RcppExport SEXP _skindiff_cpp_sensitivity(SEXP paramsSEXP, SEXP pathsSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP logSEXP, SEXP output_kindsSEXP, SEXP output_timesSEXP, SEXP n_baseSEXP, SEXP n_threadsSEXP, SEXP chunkSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type paths(pathsSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< std::vector<bool> >::type log(logSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type output_kinds(output_kindsSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type output_times(output_timesSEXP);
+    Rcpp::traits::input_parameter< int >::type n_base(n_baseSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk(chunkSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_sensitivity(params, paths, lower, upper, log, output_kinds, output_times, n_base, n_threads, chunk));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_population
+Rcpp::List cpp_population(Rcpp::List params, std::vector<std::string> paths, std::vector<int> dists, std::vector<double> a, std::vector<double> b, std::vector<double> correlation, std::vector<int> series_kinds, std::vector<std::string> series_names, std::vector<double> times, std::vector<double> probs, int n, double seed, int n_threads, int chunk);
+RcppExport SEXP _skindiff_cpp_population(SEXP paramsSEXP, SEXP pathsSEXP, SEXP distsSEXP, SEXP aSEXP, SEXP bSEXP, SEXP correlationSEXP, SEXP series_kindsSEXP, SEXP series_namesSEXP, SEXP timesSEXP, SEXP probsSEXP, SEXP nSEXP, SEXP seedSEXP, SEXP n_threadsSEXP, SEXP chunkSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type paths(pathsSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type dists(distsSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type a(aSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type b(bSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type correlation(correlationSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type series_kinds(series_kindsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type series_names(series_namesSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type probs(probsSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk(chunkSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_population(params, paths, dists, a, b, correlation, series_kinds, series_names, times, probs, n, seed, n_threads, chunk));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_batch_read
+Rcpp::List cpp_batch_read(std::string path, Rcpp::Nullable<Rcpp::CharacterVector> columns, Rcpp::Nullable<Rcpp::IntegerVector> scenarios);
+RcppExport SEXP _skindiff_cpp_batch_read(SEXP pathSEXP, SEXP columnsSEXP, SEXP scenariosSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::IntegerVector> >::type scenarios(scenariosSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_batch_read(path, columns, scenarios));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_run_tests
+Rcpp::RObject cpp_run_tests();
+RcppExport SEXP _skindiff_cpp_run_tests() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    rcpp_result_gen = Rcpp::wrap(cpp_run_tests());
+    return rcpp_result_gen;
+END_RCPP
+}
+
+static const R_CallMethodDef CallEntries[] = {
+    {"_skindiff_cpp_validate", (DL_FUNC) &_skindiff_cpp_validate, 1},
+    {"_skindiff_cpp_simulate", (DL_FUNC) &_skindiff_cpp_simulate, 4},
+    {"_skindiff_cpp_simulate_batch", (DL_FUNC) &_skindiff_cpp_simulate_batch, 2},
+    {"_skindiff_cpp_fork", (DL_FUNC) &_skindiff_cpp_fork, 4},
+    {"_skindiff_cpp_result_mass", (DL_FUNC) &_skindiff_cpp_result_mass, 2},
+    {"_skindiff_cpp_result_at", (DL_FUNC) &_skindiff_cpp_result_at, 3},
+    {"_skindiff_cpp_result_rate", (DL_FUNC) &_skindiff_cpp_result_rate, 2},
+    {"_skindiff_cpp_result_profile_at", (DL_FUNC) &_skindiff_cpp_result_profile_at, 3},
+    {"_skindiff_cpp_batch", (DL_FUNC) &_skindiff_cpp_batch, 5},
+    {"_skindiff_cpp_sensitivity", (DL_FUNC) &_skindiff_cpp_sensitivity, 10},
+    {"_skindiff_cpp_population", (DL_FUNC) &_skindiff_cpp_population, 14},
+    {"_skindiff_cpp_batch_read", (DL_FUNC) &_skindiff_cpp_batch_read, 3},
+    {"_skindiff_cpp_run_tests", (DL_FUNC) &_skindiff_cpp_run_tests, 0},
+    {NULL, NULL, 0}
+};
+
+void registerAltrep(DllInfo* dll);
+void registerApi(DllInfo* dll);
+RcppExport void R_init_skindiff(DllInfo *dll) {
+    R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
+    R_useDynamicSymbols(dll, FALSE);
+    registerAltrep(dll);
+    registerApi(dll);
+}
@@ -0,0 +1,164 @@
+#include "api.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+
+namespace sc
+{
+    namespace
+    {
+        void copyError(const std::string& msg, char* error, std::size_t error_size)
+        {
+            if (!error || error_size == 0) return;
+            const auto n = std::min(msg.size(), error_size - 1);
+            std::memcpy(error, msg.data(), n);
+            error[n] = '\0';
+        }
+
+        // Forwards the per-minute stop test to the caller's hook.
+        class HookedSystem : public System
+        {
+          public:
+            HookedSystem(Parameters p, api::StopHook hook, void* data)
+                : System(std::move(p)), m_hook(hook), m_data(data)
+            {
+            }
+
+          protected:
+            bool testForStop(int t) override { return m_hook && m_hook(t, m_data); }
+
+          private:
+            api::StopHook m_hook;
+            void*         m_data;
+        };
+    }
+}
+
+extern "C"
+{
+    int skindiff_api_version() { return SKINDIFF_API_VERSION; }
+
+    bool skindiff_validate(const sc::Parameters* p, char* error, std::size_t error_size)
+    {
+        if (auto err = sc::validate(*p))
+        {
+            sc::copyError(*err, error, error_size);
+            return false;
+        }
+        return true;
+    }
+
+    sc::System* skindiff_system_new(const sc::Parameters* p, sc::api::StopHook hook,
+                                    void* data, char* error, std::size_t error_size)
+    {
+        if (!skindiff_validate(p, error, error_size)) return nullptr;
+        try
+        {
+            return new sc::HookedSystem(*p, hook, data);
+        }
+        catch (std::exception& e)
+        {
+            sc::copyError(e.what(), error, error_size);
+        }
+        return nullptr;
+    }
+
+    void skindiff_system_delete(sc::System* sys) { delete sys; }
+
+    int skindiff_system_run(sc::System* sys, char* error, std::size_t error_size)
+    {
+        try
+        {
+            return static_cast<int>(sys->run());
+        }
+        catch (std::exception& e)
+        {
+            sc::copyError(e.what(), error, error_size);
+        }
+        return -1;
+    }
+
+    int skindiff_system_resume(sc::System* sys, const sc::Checkpoint* cp, char* error,
+                               std::size_t error_size)
+    {
+        if (auto err = sys->resumeError(*cp))
+        {
+            sc::copyError(*err, error, error_size);
+            return -1;
+        }
+        try
+        {
+            return static_cast<int>(sys->resume(*cp));
+        }
+        catch (std::exception& e)
+        {
+            sc::copyError(e.what(), error, error_size);
+        }
+        return -1;
+    }
+
+    bool skindiff_system_checkpoint(const sc::System* sys, sc::Checkpoint* out)
+    {
+        auto cp = sys->checkpoint();
+        if (!cp) return false;
+        *out = std::move(*cp);
+        return true;
+    }
+
+    void skindiff_system_metrics(const sc::System* sys, sc::RunMetrics* out)
+    {
+        *out = sys->metrics();
+    }
+
+    bool skindiff_choose_resolution(const sc::Parameters* p, sc::ResolutionChoice* out,
+                                    char* error, std::size_t error_size)
+    {
+        if (!skindiff_validate(p, error, error_size)) return false;
+        if (p->sys.auto_resolution_tol <= 0.0)
+        {
+            sc::copyError("sys.auto_resolution_tol is not set", error, error_size);
+            return false;
+        }
+        try
+        {
+            *out = sc::chooseResolution(*p);
+            return true;
+        }
+        catch (std::exception& e)
+        {
+            sc::copyError(e.what(), error, error_size);
+        }
+        return false;
+    }
+
+    bool skindiff_geometry_create(sc::Geometry* geometry,
+                                  std::vector<sc::Compartment>* compartments, int ss_per_um,
+                                  sc::Sink* sink)
+    {
+        try
+        {
+            return geometry->create(*compartments, ss_per_um, sink);
+        }
+        catch (std::exception&)
+        {
+        }
+        return false;
+    }
+
+    bool skindiff_build_matrix(sc::MatrixBuilder* builder,
+                               const std::vector<sc::Compartment>* compartments,
+                               const sc::Geometry* geometry, sc::Sink* sink)
+    {
+        try
+        {
+            return builder->buildMatrix(*compartments, *geometry, sink);
+        }
+        catch (std::exception&)
+        {
+        }
+        return false;
+    }
+}
@@ -0,0 +1,204 @@
+#include "autoresolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace sc
+{
+    namespace
+    {
+        constexpr int kMaxRefinement = 64;
+
+        // A max_module for which `rate` gives exactly `n_ts` sub-steps.
+        double moduleFor(double rate, int n_ts)
+        {
+            return rate / n_ts * (1.0 + 1e-9);
+        }
+
+        // Final concentration profile (c = K u) over the compartments,
+        // one entry per cell, with the cells' depth intervals.
+        struct Profile
+        {
+            std::vector<double> top;
+            std::vector<double> bottom;
+            std::vector<double> conc;
+        };
+
+        Profile finalProfile(const System& sys)
+        {
+            Profile out;
+            const auto& h = sys.geometry().spaceSteps();
+            const auto& u = sys.concentrations();
+            double depth = 0.0;
+            for (const auto& c : sys.compartments())
+            {
+                for (int i = c.geo_from; i <= c.geo_to; ++i)
+                {
+                    const auto idx = static_cast<std::size_t>(i);
+                    out.top.push_back(depth);
+                    depth += h[idx];
+                    out.bottom.push_back(depth);
+                    out.conc.push_back(c.K * u[idx]);
+                }
+            }
+            return out;
+        }
+
+        // Max-norm distance of `coarse` to the cell averages of `fine` over
+        // the cells of `coarse`.
+        double distance(const Profile& coarse, const Profile& fine)
+        {
+            double dist = 0.0;
+            std::size_t j = 0;
+            for (std::size_t i = 0; i < coarse.conc.size(); ++i)
+            {
+                const auto a = coarse.top[i];
+                const auto b = coarse.bottom[i];
+                double sum = 0.0;
+                while (j < fine.conc.size() && fine.bottom[j] <= a) ++j;
+                for (auto k = j; k < fine.conc.size() && fine.top[k] < b; ++k)
+                {
+                    sum += fine.conc[k] * (std::min(b, fine.bottom[k]) - std::max(a, fine.top[k]));
+                }
+                dist = std::max(dist, std::abs(coarse.conc[i] - sum / (b - a)));
+            }
+            return dist;
+        }
+
+        double peak(const Profile& p)
+        {
+            double m = 0.0;
+            for (const auto c : p.conc) m = std::max(m, std::abs(c));
+            return m;
+        }
+
+        // Spatial and time error of probe A for one output, relative.
+        struct ErrorModel
+        {
+            double space = 0.0;
+            double time  = 0.0;
+        };
+    }
+
+    ResolutionChoice chooseResolution(const Parameters& p, const SystemFactory& make)
+    {
+        auto create = [&make](Parameters q) {
+            return make ? make(std::move(q)) : std::make_unique<System>(std::move(q));
+        };
+
+        // Probes log the sink mass at the start and the end only; the
+        // profile is read off the final state.
+        Parameters base = p;
+        base.sys.auto_resolution_tol = 0.0;
+        base.sink.log_mass           = true;
+        base.log.enabled             = true;
+        base.log.cdp_dir.clear();
+        base.log.mass_log_interval   = p.sys.simulation_time;
+        base.metrics.enabled         = false;
+        base.vehicle.log_mass = false;
+        base.vehicle.log_cdp  = false;
+        for (auto& l : base.layers)
+        {
+            l.log_mass = false;
+            l.log_cdp  = false;
+        }
+
+        const auto r0 = p.sys.resolution;
+        auto probe = [&](int resolution, int n_ts) {
+            Parameters q = base;
+            q.sys.resolution = resolution;
+            if (n_ts > 0)
+            {
+                q.sys.max_module = moduleFor(create(q)->matrixBuilder().maxRate(), n_ts);
+            }
+            return create(std::move(q));
+        };
+        auto run = [](System& sys) {
+            if (sys.run() != System::Result::Executed)
+            {
+                throw std::runtime_error("auto resolution: a probe run did not complete");
+            }
+        };
+
+        auto a = probe(r0, 0);
+        const auto n_a    = a->matrixBuilder().timesteps();
+        const auto rate_a = a->matrixBuilder().maxRate();
+        auto b = probe(2 * r0, n_a);
+        auto c = probe(r0, 2 * n_a);
+        run(*a);
+        run(*b);
+        run(*c);
+
+        const auto order   = p.sys.compact_scheme ? 4.0 : 2.0;
+        const auto s_ratio = 1.0 - std::pow(2.0, -order);
+        const auto t_ratio = 0.75;
+
+        const auto sink_a = a->sinkMass().values.back();
+        const auto sink_b = b->sinkMass().values.back();
+        const auto sink_c = c->sinkMass().values.back();
+        const auto sink_scale = std::max({std::abs(sink_a), std::abs(sink_b), std::abs(sink_c)});
+        ErrorModel sink;
+        if (sink_scale > 0.0)
+        {
+            sink.space = std::abs(sink_a - sink_b) / s_ratio / sink_scale;
+            sink.time  = std::abs(sink_a - sink_c) / t_ratio / sink_scale;
+        }
+
+        const auto prof_a = finalProfile(*a);
+        const auto cdp_scale = peak(prof_a);
+        ErrorModel cdp;
+        if (cdp_scale > 0.0)
+        {
+            cdp.space = distance(prof_a, finalProfile(*b)) / s_ratio / cdp_scale;
+            cdp.time  = distance(prof_a, finalProfile(*c)) / t_ratio / cdp_scale;
+        }
+
+        // Error of output `m` at resolution r with n sub-steps per minute,
+        // and the fewest sub-steps that keep it within the tolerance (0 if
+        // the spatial part alone exceeds it).
+        const auto tol = p.sys.auto_resolution_tol;
+        auto error = [&](const ErrorModel& m, int r, int n) {
+            const auto rn = static_cast<double>(n_a) / n;
+            return m.space * std::pow(static_cast<double>(r0) / r, order) + m.time * rn * rn;
+        };
+        auto subSteps = [&](const ErrorModel& m, int r) {
+            const auto left = tol - m.space * std::pow(static_cast<double>(r0) / r, order);
+            if (left <= 0.0) return 0;
+            return std::max(1, static_cast<int>(std::ceil(n_a * std::sqrt(m.time / left))));
+        };
+
+        int best_r = 0, best_n = 0;
+        for (int r = r0; r <= kMaxRefinement * r0; ++r)
+        {
+            const auto n_s = subSteps(sink, r);
+            const auto n_c = subSteps(cdp, r);
+            if (n_s == 0 || n_c == 0) continue;
+            const auto n = std::max(n_s, n_c);
+            if (best_r == 0 || static_cast<double>(r) * n < static_cast<double>(best_r) * best_n)
+            {
+                best_r = r;
+                best_n = n;
+            }
+        }
+        if (best_r == 0)
+        {
+            // Out of reach: the finest mesh with time errors at half the
+            // tolerance.
+            best_r = kMaxRefinement * r0;
+            const auto t = std::max(sink.time, cdp.time);
+            best_n = std::max(1, static_cast<int>(std::ceil(n_a * std::sqrt(2.0 * t / tol))));
+        }
+
+        ResolutionChoice out;
+        out.resolution = best_r;
+        out.max_module = best_r == r0
+            ? moduleFor(rate_a, best_n)
+            : moduleFor(probe(best_r, 0)->matrixBuilder().maxRate(), best_n);
+        out.sink_error = error(sink, best_r, best_n);
+        out.cdp_error  = error(cdp, best_r, best_n);
+        return out;
+    }
+}
@@ -0,0 +1,351 @@
+#include "batchstore.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace sc
+{
+    namespace
+    {
+        constexpr char          kMagic[8]  = {'S', 'K', 'D', 'B', 'A', 'T', 'C', 'H'};
+        constexpr std::uint32_t kVersion   = 1;
+        constexpr std::uint32_t kByteOrder = 0x01020304;
+        // Header position of the chunk index offset, 0 until closed.
+        constexpr std::uint64_t kIndexAt = 16;
+
+        template <typename T>
+        void put(std::ostream& out, T v)
+        {
+            out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        template <typename T>
+        void putAll(std::ostream& out, const std::vector<T>& v)
+        {
+            out.write(reinterpret_cast<const char*>(v.data()),
+                      static_cast<std::streamsize>(v.size() * sizeof(T)));
+        }
+    }
+
+    BatchWriter::BatchWriter(const std::string& path, std::vector<BatchColumn> columns,
+                             std::size_t chunk_rows)
+        : m_path(path)
+        , m_columns(std::move(columns))
+        , m_chunk_rows(std::max<std::size_t>(1, chunk_rows))
+    {
+        for (const auto& c : m_columns)
+        {
+            if (c.kind == BatchColumn::Kind::Int)    ++m_n_int;
+            if (c.kind == BatchColumn::Kind::Double) ++m_n_double;
+            if (c.kind == BatchColumn::Kind::Series) ++m_n_series;
+        }
+        m_ints.resize(m_n_int);
+        m_doubles.resize(m_n_double);
+        m_series_offsets.assign(m_n_series, {0});
+        m_series_values.resize(m_n_series);
+
+        m_out.open(path, std::ios::binary | std::ios::trunc);
+        if (m_out)
+        {
+            m_out.write(kMagic, sizeof(kMagic));
+            put(m_out, kVersion);
+            put(m_out, kByteOrder);
+            put<std::uint64_t>(m_out, 0);
+            put<std::uint64_t>(m_out, m_columns.size());
+            for (const auto& c : m_columns)
+            {
+                put(m_out, static_cast<std::uint8_t>(c.kind));
+                put<std::uint64_t>(m_out, c.name.size());
+                m_out.write(c.name.data(), static_cast<std::streamsize>(c.name.size()));
+            }
+        }
+        if (!m_out) throw std::runtime_error("cannot write batch file " + m_path);
+    }
+
+    BatchWriter::~BatchWriter()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void BatchWriter::add(const BatchRow& row)
+    {
+        if (row.ints.size() != m_n_int || row.doubles.size() != m_n_double ||
+            row.series.size() != m_n_series)
+        {
+            throw std::invalid_argument("batch row does not match the columns");
+        }
+        for (std::size_t k = 0; k < m_n_int; ++k) m_ints[k].push_back(row.ints[k]);
+        for (std::size_t k = 0; k < m_n_double; ++k) m_doubles[k].push_back(row.doubles[k]);
+        for (std::size_t k = 0; k < m_n_series; ++k)
+        {
+            auto& values = m_series_values[k];
+            values.insert(values.end(), row.series[k].begin(), row.series[k].end());
+            m_series_offsets[k].push_back(values.size());
+        }
+        ++m_rows;
+        if (++m_pending == m_chunk_rows) flushChunk();
+    }
+
+    void BatchWriter::flushChunk()
+    {
+        if (m_pending == 0) return;
+        const auto start = static_cast<std::uint64_t>(m_out.tellp());
+
+        // Row count, then where each column starts relative to the chunk.
+        std::vector<std::uint64_t> at;
+        std::uint64_t pos = sizeof(std::uint64_t) * (1 + m_columns.size());
+        std::size_t s = 0;
+        for (const auto& c : m_columns)
+        {
+            at.push_back(pos);
+            pos += sizeof(std::uint64_t) * m_pending;
+            if (c.kind == BatchColumn::Kind::Series)
+            {
+                pos += sizeof(std::uint64_t) + sizeof(double) * m_series_values[s++].size();
+            }
+        }
+        put<std::uint64_t>(m_out, m_pending);
+        putAll(m_out, at);
+
+        std::size_t i = 0, d = 0;
+        s = 0;
+        for (const auto& c : m_columns)
+        {
+            switch (c.kind)
+            {
+                case BatchColumn::Kind::Int:
+                    putAll(m_out, m_ints[i]);
+                    m_ints[i++].clear();
+                    break;
+                case BatchColumn::Kind::Double:
+                    putAll(m_out, m_doubles[d]);
+                    m_doubles[d++].clear();
+                    break;
+                case BatchColumn::Kind::Series:
+                    putAll(m_out, m_series_offsets[s]);
+                    putAll(m_out, m_series_values[s]);
+                    m_series_offsets[s].assign(1, 0);
+                    m_series_values[s++].clear();
+                    break;
+            }
+        }
+        if (!m_out) throw std::runtime_error("cannot write batch file " + m_path);
+        m_index_offsets.push_back(start);
+        m_index_rows.push_back(m_pending);
+        m_pending = 0;
+    }
+
+    void BatchWriter::close()
+    {
+        if (!m_out.is_open()) return;
+        flushChunk();
+        const auto index_at = static_cast<std::uint64_t>(m_out.tellp());
+        put<std::uint64_t>(m_out, m_index_offsets.size());
+        for (std::size_t k = 0; k < m_index_offsets.size(); ++k)
+        {
+            put(m_out, m_index_offsets[k]);
+            put(m_out, m_index_rows[k]);
+        }
+        m_out.seekp(static_cast<std::streamoff>(kIndexAt));
+        put(m_out, index_at);
+        m_out.close();
+        if (!m_out) throw std::runtime_error("cannot write batch file " + m_path);
+    }
+
+    std::unique_ptr<BatchReader> BatchReader::open(const std::string& path)
+    {
+        std::unique_ptr<BatchReader> r(new BatchReader());
+        r->m_in.open(path, std::ios::binary);
+        if (!r->m_in || !r->m_in.seekg(0, std::ios::end)) return nullptr;
+        r->m_size = static_cast<std::uint64_t>(r->m_in.tellg());
+
+        try
+        {
+            std::uint64_t pos = 0;
+            auto get = [&](auto& v) {
+                r->read(pos, &v, sizeof(v));
+                pos += sizeof(v);
+            };
+            char          magic[sizeof(kMagic)];
+            std::uint32_t version = 0, order = 0;
+            std::uint64_t index_at = 0, n_columns = 0;
+            get(magic);
+            get(version);
+            get(order);
+            get(index_at);
+            get(n_columns);
+            if (!std::equal(magic, magic + sizeof(kMagic), kMagic) || version != kVersion ||
+                order != kByteOrder || index_at == 0 || n_columns > r->m_size)
+            {
+                return nullptr;
+            }
+            for (std::uint64_t k = 0; k < n_columns; ++k)
+            {
+                std::uint8_t  kind = 0;
+                std::uint64_t len  = 0;
+                get(kind);
+                get(len);
+                if (kind > static_cast<std::uint8_t>(BatchColumn::Kind::Series) ||
+                    len > r->m_size)
+                {
+                    return nullptr;
+                }
+                BatchColumn c;
+                c.kind = static_cast<BatchColumn::Kind>(kind);
+                c.name.resize(static_cast<std::size_t>(len));
+                r->read(pos, c.name.data(), c.name.size());
+                pos += len;
+                r->m_columns.push_back(std::move(c));
+            }
+
+            pos = index_at;
+            std::uint64_t n_chunks = 0;
+            get(n_chunks);
+            if (n_chunks > r->m_size / (2 * sizeof(std::uint64_t))) return nullptr;
+            std::uint64_t first = 0;
+            for (std::uint64_t k = 0; k < n_chunks; ++k)
+            {
+                Chunk c;
+                get(c.offset);
+                get(c.rows);
+                if (c.offset >= index_at || c.rows > r->m_size) return nullptr;
+                c.first = first;
+                first += c.rows;
+                r->m_chunks.push_back(c);
+            }
+            r->m_rows = static_cast<std::size_t>(first);
+        }
+        catch (const std::runtime_error&)
+        {
+            return nullptr;
+        }
+        return r;
+    }
+
+    int BatchReader::find(const std::string& name) const noexcept
+    {
+        for (std::size_t k = 0; k < m_columns.size(); ++k)
+        {
+            if (m_columns[k].name == name) return static_cast<int>(k);
+        }
+        return -1;
+    }
+
+    void BatchReader::read(std::uint64_t at, void* dst, std::size_t bytes)
+    {
+        if (at > m_size || bytes > m_size - at)
+        {
+            throw std::runtime_error("batch file is truncated");
+        }
+        m_in.clear();
+        m_in.seekg(static_cast<std::streamoff>(at));
+        m_in.read(static_cast<char*>(dst), static_cast<std::streamsize>(bytes));
+        if (!m_in) throw std::runtime_error("cannot read batch file");
+    }
+
+    std::uint64_t BatchReader::columnAt(const Chunk& c, std::size_t col)
+    {
+        std::uint64_t at = 0;
+        read(c.offset + sizeof(std::uint64_t) * (1 + col), &at, sizeof(at));
+        return c.offset + at;
+    }
+
+    template <typename Fun>
+    void BatchReader::byChunk(std::size_t col, BatchColumn::Kind kind,
+                              const std::vector<std::size_t>& rows, Fun&& fun)
+    {
+        if (col >= m_columns.size() || m_columns[col].kind != kind)
+        {
+            throw std::out_of_range("batch column " + std::to_string(col));
+        }
+        for (const auto row : rows)
+        {
+            if (row >= m_rows) throw std::out_of_range("batch row " + std::to_string(row));
+        }
+
+        std::vector<std::size_t> order(rows.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::sort(order.begin(), order.end(),
+                  [&rows](std::size_t a, std::size_t b) { return rows[a] < rows[b]; });
+
+        std::size_t c = 0;
+        for (std::size_t k = 0; k < order.size();)
+        {
+            while (m_chunks[c].first + m_chunks[c].rows <= rows[order[k]]) ++c;
+            const auto& chunk = m_chunks[c];
+            std::vector<std::size_t> local, positions;
+            for (; k < order.size() && rows[order[k]] < chunk.first + chunk.rows; ++k)
+            {
+                local.push_back(static_cast<std::size_t>(rows[order[k]] - chunk.first));
+                positions.push_back(order[k]);
+            }
+            fun(chunk, local, positions);
+        }
+    }
+
+    std::vector<std::int64_t> BatchReader::ints(std::size_t col,
+                                                const std::vector<std::size_t>& rows)
+    {
+        std::vector<std::int64_t> out(rows.size());
+        byChunk(col, BatchColumn::Kind::Int, rows,
+                [&](const Chunk& c, const auto& local, const auto& positions) {
+                    std::vector<std::int64_t> block(static_cast<std::size_t>(c.rows));
+                    read(columnAt(c, col), block.data(), block.size() * sizeof(std::int64_t));
+                    for (std::size_t j = 0; j < local.size(); ++j)
+                    {
+                        out[positions[j]] = block[local[j]];
+                    }
+                });
+        return out;
+    }
+
+    std::vector<double> BatchReader::doubles(std::size_t col,
+                                             const std::vector<std::size_t>& rows)
+    {
+        std::vector<double> out(rows.size());
+        byChunk(col, BatchColumn::Kind::Double, rows,
+                [&](const Chunk& c, const auto& local, const auto& positions) {
+                    std::vector<double> block(static_cast<std::size_t>(c.rows));
+                    read(columnAt(c, col), block.data(), block.size() * sizeof(double));
+                    for (std::size_t j = 0; j < local.size(); ++j)
+                    {
+                        out[positions[j]] = block[local[j]];
+                    }
+                });
+        return out;
+    }
+
+    std::vector<std::vector<double>> BatchReader::series(std::size_t col,
+                                                         const std::vector<std::size_t>& rows)
+    {
+        std::vector<std::vector<double>> out(rows.size());
+        byChunk(col, BatchColumn::Kind::Series, rows,
+                [&](const Chunk& c, const auto& local, const auto& positions) {
+                    const auto at = columnAt(c, col);
+                    std::vector<std::uint64_t> offsets(static_cast<std::size_t>(c.rows) + 1);
+                    read(at, offsets.data(), offsets.size() * sizeof(std::uint64_t));
+                    const auto values = at + offsets.size() * sizeof(std::uint64_t);
+                    for (std::size_t j = 0; j < local.size(); ++j)
+                    {
+                        const auto from = offsets[local[j]];
+                        const auto to   = offsets[local[j] + 1];
+                        if (to < from || to > m_size / sizeof(double))
+                        {
+                            throw std::runtime_error("batch file is damaged");
+                        }
+                        auto& v = out[positions[j]];
+                        v.resize(static_cast<std::size_t>(to - from));
+                        read(values + from * sizeof(double), v.data(), v.size() * sizeof(double));
+                    }
+                });
+        return out;
+    }
+}
@@ -0,0 +1,567 @@
+#include "brick.h"
+
+#include "algorithms.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace sc
+{
+    namespace
+    {
+        // Conductance of the face between two cells of widths h_a, h_b
+        // (normal to the face) and conductivities k_a, k_b = K * D.
+        double harmonic(double k_a, double h_a, double k_b, double h_b) noexcept
+        {
+            const auto den = h_a * k_b + h_b * k_a;
+            return den > 0.0 ? 2.0 * k_a * k_b / den : 0.0;
+        }
+
+        // Runs fun(begin, end) over [0, n) cut into one chunk per worker.
+        template <typename Fun>
+        void sweep(int n, int workers, Fun&& fun)
+        {
+            const auto chunks = std::min(n, workers);
+            parallelFor(chunks, workers, [&](int c)
+            {
+                fun(n * c / chunks, n * (c + 1) / chunks);
+            });
+        }
+    }
+
+    // ===========================================================================
+    // Mesh of the half-period unit cell, X = (width + mortar) / 2 wide.
+    //
+    // Laterally there are three segments: [0, m/2] (mortar_cells columns),
+    // [m/2, w/2] (lateral_cells) and [w/2, X] (mortar_cells). Vertically
+    // the layer alternates mortar rows and brick courses, starting and
+    // ending with mortar; N courses of thickness t' >= t fill the height
+    // exactly. Even courses have a brick over [0, w/2] and a vertical gap
+    // over [w/2, X]; odd courses are shifted by half a period, with the
+    // gap over [0, m/2] and a brick over [m/2, X].
+    //
+    // Column j stands for the fraction f_j = dx_j / X of the layer's area,
+    // so a cell's capacity is K * A * f_j * dy_i, its vertical face area
+    // A * f_j and its lateral face area A * dy_i / X.
+    // ===========================================================================
+    std::vector<double> BrickLayer::buildMesh(const BrickParams& brick, const Compartment& comp)
+    {
+        const auto w = brick.width;
+        const auto m = brick.mortar;
+        const auto h = static_cast<double>(comp.height_um);
+        const auto X = 0.5 * (w + m);
+        const auto A = comp.area_um2;
+
+        std::vector<double> dx;
+        std::vector<int>    col_seg;
+        const double seg_len[3] = {0.5 * m, 0.5 * (w - m), 0.5 * m};
+        const int    seg_n[3]   = {brick.mortar_cells, brick.lateral_cells, brick.mortar_cells};
+        for (int s = 0; s < 3; ++s)
+        {
+            for (int k = 0; k < seg_n[s]; ++k)
+            {
+                dx.push_back(seg_len[s] / seg_n[s]);
+                col_seg.push_back(s);
+            }
+        }
+        m_nx = static_cast<int>(dx.size());
+
+        const auto n_courses = std::max(1, static_cast<int>(std::floor((h - m) /
+                                                                       (brick.thickness + m))));
+        const auto t = (h - (n_courses + 1) * m) / n_courses;
+        std::vector<int> row_course;   // -1 = mortar row
+        m_dy.clear();
+        for (int c = 0; c <= n_courses; ++c)
+        {
+            for (int k = 0; k < brick.mortar_cells; ++k)
+            {
+                m_dy.push_back(m / brick.mortar_cells);
+                row_course.push_back(-1);
+            }
+            if (c == n_courses) break;
+            for (int k = 0; k < brick.brick_cells; ++k)
+            {
+                m_dy.push_back(t / brick.brick_cells);
+                row_course.push_back(c % 2);
+            }
+        }
+        m_ny = static_cast<int>(m_dy.size());
+
+        m_x.assign(static_cast<std::size_t>(m_nx), 0.0);
+        m_f.assign(static_cast<std::size_t>(m_nx), 0.0);
+        double pos = 0.0;
+        for (std::size_t j = 0; j < dx.size(); ++j)
+        {
+            m_x[j] = pos + 0.5 * dx[j];
+            m_f[j] = dx[j] / X;
+            pos += dx[j];
+        }
+        m_y.assign(static_cast<std::size_t>(m_ny), 0.0);
+        pos = 0.0;
+        for (std::size_t i = 0; i < m_dy.size(); ++i)
+        {
+            m_y[i] = pos + 0.5 * m_dy[i];
+            pos += m_dy[i];
+        }
+
+        const auto cells = static_cast<std::size_t>(m_nx) * static_cast<std::size_t>(m_ny);
+        std::vector<double> kd(cells);
+        m_K.assign(cells, 0.0);
+        m_w.assign(cells, 0.0);
+        for (int i = 0; i < m_ny; ++i)
+        {
+            const auto course = row_course[static_cast<std::size_t>(i)];
+            for (int j = 0; j < m_nx; ++j)
+            {
+                const auto seg      = col_seg[static_cast<std::size_t>(j)];
+                const auto is_brick = course == 0 ? seg <= 1 : (course == 1 && seg >= 1);
+                const auto K        = is_brick ? brick.K_brick : comp.K;
+                const auto D        = is_brick ? brick.D_brick : comp.D;
+                const auto k        = at(i, j);
+                kd[k]  = K * D;
+                m_K[k] = K;
+                m_w[k] = K * A * m_f[static_cast<std::size_t>(j)] *
+                         m_dy[static_cast<std::size_t>(i)];
+            }
+        }
+
+        m_gx.assign(static_cast<std::size_t>(m_ny) * static_cast<std::size_t>(m_nx - 1), 0.0);
+        for (int i = 0; i < m_ny; ++i)
+        {
+            const auto face = A * m_dy[static_cast<std::size_t>(i)] / X;
+            for (int j = 0; j + 1 < m_nx; ++j)
+            {
+                m_gx[static_cast<std::size_t>(i * (m_nx - 1) + j)] =
+                    face * harmonic(kd[at(i, j)], dx[static_cast<std::size_t>(j)],
+                                    kd[at(i, j + 1)], dx[static_cast<std::size_t>(j + 1)]);
+            }
+        }
+        m_gy.assign(static_cast<std::size_t>(m_ny - 1) * static_cast<std::size_t>(m_nx), 0.0);
+        for (int i = 0; i + 1 < m_ny; ++i)
+        {
+            for (int j = 0; j < m_nx; ++j)
+            {
+                m_gy[at(i, j)] = A * m_f[static_cast<std::size_t>(j)] *
+                    harmonic(kd[at(i, j)], m_dy[static_cast<std::size_t>(i)],
+                             kd[at(i + 1, j)], m_dy[static_cast<std::size_t>(i + 1)]);
+            }
+        }
+        return kd;
+    }
+
+    // ===========================================================================
+    // Faces to the 1-D stack. Column j sees a strip f_j of the cell above
+    // (v) and below (d). A Dirichlet neighbour -- clamped or lumped donor
+    // above, sink below -- puts all resistance on the 2-D side, as in
+    // MatrixBuilder. The 1-D faces into the layer are cut out of the
+    // operator (their flux moved onto the diagonal for v / d, to be
+    // replaced by the 2-D faces), which leaves the layer's own 1-D rows
+    // unused.
+    // ===========================================================================
+    void BrickLayer::buildCoupling(const std::vector<Compartment>& compartments,
+                                   std::size_t layer, const Geometry& geometry,
+                                   const Sink& sink, const TDMatrix& op,
+                                   const std::vector<double>& kd)
+    {
+        const auto& comp  = compartments[layer];
+        const auto& above = compartments[layer - 1];
+        const auto& donor = compartments.front();
+        const auto& ss    = geometry.spaceSteps();
+
+        m_from = comp.geo_from;
+        m_to   = comp.geo_to;
+        m_v    = m_from - 1;
+        m_d    = m_to + 1;
+        m_gap  = m_d - m_v - 1;
+        m_K_layer = comp.K;
+
+        m_edges.assign(1, 0.0);
+        for (int i = m_from; i <= m_to; ++i)
+        {
+            m_edges.push_back(m_edges.back() + ss[static_cast<std::size_t>(i)]);
+        }
+
+        const auto v_in_donor    = m_v <= donor.geo_to;
+        const auto top_dirichlet = v_in_donor && (!donor.finite_dose || donor.lumped);
+        m_top_clamped = v_in_donor && !donor.finite_dose;
+        m_sink_below  = m_d == sink.geo_from;
+
+        const auto h_v = ss[static_cast<std::size_t>(m_v)];
+        const auto h_d = ss[static_cast<std::size_t>(m_d)];
+        m_w_v = above.K * above.area_um2 * h_v;
+        // The sink cell has K = 1 and inherits the area of the cell above.
+        m_w_d = m_sink_below ? comp.area_um2 * h_d
+                             : compartments[layer + 1].K * compartments[layer + 1].area_um2 * h_d;
+
+        const auto A      = comp.area_um2;
+        const auto kap_v  = above.K * above.area_um2 * above.D;
+        const auto dy_top = m_dy.front();
+        const auto dy_bot = m_dy.back();
+        m_a_top.assign(static_cast<std::size_t>(m_nx), 0.0);
+        m_a_bot.assign(static_cast<std::size_t>(m_nx), 0.0);
+        for (int j = 0; j < m_nx; ++j)
+        {
+            const auto f     = m_f[static_cast<std::size_t>(j)];
+            const auto kap_t = kd[at(0, j)] * A;
+            const auto kap_b = kd[at(m_ny - 1, j)] * A;
+            m_a_top[static_cast<std::size_t>(j)] =
+                top_dirichlet ? f * 2.0 * kap_t / dy_top
+                              : f * harmonic(kap_v, h_v, kap_t, dy_top);
+            if (m_sink_below)
+            {
+                m_a_bot[static_cast<std::size_t>(j)] = f * 2.0 * kap_b / dy_bot;
+            }
+            else
+            {
+                const auto& below = compartments[layer + 1];
+                const auto kap_d  = below.K * below.area_um2 * below.D;
+                m_a_bot[static_cast<std::size_t>(j)] = f * harmonic(kap_b, dy_bot, kap_d, h_d);
+            }
+        }
+
+        m_op = op;
+        if (!m_top_clamped)
+        {
+            m_op.diag(m_v) += m_op.upper(m_v);
+            m_op.upper(m_v) = 0.0;
+        }
+        if (!m_sink_below)
+        {
+            m_op.diag(m_d) += m_op.lower(m_d - 1);
+        }
+        m_op.lower(m_d - 1) = 0.0;
+    }
+
+    void BrickLayer::buildStepMatrices(int n_ts, double max_module)
+    {
+        const auto nx  = static_cast<std::size_t>(m_nx);
+        const auto ny  = static_cast<std::size_t>(m_ny);
+        const auto sum = [](const std::vector<double>& v)
+        {
+            double s = 0.0;
+            for (const auto x : v) s += x;
+            return s;
+        };
+        const auto a_top_sum = sum(m_a_top);
+        const auto a_bot_sum = sum(m_a_bot);
+
+        // Sub-steps: the same module bound as the 1-D stack, applied to the
+        // fastest 2-D cell and to the coupled cells v / d.
+        double max_rate = m_top_clamped ? 0.0 : -m_op.diag(m_v) + a_top_sum / m_w_v;
+        if (!m_sink_below) max_rate = std::max(max_rate, -m_op.diag(m_d) + a_bot_sum / m_w_d);
+        for (int i = 0; i < m_ny; ++i)
+        {
+            for (int j = 0; j < m_nx; ++j)
+            {
+                double g = 0.0;
+                if (j > 0)        g += m_gx[static_cast<std::size_t>(i * (m_nx - 1) + j - 1)];
+                if (j + 1 < m_nx) g += m_gx[static_cast<std::size_t>(i * (m_nx - 1) + j)];
+                g += i > 0        ? m_gy[at(i - 1, j)] : m_a_top[static_cast<std::size_t>(j)];
+                g += i + 1 < m_ny ? m_gy[at(i, j)]     : m_a_bot[static_cast<std::size_t>(j)];
+                max_rate = std::max(max_rate, g / m_w[at(i, j)]);
+            }
+        }
+        m_n_sub = std::max(n_ts, static_cast<int>(std::ceil(max_rate / max_module)));
+        m_tau   = 0.5 / m_n_sub;
+        const auto tau = m_tau;
+
+        // Row sweeps: (W - tau Lx) per row.
+        m_row_mat.assign(ny, TDMatrix(m_nx));
+        for (int i = 0; i < m_ny; ++i)
+        {
+            auto& T = m_row_mat[static_cast<std::size_t>(i)];
+            for (int j = 0; j < m_nx; ++j)
+            {
+                T.diag(j) = m_w[at(i, j)];
+            }
+            for (int j = 0; j + 1 < m_nx; ++j)
+            {
+                const auto g = tau * m_gx[static_cast<std::size_t>(i * (m_nx - 1) + j)];
+                T.diag(j)     += g;
+                T.diag(j + 1) += g;
+                T.upper(j)     = -g;
+                T.lower(j)     = -g;
+            }
+            algorithm::prepareThomas(T);
+        }
+
+        // Column sweeps: (W - tau Ly) per column, with the faces to v / d on
+        // the end rows, and the column responses to unit u_v / u_d.
+        m_col_mat.assign(nx, TDMatrix(m_ny));
+        m_z_top.assign(nx * ny, 0.0);
+        m_z_bot.assign(nx * ny, 0.0);
+        std::vector<double> line(ny);
+        for (int j = 0; j < m_nx; ++j)
+        {
+            const auto ju = static_cast<std::size_t>(j);
+            auto& T = m_col_mat[ju];
+            for (int i = 0; i < m_ny; ++i)
+            {
+                T.diag(i) = m_w[at(i, j)];
+            }
+            T.diag(0)        += tau * m_a_top[ju];
+            T.diag(m_ny - 1) += tau * m_a_bot[ju];
+            for (int i = 0; i + 1 < m_ny; ++i)
+            {
+                const auto g = tau * m_gy[at(i, j)];
+                T.diag(i)     += g;
+                T.diag(i + 1) += g;
+                T.upper(i)     = -g;
+                T.lower(i)     = -g;
+            }
+            algorithm::prepareThomas(T);
+
+            std::fill(line.begin(), line.end(), 0.0);
+            line.front() = tau * m_a_top[ju];
+            algorithm::thomasReUseIP(static_cast<const TDMatrix&>(T), line);
+            std::copy(line.begin(), line.end(), m_z_top.begin() + static_cast<long>(ju * ny));
+            if (!m_sink_below)
+            {
+                std::fill(line.begin(), line.end(), 0.0);
+                line.back() = tau * m_a_bot[ju];
+                algorithm::thomasReUseIP(static_cast<const TDMatrix&>(T), line);
+                std::copy(line.begin(), line.end(), m_z_bot.begin() + static_cast<long>(ju * ny));
+            }
+        }
+
+        // Compact 1-D system (I - tau A) over the cells outside the layer,
+        // v and d adjacent, with the columns eliminated into rows v / d.
+        const auto N = m_op.size();
+        const auto M = N - m_gap;
+        m_compact = TDMatrix(M);
+        for (int i = 0; i < N; ++i)
+        {
+            if (i >= m_from && i <= m_to) continue;
+            const auto r = compact(i);
+            m_compact.diag(r) = 1.0 - tau * m_op.diag(i);
+            if (r + 1 < M && i != m_v) m_compact.upper(r)     = -tau * m_op.upper(i);
+            if (r > 0 && i != m_d)     m_compact.lower(r - 1) = -tau * m_op.lower(i - 1);
+        }
+
+        double top_top = 0.0, top_bot = 0.0, bot_top = 0.0, bot_bot = 0.0;
+        for (std::size_t j = 0; j < nx; ++j)
+        {
+            top_top += m_a_top[j] * m_z_top[j * ny];
+            top_bot += m_a_top[j] * m_z_bot[j * ny];
+            bot_top += m_a_bot[j] * m_z_top[j * ny + ny - 1];
+            bot_bot += m_a_bot[j] * m_z_bot[j * ny + ny - 1];
+        }
+        const auto cv = compact(m_v);
+        if (!m_top_clamped)
+        {
+            m_compact.diag(cv)  += tau / m_w_v * (a_top_sum - top_top);
+            m_compact.upper(cv) -= tau / m_w_v * top_bot;
+        }
+        if (!m_sink_below)
+        {
+            m_compact.diag(cv + 1) += tau / m_w_d * (a_bot_sum - bot_bot);
+        }
+        m_compact.lower(cv) -= tau / m_w_d * bot_top;
+        algorithm::prepareThomas(m_compact);
+
+        m_rhs.assign(static_cast<std::size_t>(M), 0.0);
+        m_s_star.assign(nx * ny, 0.0);
+    }
+
+    bool BrickLayer::build(const BrickParams& brick, const std::vector<Compartment>& compartments,
+                           std::size_t layer, const Geometry& geometry, const Sink& sink,
+                           const TDMatrix& op, int n_ts, double max_module, int n_threads)
+    {
+        if (layer == 0 || layer >= compartments.size()) return false;
+        const auto& comp = compartments[layer];
+        if (brick.width <= brick.mortar ||
+            brick.thickness + 2.0 * brick.mortar > static_cast<double>(comp.height_um))
+        {
+            return false;
+        }
+
+        const auto kd = buildMesh(brick, comp);
+        buildCoupling(compartments, layer, geometry, sink, op, kd);
+        buildStepMatrices(n_ts, max_module);
+        m_s.assign(m_w.size(), 0.0);
+
+        // Every sweep is O(cells) of cheap work; below a few thousand cells
+        // per thread, starting the threads costs more than it saves.
+        const auto cells = static_cast<int>(m_w.size());
+        m_workers = std::max(1, std::min(resolveThreads(n_threads), cells / 4096));
+        return true;
+    }
+
+    void BrickLayer::init(const std::vector<double>& state)
+    {
+        const auto n1    = static_cast<int>(m_edges.size()) - 1;
+        const auto scale = m_edges.back() / (m_y.back() + 0.5 * m_dy.back());
+        int k = 0;
+        for (int i = 0; i < m_ny; ++i)
+        {
+            const auto y = m_y[static_cast<std::size_t>(i)] * scale;
+            while (k + 1 < n1 && m_edges[static_cast<std::size_t>(k + 1)] <= y) ++k;
+            const auto u = state[static_cast<std::size_t>(m_from + k)];
+            for (int j = 0; j < m_nx; ++j) m_s[at(i, j)] = u;
+        }
+    }
+
+    void BrickLayer::advanceMinute(std::vector<double>& state)
+    {
+        for (int ts = 0; ts < m_n_sub; ++ts) step(state);
+    }
+
+    void BrickLayer::step(std::vector<double>& state)
+    {
+        const auto tau = m_tau;
+        const auto ny  = static_cast<std::size_t>(m_ny);
+        const auto u_v = state[static_cast<std::size_t>(m_v)];
+        const auto u_d = m_sink_below ? 0.0 : state[static_cast<std::size_t>(m_d)];
+
+        // ---- Half-step 1: lateral implicit, vertical explicit ----
+        sweep(m_ny, m_workers, [&](int i0, int i1)
+        {
+            std::vector<double> line(static_cast<std::size_t>(m_nx));
+            for (int i = i0; i < i1; ++i)
+            {
+                for (int j = 0; j < m_nx; ++j)
+                {
+                    const auto k = at(i, j);
+                    const auto s = m_s[k];
+                    double flux  = i > 0 ? m_gy[at(i - 1, j)] * (m_s[at(i - 1, j)] - s)
+                                         : m_a_top[static_cast<std::size_t>(j)] * (u_v - s);
+                    flux += i + 1 < m_ny ? m_gy[k] * (m_s[at(i + 1, j)] - s)
+                                         : m_a_bot[static_cast<std::size_t>(j)] * (u_d - s);
+                    line[static_cast<std::size_t>(j)] = m_w[k] * s + tau * flux;
+                }
+                algorithm::thomasReUseIP(m_row_mat[static_cast<std::size_t>(i)], line);
+                std::copy(line.begin(), line.end(), m_s_star.begin() + static_cast<long>(at(i, 0)));
+            }
+        });
+
+        // The 1-D cells have no lateral part: explicit vertical half-step.
+        const auto N = m_op.size();
+        for (int i = 0; i < N; ++i)
+        {
+            if (i >= m_from && i <= m_to) continue;
+            const auto idx = static_cast<std::size_t>(i);
+            double a = m_op.diag(i) * state[idx];
+            if (i > 0)     a += m_op.lower(i - 1) * state[idx - 1];
+            if (i + 1 < N) a += m_op.upper(i) * state[idx + 1];
+            m_rhs[static_cast<std::size_t>(compact(i))] = state[idx] + tau * a;
+        }
+        const auto cv = static_cast<std::size_t>(compact(m_v));
+        double flux_top = 0.0, flux_bot = 0.0;
+        for (int j = 0; j < m_nx; ++j)
+        {
+            const auto ju = static_cast<std::size_t>(j);
+            flux_top += m_a_top[ju] * (m_s[at(0, j)] - u_v);
+            flux_bot += m_a_bot[ju] * (m_s[at(m_ny - 1, j)] - u_d);
+        }
+        if (!m_top_clamped) m_rhs[cv] += tau / m_w_v * flux_top;
+        m_rhs[cv + 1] += tau / m_w_d * flux_bot;
+
+        // ---- Half-step 2: vertical implicit, lateral explicit ----
+        // Each column is solved with u_v = u_d = 0 first; the boundary
+        // responses are added once the compact system has given u_v, u_d.
+        sweep(m_nx, m_workers, [&](int j0, int j1)
+        {
+            std::vector<double> line(ny);
+            for (int j = j0; j < j1; ++j)
+            {
+                for (int i = 0; i < m_ny; ++i)
+                {
+                    const auto k   = at(i, j);
+                    const auto s   = m_s_star[k];
+                    const auto row = static_cast<std::size_t>(i * (m_nx - 1));
+                    double flux    = 0.0;
+                    if (j > 0)        flux += m_gx[row + j - 1] * (m_s_star[k - 1] - s);
+                    if (j + 1 < m_nx) flux += m_gx[row + j] * (m_s_star[k + 1] - s);
+                    line[static_cast<std::size_t>(i)] = m_w[k] * s + tau * flux;
+                }
+                algorithm::thomasReUseIP(m_col_mat[static_cast<std::size_t>(j)], line);
+                for (int i = 0; i < m_ny; ++i) m_s[at(i, j)] = line[static_cast<std::size_t>(i)];
+            }
+        });
+
+        double r_top = 0.0, r_bot = 0.0;
+        for (int j = 0; j < m_nx; ++j)
+        {
+            r_top += m_a_top[static_cast<std::size_t>(j)] * m_s[at(0, j)];
+            r_bot += m_a_bot[static_cast<std::size_t>(j)] * m_s[at(m_ny - 1, j)];
+        }
+        if (!m_top_clamped) m_rhs[cv] += tau / m_w_v * r_top;
+        m_rhs[cv + 1] += tau / m_w_d * r_bot;
+
+        algorithm::thomasReUseIP(m_compact, m_rhs);
+        for (int i = 0; i < N; ++i)
+        {
+            if (i >= m_from && i <= m_to) continue;
+            state[static_cast<std::size_t>(i)] = m_rhs[static_cast<std::size_t>(compact(i))];
+        }
+
+        const auto v_new = state[static_cast<std::size_t>(m_v)];
+        const auto d_new = m_sink_below ? 0.0 : state[static_cast<std::size_t>(m_d)];
+        for (int j = 0; j < m_nx; ++j)
+        {
+            const auto col = static_cast<std::size_t>(j) * ny;
+            for (int i = 0; i < m_ny; ++i)
+            {
+                const auto zi = col + static_cast<std::size_t>(i);
+                m_s[at(i, j)] += m_z_top[zi] * v_new + m_z_bot[zi] * d_new;
+            }
+        }
+    }
+
+    void BrickLayer::project(std::vector<double>& state) const
+    {
+        // Row i holds the mass sum_j f_j K s dy_i per unit area. Spread it
+        // over the 1-D cells by overlap, with both meshes normalised to the
+        // same height so the totals agree to rounding.
+        const auto n1    = static_cast<int>(m_edges.size()) - 1;
+        const auto H     = m_edges.back();
+        const auto Y     = m_y.back() + 0.5 * m_dy.back();
+        std::vector<double> mass(static_cast<std::size_t>(n1), 0.0);
+
+        int    k  = 0;
+        double y0 = 0.0;
+        for (int i = 0; i < m_ny; ++i)
+        {
+            const auto dy = m_dy[static_cast<std::size_t>(i)];
+            double c_bar = 0.0;
+            for (int j = 0; j < m_nx; ++j)
+            {
+                const auto kk = at(i, j);
+                c_bar += m_f[static_cast<std::size_t>(j)] * m_K[kk] * m_s[kk];
+            }
+            const auto row_mass = c_bar * dy;
+            const auto lo = y0 / Y;
+            const auto hi = (y0 + dy) / Y;
+            y0 += dy;
+
+            while (k + 1 < n1 && m_edges[static_cast<std::size_t>(k + 1)] / H <= lo) ++k;
+            auto a  = lo;
+            auto kc = k;
+            while (a < hi)
+            {
+                const auto b = kc + 1 < n1
+                    ? std::min(hi, m_edges[static_cast<std::size_t>(kc + 1)] / H) : hi;
+                mass[static_cast<std::size_t>(kc)] += row_mass * (b - a) / (hi - lo);
+                a = b;
+                if (a < hi) ++kc;
+            }
+        }
+
+        for (int c = 0; c < n1; ++c)
+        {
+            const auto h = m_edges[static_cast<std::size_t>(c + 1)] -
+                           m_edges[static_cast<std::size_t>(c)];
+            state[static_cast<std::size_t>(m_from + c)] =
+                mass[static_cast<std::size_t>(c)] / h / m_K_layer;
+        }
+    }
+
+    std::vector<double> BrickLayer::concentrations() const
+    {
+        std::vector<double> c(m_s.size());
+        for (std::size_t k = 0; k < c.size(); ++k) c[k] = m_K[k] * m_s[k];
+        return c;
+    }
+}
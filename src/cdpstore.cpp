@@ -0,0 +1,213 @@
+#include "cdpstore.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sc
+{
+    namespace
+    {
+        constexpr char          kMagic[8]  = {'S', 'K', 'D', 'C', 'D', 'P', '\0', '\0'};
+        constexpr std::uint32_t kVersion   = 1;
+        constexpr std::uint32_t kByteOrder = 0x01020304;
+
+        // Header layout: magic, version, byte order, then three uint64
+        // (depths, capacity, profiles written) and the depth grid and
+        // time index as doubles -- all at multiples of 8 bytes.
+        constexpr std::size_t kCountAt  = 32;
+        constexpr std::size_t kHeadSize = 40;
+
+        std::size_t timeAt(std::size_t depths, std::size_t k)
+        {
+            return kHeadSize + (depths + k) * sizeof(double);
+        }
+
+        std::size_t dataAt(std::size_t depths, std::size_t capacity)
+        {
+            return timeAt(depths, capacity);
+        }
+
+        template <typename T>
+        void put(std::fstream& f, T v)
+        {
+            f.write(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        template <typename T>
+        T get(const unsigned char* p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            return v;
+        }
+    }
+
+    CdpStore::CdpStore(std::string path, const std::vector<double>& depths_um,
+                       std::size_t capacity)
+        : m_path(std::move(path))
+        , m_depths(depths_um.size())
+        , m_capacity(capacity)
+    {
+        m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (m_file)
+        {
+            m_file.write(kMagic, sizeof(kMagic));
+            put(m_file, kVersion);
+            put(m_file, kByteOrder);
+            put<std::uint64_t>(m_file, m_depths);
+            put<std::uint64_t>(m_file, m_capacity);
+            put<std::uint64_t>(m_file, 0);
+            m_file.write(reinterpret_cast<const char*>(depths_um.data()),
+                         static_cast<std::streamsize>(m_depths * sizeof(double)));
+            const std::vector<double> index(m_capacity, 0.0);
+            m_file.write(reinterpret_cast<const char*>(index.data()),
+                         static_cast<std::streamsize>(m_capacity * sizeof(double)));
+            m_file.flush();
+        }
+        if (!m_file) throw std::runtime_error("cannot write CDP store " + m_path);
+    }
+
+    CdpStore::~CdpStore()
+    {
+        try
+        {
+            sync();
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+
+    void CdpStore::append(double t, const std::vector<double>& profile)
+    {
+        if (m_size == m_capacity || profile.size() != m_depths)
+        {
+            throw std::runtime_error("CDP store " + m_path + ": profile does not fit");
+        }
+        const auto row = m_depths * sizeof(double);
+        m_file.seekp(static_cast<std::streamoff>(dataAt(m_depths, m_capacity) + m_size * row));
+        m_file.write(reinterpret_cast<const char*>(profile.data()),
+                     static_cast<std::streamsize>(row));
+        m_file.seekp(static_cast<std::streamoff>(timeAt(m_depths, m_size)));
+        put(m_file, t);
+        if (!m_file) throw std::runtime_error("cannot write CDP store " + m_path);
+        ++m_size;
+    }
+
+    void CdpStore::sync()
+    {
+        m_file.seekp(static_cast<std::streamoff>(kCountAt));
+        put<std::uint64_t>(m_file, m_size);
+        m_file.flush();
+        if (!m_file) throw std::runtime_error("cannot write CDP store " + m_path);
+    }
+
+    std::vector<double> CdpStore::read(std::size_t k)
+    {
+        if (k >= m_size) throw std::out_of_range("CDP store profile index");
+        std::vector<double> out(m_depths);
+        const auto row = m_depths * sizeof(double);
+        m_file.seekg(static_cast<std::streamoff>(dataAt(m_depths, m_capacity) + k * row));
+        m_file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(row));
+        if (!m_file)
+        {
+            throw std::runtime_error("cannot read CDP store " + m_path);
+        }
+        return out;
+    }
+
+    std::unique_ptr<CdpMapping> CdpMapping::open(const std::string& path)
+    {
+        std::unique_ptr<CdpMapping> m(new CdpMapping());
+#ifdef _WIN32
+        auto file = CreateFileA(path.c_str(), GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER size;
+        const auto sized = GetFileSizeEx(file, &size) != 0;
+        auto view = sized && size.QuadPart >= static_cast<LONGLONG>(kHeadSize)
+            ? CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr)
+            : nullptr;
+        CloseHandle(file);
+        if (!view) return nullptr;
+        m->m_base = MapViewOfFile(view, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(view);
+        if (!m->m_base) return nullptr;
+        m->m_bytes = static_cast<std::size_t>(size.QuadPart);
+#else
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeadSize))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        // Private, writable pages: written ones are copied, the file stays.
+        auto view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size),
+                           PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return nullptr;
+        m->m_base  = view;
+        m->m_bytes = static_cast<std::size_t>(st.st_size);
+#endif
+
+        const auto* p = static_cast<const unsigned char*>(m->m_base);
+        if (std::memcmp(p, kMagic, sizeof(kMagic)) != 0 || get<std::uint32_t>(p + 8) != kVersion ||
+            get<std::uint32_t>(p + 12) != kByteOrder)
+        {
+            return nullptr;
+        }
+        const auto depths   = get<std::uint64_t>(p + 16);
+        const auto capacity = get<std::uint64_t>(p + 24);
+        const auto times    = get<std::uint64_t>(p + kCountAt);
+        // Bounded by the file size before any product is formed.
+        const auto doubles = m->m_bytes / sizeof(double);
+        if (depths > doubles || capacity > doubles || times > capacity ||
+            (depths > 0 && times > doubles / depths))
+        {
+            return nullptr;
+        }
+        const auto start = dataAt(depths, capacity);
+        if (start > m->m_bytes ||
+            depths * times > (m->m_bytes - start) / sizeof(double))
+        {
+            return nullptr;
+        }
+        auto* base  = static_cast<unsigned char*>(m->m_base);
+        m->m_depths = depths;
+        m->m_times  = times;
+        m->m_depth  = reinterpret_cast<double*>(base + kHeadSize);
+        m->m_time   = reinterpret_cast<double*>(base + timeAt(depths, 0));
+        m->m_data   = reinterpret_cast<double*>(base + start);
+        return m;
+    }
+
+    CdpMapping::~CdpMapping()
+    {
+        if (!m_base) return;
+#ifdef _WIN32
+        UnmapViewOfFile(m_base);
+#else
+        ::munmap(m_base, m_bytes);
+#endif
+    }
+}
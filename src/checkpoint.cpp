@@ -0,0 +1,216 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace sc
+{
+    namespace
+    {
+        constexpr char          kMagic[8]  = {'S', 'K', 'D', 'C', 'K', 'P', 'T', '\0'};
+        constexpr std::uint32_t kVersion   = 1;
+        constexpr std::uint32_t kByteOrder = 0x01020304;
+
+        class Writer
+        {
+          public:
+            explicit Writer(std::ostream& out) : m_out(out) {}
+
+            template <typename T>
+            void pod(T v)
+            {
+                m_out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+
+            void doubles(const std::vector<double>& v)
+            {
+                pod<std::uint64_t>(v.size());
+                m_out.write(reinterpret_cast<const char*>(v.data()),
+                            static_cast<std::streamsize>(v.size() * sizeof(double)));
+            }
+
+            void string(const std::string& s)
+            {
+                pod<std::uint64_t>(s.size());
+                m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+            }
+
+            void series(const MassSeries& s)
+            {
+                pod<std::uint8_t>(s.enabled);
+                pod<std::int32_t>(s.log_interval);
+                doubles(s.times);
+                doubles(s.values);
+            }
+
+            void series(const CdpSeries& s)
+            {
+                pod<std::uint8_t>(s.enabled);
+                pod<std::int32_t>(s.log_interval);
+                doubles(s.depths_um);
+                doubles(s.times);
+                for (const auto& p : s.conc_per_time) doubles(p);
+            }
+
+          private:
+            std::ostream& m_out;
+        };
+
+        // Every read checks the stream; sizes are bounded by what is left
+        // of it, so a corrupt length fails instead of allocating.
+        class Reader
+        {
+          public:
+            explicit Reader(std::istream& in) : m_in(in)
+            {
+                const auto here = in.tellg();
+                if (here >= 0 && in.seekg(0, std::ios::end))
+                {
+                    m_left = static_cast<std::uint64_t>(in.tellg() - here);
+                    in.seekg(here);
+                }
+                else
+                {
+                    in.clear();
+                    m_left = UINT64_MAX;
+                }
+            }
+
+            [[nodiscard]] bool ok() const { return static_cast<bool>(m_in); }
+
+            template <typename T>
+            T pod()
+            {
+                T v{};
+                take(reinterpret_cast<char*>(&v), sizeof(T));
+                return v;
+            }
+
+            std::vector<double> doubles()
+            {
+                const auto n = pod<std::uint64_t>();
+                if (!ok() || n > m_left / sizeof(double))
+                {
+                    m_in.setstate(std::ios::failbit);
+                    return {};
+                }
+                std::vector<double> v(static_cast<std::size_t>(n));
+                take(reinterpret_cast<char*>(v.data()), n * sizeof(double));
+                return v;
+            }
+
+            std::string string()
+            {
+                const auto n = pod<std::uint64_t>();
+                if (!ok() || n > m_left)
+                {
+                    m_in.setstate(std::ios::failbit);
+                    return {};
+                }
+                std::string s(static_cast<std::size_t>(n), '\0');
+                take(s.data(), n);
+                return s;
+            }
+
+            void series(MassSeries& s)
+            {
+                s.enabled      = pod<std::uint8_t>() != 0;
+                s.log_interval = pod<std::int32_t>();
+                s.times        = doubles();
+                s.values       = doubles();
+            }
+
+            void series(CdpSeries& s)
+            {
+                s.enabled      = pod<std::uint8_t>() != 0;
+                s.log_interval = pod<std::int32_t>();
+                s.depths_um    = doubles();
+                s.times        = doubles();
+                s.conc_per_time.clear();
+                for (std::size_t i = 0; i < s.times.size() && ok(); ++i)
+                {
+                    s.conc_per_time.push_back(doubles());
+                }
+            }
+
+          private:
+            void take(char* dst, std::uint64_t n)
+            {
+                if (!ok()) return;
+                if (n > m_left)
+                {
+                    m_in.setstate(std::ios::failbit);
+                    return;
+                }
+                m_in.read(dst, static_cast<std::streamsize>(n));
+                m_left -= n;
+            }
+
+            std::istream& m_in;
+            std::uint64_t m_left = 0;
+        };
+    }
+
+    void writeCheckpoint(std::ostream& out, const Checkpoint& cp)
+    {
+        Writer w(out);
+        out.write(kMagic, sizeof(kMagic));
+        w.pod(kVersion);
+        w.pod(kByteOrder);
+
+        w.pod<std::int32_t>(cp.t);
+        w.pod<std::uint8_t>(cp.vehicle_removed);
+        w.doubles(cp.state);
+        w.doubles(cp.space_steps);
+
+        w.pod<std::uint64_t>(cp.names.size());
+        for (std::size_t i = 0; i < cp.names.size(); ++i)
+        {
+            w.string(cp.names[i]);
+            w.series(cp.mass[i]);
+            w.series(cp.cdp[i]);
+        }
+        w.series(cp.sink_mass);
+        w.series(cp.plasma);
+
+        w.pod(cp.donor_mg0);
+        w.pod(cp.sink_mg0);
+        w.pod<std::int32_t>(cp.steady_state_at);
+    }
+
+    std::optional<Checkpoint> readCheckpoint(std::istream& in)
+    {
+        Reader r(in);
+        char magic[sizeof(kMagic)] = {};
+        for (auto& c : magic) c = r.pod<char>();
+        if (!r.ok() || !std::equal(magic, magic + sizeof(kMagic), kMagic)) return std::nullopt;
+        if (r.pod<std::uint32_t>() != kVersion || r.pod<std::uint32_t>() != kByteOrder)
+        {
+            return std::nullopt;
+        }
+
+        Checkpoint cp;
+        cp.t               = r.pod<std::int32_t>();
+        cp.vehicle_removed = r.pod<std::uint8_t>() != 0;
+        cp.state           = r.doubles();
+        cp.space_steps     = r.doubles();
+
+        const auto n = r.pod<std::uint64_t>();
+        for (std::uint64_t i = 0; i < n && r.ok(); ++i)
+        {
+            cp.names.push_back(r.string());
+            r.series(cp.mass.emplace_back());
+            r.series(cp.cdp.emplace_back());
+        }
+        r.series(cp.sink_mass);
+        r.series(cp.plasma);
+
+        cp.donor_mg0       = r.pod<double>();
+        cp.sink_mg0        = r.pod<double>();
+        cp.steady_state_at = r.pod<std::int32_t>();
+        if (!r.ok()) return std::nullopt;
+        return cp;
+    }
+}
@@ -0,0 +1,282 @@
+#include "cnoperator.h"
+
+#include "algorithms.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace sc
+{
+    void CnOperator::build(const TDMatrix& rhs, const TDMatrix& lhs, bool with_ul,
+                           bool with_single)
+    {
+        const auto n = rhs.size();
+        assert(n > 1 && lhs.size() == n);
+        assert(!lhs.isPrepared() && !lhs.isPreparedUL());
+
+        auto lu = lhs;
+        algorithm::prepareThomas(lu);
+
+        bool mass = false;
+        for (int i = 0; i < n - 1; ++i)
+        {
+            mass = mass || lhs.lower(i) != -rhs.lower(i) || lhs.upper(i) != -rhs.upper(i);
+        }
+        assert(!mass || (!with_ul && !with_single));
+
+        m_cells.assign(static_cast<std::size_t>(n), Cell{0.0, 0.0, 0.0, 0.0});
+        m_elim.clear();
+        if (mass) m_elim.assign(static_cast<std::size_t>(n), 0.0);
+        for (int i = 0; i < n; ++i)
+        {
+            auto& c = m_cells[static_cast<std::size_t>(i)];
+            c.diag = rhs.diag(i);
+            c.inv  = lu.diag(i);
+            if (i > 0)
+            {
+                c.lower = rhs.lower(i - 1);
+                if (mass) m_elim[static_cast<std::size_t>(i)] = -lhs.lower(i - 1);
+            }
+            if (i < n - 1) c.upper = rhs.upper(i);
+        }
+
+        m_c_star.assign(lu.fullUpper().begin(), lu.fullUpper().end());
+        m_c_star.push_back(0.0);
+
+        m_ul_inv.clear();
+        if (with_ul)
+        {
+            auto ul = lhs;
+            algorithm::prepareThomasUL(ul);
+            m_ul_inv = ul.fullDiag();
+        }
+
+        m_cells_single.clear();
+        m_c_star_single.clear();
+        m_defect_diag.clear();
+        if (with_single)
+        {
+            m_cells_single.reserve(m_cells.size());
+            for (const auto& c : m_cells)
+            {
+                m_cells_single.push_back(CellSingle{static_cast<float>(c.lower),
+                                                    static_cast<float>(c.diag),
+                                                    static_cast<float>(c.upper),
+                                                    static_cast<float>(c.inv)});
+            }
+            m_c_star_single.assign(m_c_star.begin(), m_c_star.end());
+            m_defect_diag.resize(m_cells.size());
+            for (int i = 0; i < n; ++i)
+            {
+                m_defect_diag[static_cast<std::size_t>(i)] = rhs.diag(i) - lhs.diag(i);
+            }
+        }
+    }
+
+    void CnOperator::step(std::vector<double>& vec, int from, int to) const
+    {
+        if (hasMass())
+        {
+            stepRows<true>(vec, from, to);
+        }
+        else
+        {
+            stepRows<false>(vec, from, to);
+        }
+    }
+
+    // Same passes as algorithm::crankNicolsonStepIP, with lhs lower = -lower
+    // (or m_elim) folded into the forward sweep. The rhs product of a row
+    // is formed off the recurrence, so the sweep's dependency chain stays
+    // one multiply-add and one multiply per row.
+    template <bool kMass>
+    void CnOperator::stepRows(std::vector<double>& vec, int from, int to) const
+    {
+        const auto size = this->size();
+        assert(size > 1);
+        assert(static_cast<std::size_t>(size) == vec.size());
+        assert(0 <= from && from <= to && to < size);
+
+        const Cell*   c  = m_cells.data();
+        const double* cs = m_c_star.data();
+        const double* el = m_elim.data();
+        double*       v  = vec.data();
+        auto elim = [c, el](int i) { return kMass ? el[i] : c[i].lower; };
+
+        // First row; the row above an inner window is an identity row, so
+        // its old and new values coincide.
+        double prev = v[from];   // old v[i - 1]
+        {
+            double mul = c[from].diag * v[from];
+            if (from > 0)        mul += (c[from].lower + elim(from)) * v[from - 1];
+            if (from < size - 1) mul += c[from].upper * v[from + 1];
+            v[from] = mul * c[from].inv;
+        }
+
+        const auto last_inner = std::min(to, size - 2);
+        for (int i = from + 1; i <= last_inner; ++i)
+        {
+            const double old = v[i];
+            const double mul = c[i].lower * prev + c[i].diag * old + c[i].upper * v[i + 1];
+            v[i] = (mul + elim(i) * v[i - 1]) * c[i].inv;
+            prev = old;
+        }
+
+        if (to == size - 1 && to > from)
+        {
+            const auto   i   = size - 1;
+            const double mul = c[i].lower * prev + c[i].diag * v[i];
+            v[i] = (mul + elim(i) * v[i - 1]) * c[i].inv;
+        }
+
+        for (int i = to - 1; i >= from; --i)
+        {
+            v[i] = v[i] - cs[i] * v[i + 1];
+        }
+    }
+
+    // Same passes as algorithm::crankNicolsonStepsIP. With u = -upper and
+    // l = -lower on the lhs, the UL elimination coefficient of row i is
+    // g[i - 1] = -lower[i] * ul_inv[i].
+    void CnOperator::steps(std::vector<double>& vec, int n_steps) const
+    {
+        if (!hasUL())
+        {
+            for (int k = 0; k < n_steps; ++k) step(vec);
+            return;
+        }
+        if (n_steps <= 0) return;
+
+        const auto size = this->size();
+        assert(size > 1);
+        assert(static_cast<std::size_t>(size) == vec.size());
+
+        const Cell*   c  = m_cells.data();
+        const double* cs = m_c_star.data();
+        const double* e  = m_ul_inv.data();
+        double*       v  = vec.data();
+        const auto last = size - 1;
+
+        // Upward: rhs product and the LU elimination of the first step.
+        {
+            double prev = v[0];
+            v[0] = (c[0].diag * v[0] + c[0].upper * v[1]) * c[0].inv;
+            for (int i = 1; i < last; ++i)
+            {
+                const double old = v[i];
+                const double mul = c[i].lower * prev + c[i].diag * old + c[i].upper * v[i + 1];
+                v[i] = (mul + c[i].lower * v[i - 1]) * c[i].inv;
+                prev = old;
+            }
+            const double mul = c[last].lower * prev + c[last].diag * v[last];
+            v[last] = (mul + c[last].lower * v[last - 1]) * c[last].inv;
+        }
+
+        for (int k = 1; k <= n_steps; ++k)
+        {
+            const bool lu_step = (k % 2) == 1;
+            if (k == n_steps)
+            {
+                if (lu_step)
+                {
+                    for (int i = last - 1; i >= 0; --i) v[i] = v[i] - cs[i] * v[i + 1];
+                }
+                else
+                {
+                    for (int i = 1; i <= last; ++i) v[i] = v[i] + c[i].lower * e[i] * v[i - 1];
+                }
+                break;
+            }
+
+            if (lu_step)
+            {
+                // Downward: LU back-substitution fused with the rhs product
+                // and the UL elimination of the next step.
+                double x_hi  = v[last];
+                double x_mid = v[last - 1] - cs[last - 1] * x_hi;
+                v[last] = (c[last].lower * x_mid + c[last].diag * x_hi) * e[last];
+                for (int i = last - 2; i >= 0; --i)
+                {
+                    const double x_i = v[i] - cs[i] * x_mid;
+                    const int    j   = i + 1;
+                    const double mul = c[j].lower * x_i + c[j].diag * x_mid + c[j].upper * x_hi;
+                    v[j]  = (mul + c[j].upper * v[j + 1]) * e[j];
+                    x_hi  = x_mid;
+                    x_mid = x_i;
+                }
+                const double mul = c[0].diag * x_mid + c[0].upper * x_hi;
+                v[0] = (mul + c[0].upper * v[1]) * e[0];
+            }
+            else
+            {
+                // Upward: the mirror image.
+                double x_lo  = v[0];
+                double x_mid = v[1] + c[1].lower * e[1] * x_lo;
+                v[0] = (c[0].diag * x_lo + c[0].upper * x_mid) * c[0].inv;
+                for (int i = 2; i <= last; ++i)
+                {
+                    const double x_i = v[i] + c[i].lower * e[i] * x_mid;
+                    const int    j   = i - 1;
+                    const double mul = c[j].lower * x_lo + c[j].diag * x_mid + c[j].upper * x_i;
+                    v[j]  = (mul + c[j].lower * v[j - 1]) * c[j].inv;
+                    x_lo  = x_mid;
+                    x_mid = x_i;
+                }
+                const double mul = c[last].lower * x_lo + c[last].diag * x_mid;
+                v[last] = (mul + c[last].lower * v[last - 1]) * c[last].inv;
+            }
+        }
+    }
+
+    // The off-diagonals of rhs - lhs are twice the rhs ones.
+    void CnOperator::defect(const std::vector<double>& a, std::vector<float>& s) const
+    {
+        const auto size = this->size();
+        assert(hasSingle());
+        assert(static_cast<std::size_t>(size) == a.size());
+
+        const Cell*   c  = m_cells.data();
+        const double* dd = m_defect_diag.data();
+        const double* u  = a.data();
+        s.resize(a.size());
+        for (int i = 0; i < size; ++i)
+        {
+            double d = dd[i] * u[i];
+            if (i > 0)        d += 2.0 * c[i].lower * u[i - 1];
+            if (i < size - 1) d += 2.0 * c[i].upper * u[i + 1];
+            s[static_cast<std::size_t>(i)] = static_cast<float>(d);
+        }
+    }
+
+    // step() over every row, in floats, with the defect added to the rhs
+    // product.
+    void CnOperator::stepSingle(std::vector<float>& x, const std::vector<float>& s) const
+    {
+        const auto size = this->size();
+        assert(size > 1 && hasSingle());
+        assert(static_cast<std::size_t>(size) == x.size() && x.size() == s.size());
+
+        const CellSingle* c  = m_cells_single.data();
+        const float*      cs = m_c_star_single.data();
+        const float*      sv = s.data();
+        float*            v  = x.data();
+        const auto last = size - 1;
+
+        float prev = v[0];
+        v[0] = (c[0].diag * v[0] + c[0].upper * v[1] + sv[0]) * c[0].inv;
+        for (int i = 1; i < last; ++i)
+        {
+            const float old = v[i];
+            const float mul = c[i].lower * prev + c[i].diag * old + c[i].upper * v[i + 1] + sv[i];
+            v[i] = (mul + c[i].lower * v[i - 1]) * c[i].inv;
+            prev = old;
+        }
+        {
+            const float mul = c[last].lower * prev + c[last].diag * v[last] + sv[last];
+            v[last] = (mul + c[last].lower * v[last - 1]) * c[last].inv;
+        }
+
+        for (int i = last - 1; i >= 0; --i) v[i] = v[i] - cs[i] * v[i + 1];
+    }
+}
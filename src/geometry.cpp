@@ -18,7 +18,7 @@ namespace sc
         double D_min = std::numeric_limits<double>::infinity();
         for (const auto& c : compartments)
         {
-            if (c.D > 0.0 && c.D < D_min) D_min = c.D;
+            if (!c.lumped && c.D > 0.0 && c.D < D_min) D_min = c.D;
         }
         assert(std::isfinite(D_min) && D_min > 0.0);
 
@@ -30,8 +30,11 @@ namespace sc
             assert(c.height_um > 0);
             const auto start_idx = counter;
 
+            // A lumped (well-mixed) compartment is a single node, whatever
+            // its D.
             const double dx_target = dx_min * std::sqrt(c.D / D_min);
-            int n_cells = static_cast<int>(std::round(c.height_um / dx_target));
+            int n_cells = c.lumped ? 1
+                                   : static_cast<int>(std::round(c.height_um / dx_target));
             if (n_cells < 1) n_cells = 1;
             const double actual_dx =
                 static_cast<double>(c.height_um) / static_cast<double>(n_cells);
@@ -47,9 +50,15 @@ namespace sc
 
         if (sink)
         {
-            m_space_steps.push_back(dx_min);
+            // The PK cells share the sink cell's width, so their values
+            // convert to mass alike.
             sink->geo_from = counter;
-            sink->geo_to   = counter;
+            for (int j = 0; j <= sink->pkCells(); ++j)
+            {
+                m_space_steps.push_back(dx_min);
+                ++counter;
+            }
+            sink->geo_to = counter - 1;
         }
 
         const auto mm = std::minmax_element(m_space_steps.begin(), m_space_steps.end());
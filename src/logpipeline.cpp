@@ -0,0 +1,87 @@
+#include "logpipeline.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sc
+{
+    LogPipeline::LogPipeline(int slots, std::size_t state_size, Sink sink)
+        : m_slots(static_cast<std::size_t>(std::max(1, slots))), m_sink(std::move(sink))
+    {
+        for (auto& s : m_slots) s.state.reserve(state_size);
+        m_thread = std::thread([this] { consume(); });
+    }
+
+    LogPipeline::~LogPipeline()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_pushed.notify_one();
+        m_thread.join();
+    }
+
+    void LogPipeline::push(double t, const std::vector<double>& state)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_logged.wait(lock, [this] { return m_count < m_slots.size(); });
+        rethrow();
+        const auto tail = (m_head + m_count) % m_slots.size();
+        lock.unlock();
+
+        // The slot is outside [m_head, m_head + m_count), which is all the
+        // logging thread reads, so it is filled without the lock.
+        auto& slot = m_slots[tail];
+        slot.t = t;
+        slot.state.assign(state.begin(), state.end());
+
+        lock.lock();
+        ++m_count;
+        lock.unlock();
+        m_pushed.notify_one();
+    }
+
+    void LogPipeline::drain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_logged.wait(lock, [this] { return m_count == 0; });
+        rethrow();
+    }
+
+    void LogPipeline::rethrow()
+    {
+        if (m_error) std::rethrow_exception(m_error);
+    }
+
+    void LogPipeline::consume()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_pushed.wait(lock, [this] { return m_count > 0 || m_done; });
+            if (m_count == 0) return;
+
+            auto& slot = m_slots[m_head];
+            const auto failed = static_cast<bool>(m_error);
+            lock.unlock();
+            if (!failed)
+            {
+                try
+                {
+                    m_sink(slot.t, slot.state);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    m_error = std::current_exception();
+                    lock.unlock();
+                }
+            }
+            lock.lock();
+            m_head = (m_head + 1) % m_slots.size();
+            --m_count;
+            m_logged.notify_one();
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SC_LOGPIPELINE_H
+#define SC_LOGPIPELINE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sc
+{
+    // Hands copies of the state from the stepping thread to a logging
+    // thread, which runs `sink` on them in the order they were pushed.
+    //
+    // The snapshots live in a ring of `slots` buffers allocated up front.
+    // push() waits while every slot is still waiting to be logged, so the
+    // stepper never gets more than `slots` minutes ahead and memory stays
+    // bounded however slow the sink is.
+    //
+    // The first exception thrown by `sink` is re-thrown by every later
+    // push() or drain(); snapshots still queued are dropped. The sink must not touch the
+    // R API, nor anything the stepping thread changes while it runs.
+    class LogPipeline
+    {
+      public:
+        using Sink = std::function<void(double t, const std::vector<double>& state)>;
+
+        LogPipeline(int slots, std::size_t state_size, Sink sink);
+        ~LogPipeline();
+
+        LogPipeline(const LogPipeline&)            = delete;
+        LogPipeline& operator=(const LogPipeline&) = delete;
+
+        void push(double t, const std::vector<double>& state);
+
+        // Waits until every pushed snapshot has been logged.
+        void drain();
+
+      private:
+        struct Slot
+        {
+            double              t = 0.0;
+            std::vector<double> state;
+        };
+
+        void consume();
+        void rethrow();
+
+        std::vector<Slot>       m_slots;
+        std::size_t             m_head  = 0;   // next slot to log
+        std::size_t             m_count = 0;   // slots pushed, not yet logged
+        bool                    m_done  = false;
+        std::exception_ptr      m_error;
+        std::mutex              m_mutex;
+        std::condition_variable m_pushed;
+        std::condition_variable m_logged;
+        Sink                    m_sink;
+        std::thread             m_thread;
+    };
+}
+
+#endif  // SC_LOGPIPELINE_H
@@ -58,12 +58,52 @@ namespace sc
     //    donor we clamp every donor cell at its initial value AND set the
     //    donor / first-skin face conductance to its kappa_donor -> infinity
     //    limit (2 * kappa_skin / h_skin), giving a true Dirichlet BC.
+    //    A lumped (well-mixed) donor is a single node with the same
+    //    interface conductance: all resistance sits on the skin side.
     //
     //  - Bottom (membrane <-> sink): kappa_sink -> infinity in the harmonic
     //    mean (the sink is a Dirichlet phantom from the membrane's point of
     //    view). The membrane row's upper coupling to the sink is zeroed out;
     //    the sink cell still receives the throughput via its lower
     //    coefficient and serves as the cumulative-mass accumulator.
+    //
+    //  - Systemic PK (Sink::pk): with T the sink value, c / p the central /
+    //    peripheral masses and e the eliminated mass, T = c + p + e. The
+    //    central compartment would need couplings to the membrane, p and e,
+    //    which a tri-diagonal row cannot hold, so the rows below the sink
+    //    carry
+    //        z = T - c = p + e,   r = p - f z,   f = k12 / (ke + k12)
+    //    instead. With a = ke + k12 and b = k21 ke / a they obey
+    //        dz/dt = a T - (a + k21 f) z - k21 r
+    //        dr/dt = -b f z - b r
+    //    -- a chain T -> z -> r, with r dropped for a single compartment.
+    //    CN is linear, so c = T - z and p = r + f z are exactly what CN on
+    //    the original compartments would give.
+    //
+    // Compact scheme. Expanding the exact solution about a face, with
+    // kappa u'' = theta u_t on either side and rho = h / kappa, the cell
+    // averages satisfy
+    //
+    //   F = alpha (u_r - u_l) - P u_t(face) - Q (u_r - u_l)_t + O(h^3)
+    //   P = alpha (theta_r h_r rho_r - theta_l h_l rho_l) / 6
+    //   Q = alpha^2 (theta_r h_r rho_r^2 + theta_l h_l rho_l^2) / 24
+    //
+    // for the face flux F = kappa u_x, with u_t(face) interpolated with the
+    // weights (rho_r, rho_l) / (rho_l + rho_r) of the harmonic mean. Inside
+    // a compartment P = 0 and Q = theta h / 12, the classical compact
+    // (1, 10, 1) / 12 mass rows, fourth-order; at an interface the mesh
+    // (h^2 / D the same in every compartment) keeps P small. A Dirichlet
+    // side (the donor limits above, the sink phantom) has rho = 0, and the
+    // phantom's u_t = 0. Each face adds its correction to the two rows it
+    // separates with opposite signs, so the column sums of theta h M are
+    // theta h and every mass the logger integrates is conserved exactly.
+    //
+    // The face flux alpha ((u_r - u_l) - delta (u_r - u_l)_t), delta =
+    // Q / alpha, is the two-point flux taken delta earlier. A jump in u
+    // across a face at t = 0 -- the dose against the empty skin -- leaves
+    // that lag behind as a time shift of the whole solution, second order
+    // in h; advancing the jump by delta when it is applied (fillShift)
+    // takes it out again.
     // ===========================================================================
     bool MatrixBuilder::buildMatrix(const std::vector<Compartment>& compartments,
                                     const Geometry& geometry, Sink* sink)
@@ -74,6 +114,9 @@ namespace sc
         const auto& h        = geometry.spaceSteps();
         assert(N > 1);
 
+        // Finite-volume cells: everything down to the sink; PK cells follow.
+        const auto n_fv = sink ? sink->geo_from + 1 : N;
+
         // Per-cell K, A, D from compartment broadcasting (sink inherits from
         // the last skin layer).
         auto K_vec = createParamVector(N, compartments,
@@ -103,9 +146,9 @@ namespace sc
                 A_vec[static_cast<std::size_t>(i)];
         }
 
-        // Face conductances alpha_{i+1/2} for i = 0..N-2.
+        // Face conductances alpha_{i+1/2} for i = 0..n_fv-2.
         std::vector<double> alpha(static_cast<std::size_t>(N - 1), 0.0);
-        for (int i = 0; i < N - 1; ++i)
+        for (int i = 0; i < n_fv - 1; ++i)
         {
             const auto k_l = kappa[static_cast<std::size_t>(i)];
             const auto k_r = kappa[static_cast<std::size_t>(i + 1)];
@@ -127,9 +170,9 @@ namespace sc
             }
         }
 
-        // Donor <-> first-skin face for an infinite-dose donor: cell-edge
-        // Dirichlet limit on the skin side.
-        if (!compartments.front().finite_dose)
+        // Donor <-> first-skin face for an infinite-dose or lumped donor:
+        // cell-edge Dirichlet limit on the skin side.
+        if (!compartments.front().finite_dose || compartments.front().lumped)
         {
             const auto& donor = compartments.front();
             if (donor.geo_to + 1 < N)
@@ -141,6 +184,45 @@ namespace sc
             }
         }
 
+        // Mass matrix, row-scaled like the operator below: the identity,
+        // plus the face corrections of the compact scheme (see above).
+        std::vector<double> mass_d(static_cast<std::size_t>(N), 1.0);
+        std::vector<double> mass_l(static_cast<std::size_t>(N - 1), 0.0);
+        std::vector<double> mass_u(static_cast<std::size_t>(N - 1), 0.0);
+        m_fill_shift = 0.0;
+        if (m_compact)
+        {
+            const auto& donor = compartments.front();
+            const auto dirichlet_donor = !donor.finite_dose || donor.lumped;
+            for (int i = 0; i < n_fv - 1; ++i)
+            {
+                const auto l = static_cast<std::size_t>(i);
+                const auto r = l + 1;
+                const auto a = alpha[l];
+                if (a <= 0.0) continue;
+
+                const auto phantom = sink && i == sink->geo_from - 1;
+                const auto rho_l = (dirichlet_donor && i == donor.geo_to) ? 0.0 : h[l] / kappa[l];
+                const auto rho_r = phantom ? 0.0 : h[r] / kappa[r];
+                const auto rho   = rho_l + rho_r;
+                const auto P = a * (theta[r] * h[r] * rho_r - theta[l] * h[l] * rho_l) / 6.0;
+                const auto Q = a * a *
+                    (theta[r] * h[r] * rho_r * rho_r + theta[l] * h[l] * rho_l * rho_l) / 24.0;
+
+                // Coefficients of du_l/dt and du_r/dt in P u_t(face) + Q (u_r - u_l)_t.
+                const auto c_l = P * rho_r / rho - Q;
+                const auto c_r = phantom ? 0.0 : P * rho_l / rho + Q;
+                if (i == donor.geo_to) m_fill_shift = Q / a;
+
+                const auto th_hl = theta[l] * h[l];
+                const auto th_hr = theta[r] * h[r];
+                mass_d[l] += c_l / th_hl;
+                mass_u[l] += c_r / th_hl;
+                mass_l[l] -= c_l / th_hr;
+                mass_d[r] -= c_r / th_hr;
+            }
+        }
+
         // Assemble |M| where M is the spatial operator
         //   theta_i * h_i * du_i/dt = -|M_diag| * u_i + |M_lower| * u_{i-1}
         //                                          + |M_upper| * u_{i+1}
@@ -157,7 +239,7 @@ namespace sc
         }
 
         // Interior cells.
-        for (int i = 1; i < N - 1; ++i)
+        for (int i = 1; i < n_fv - 1; ++i)
         {
             const auto a_l   = alpha[static_cast<std::size_t>(i - 1)];
             const auto a_r   = alpha[static_cast<std::size_t>(i)];
@@ -172,38 +254,73 @@ namespace sc
         // no right-hand neighbour. The diag is rewritten below if a sink is
         // present.
         {
-            const auto a_l   = alpha[static_cast<std::size_t>(N - 2)];
-            const auto th_hi = theta[static_cast<std::size_t>(N - 1)] *
-                               h[static_cast<std::size_t>(N - 1)];
-            m_matrix_rhs.lower(N - 2) = a_l / th_hi;
-            m_matrix_rhs.diag(N - 1)  = a_l / th_hi;
+            const auto a_l   = alpha[static_cast<std::size_t>(n_fv - 2)];
+            const auto th_hi = theta[static_cast<std::size_t>(n_fv - 1)] *
+                               h[static_cast<std::size_t>(n_fv - 1)];
+            m_matrix_rhs.lower(n_fv - 2) = a_l / th_hi;
+            m_matrix_rhs.diag(n_fv - 1)  = a_l / th_hi;
         }
 
-        // Pick dt / sub-step count from the largest |M| band entry.
-        const auto max_m  = m_matrix_rhs.absMax();
-        m_timesteps       = static_cast<int>(std::max(1.0, std::ceil(max_m / m_max_module)));
+        // Pick dt / sub-step count from the largest |M| band entry; the
+        // compact mass matrix scales the operator up by its smallest
+        // diagonal.
+        const auto min_mass = *std::min_element(mass_d.begin(), mass_d.begin() + n_fv);
+        m_max_rate        = m_matrix_rhs.absMax() / min_mass;
+        m_timesteps       = static_cast<int>(std::max(1.0, std::ceil(m_max_rate / m_max_module)));
         const auto dt     = 1.0 / m_timesteps;
         m_matrix_rhs.multiplyBy(dt);
 
-        // Crank-Nicolson sign-flip + symmetric LHS.
+        // Crank-Nicolson sign-flip: lhs = 2 M - dt A, rhs = 2 M + dt A.
         m_matrix_lhs = TDMatrix(N);
         for (int i = 0; i < N - 1; ++i)
         {
-            m_matrix_lhs.diag(i)  = 2.0 + m_matrix_rhs.diag(i);
-            m_matrix_lhs.lower(i) = -m_matrix_rhs.lower(i);
-            m_matrix_lhs.upper(i) = -m_matrix_rhs.upper(i);
+            const auto idx = static_cast<std::size_t>(i);
+            m_matrix_lhs.diag(i)  = 2.0 * mass_d[idx] + m_matrix_rhs.diag(i);
+            m_matrix_lhs.lower(i) = 2.0 * mass_l[idx] - m_matrix_rhs.lower(i);
+            m_matrix_lhs.upper(i) = 2.0 * mass_u[idx] - m_matrix_rhs.upper(i);
 
-            m_matrix_rhs.diag(i)  = 2.0 - m_matrix_rhs.diag(i);
+            m_matrix_rhs.diag(i)  = 2.0 * mass_d[idx] - m_matrix_rhs.diag(i);
+            m_matrix_rhs.lower(i) += 2.0 * mass_l[idx];
+            m_matrix_rhs.upper(i) += 2.0 * mass_u[idx];
         }
 
         // Sink BC: decouple the membrane row from the sink (no upward flux),
         // reset the sink diag to the perfect-Dirichlet form.
         if (sink)
         {
-            m_matrix_rhs.upper(N - 2) = 0.0;
-            m_matrix_lhs.upper(N - 2) = 0.0;
-            m_matrix_rhs.diag(N - 1)  = 2.0;
-            m_matrix_lhs.diag(N - 1)  = 2.0;
+            const auto s = sink->geo_from;
+            m_matrix_rhs.upper(s - 1) = 0.0;
+            m_matrix_lhs.upper(s - 1) = 0.0;
+            m_matrix_rhs.diag(s)      = 2.0;
+            m_matrix_lhs.diag(s)      = 2.0;
+        }
+
+        // Systemic PK rows (see above), written in CN form directly.
+        if (sink && sink->pk)
+        {
+            const auto s   = sink->geo_from;
+            const auto ke  = sink->pk_ke;
+            const auto k12 = sink->pk_k12;
+            const auto k21 = sink->pk_k21;
+            const auto a   = ke + k12;
+            const auto f   = a > 0.0 ? k12 / a : 0.0;
+            const auto b   = a > 0.0 ? k21 * ke / a : 0.0;
+
+            const auto z = s + 1;
+            m_matrix_rhs.lower(s) =  dt * a;
+            m_matrix_lhs.lower(s) = -dt * a;
+            m_matrix_rhs.diag(z)  = 2.0 - dt * (a + k21 * f);
+            m_matrix_lhs.diag(z)  = 2.0 + dt * (a + k21 * f);
+            if (sink->pkCells() > 1)
+            {
+                const auto r = z + 1;
+                m_matrix_rhs.upper(z) = -dt * k21;
+                m_matrix_lhs.upper(z) =  dt * k21;
+                m_matrix_rhs.lower(z) = -dt * b * f;
+                m_matrix_lhs.lower(z) =  dt * b * f;
+                m_matrix_rhs.diag(r)  = 2.0 - dt * b;
+                m_matrix_lhs.diag(r)  = 2.0 + dt * b;
+            }
         }
 
         // Infinite-dose donor: clamp every donor cell at its initial value.
@@ -230,6 +347,60 @@ namespace sc
             }
         }
 
+        // Per-minute operator: rhs - lhs = 2 * dt * A on every band, and
+        // rhs + lhs = 4 M.
+        m_matrix_op   = TDMatrix(N);
+        m_matrix_mass = TDMatrix(N);
+        const auto to_op = 1.0 / (2.0 * dt);
+        for (int i = 0; i < N; ++i)
+        {
+            m_matrix_op.diag(i)   = (m_matrix_rhs.diag(i) - m_matrix_lhs.diag(i)) * to_op;
+            m_matrix_mass.diag(i) = (m_matrix_rhs.diag(i) + m_matrix_lhs.diag(i)) * 0.25;
+        }
+        for (int i = 0; i < N - 1; ++i)
+        {
+            m_matrix_op.lower(i)   = (m_matrix_rhs.lower(i) - m_matrix_lhs.lower(i)) * to_op;
+            m_matrix_op.upper(i)   = (m_matrix_rhs.upper(i) - m_matrix_lhs.upper(i)) * to_op;
+            m_matrix_mass.lower(i) = (m_matrix_rhs.lower(i) + m_matrix_lhs.lower(i)) * 0.25;
+            m_matrix_mass.upper(i) = (m_matrix_rhs.upper(i) + m_matrix_lhs.upper(i)) * 0.25;
+        }
+
         return true;
     }
+
+    TDMatrix MatrixBuilder::backwardEulerMatrix(double dt) const
+    {
+        const auto N = m_matrix_op.size();
+        TDMatrix result(N);
+        for (int i = 0; i < N; ++i)
+        {
+            result.diag(i) = 1.0 - dt * m_matrix_op.diag(i);
+        }
+        for (int i = 0; i < N - 1; ++i)
+        {
+            result.lower(i) = -dt * m_matrix_op.lower(i);
+            result.upper(i) = -dt * m_matrix_op.upper(i);
+        }
+        return result;
+    }
+
+    std::pair<TDMatrix, TDMatrix> MatrixBuilder::crankNicolsonMatrices(double dt) const
+    {
+        const auto N = m_matrix_op.size();
+        TDMatrix rhs(N);
+        TDMatrix lhs(N);
+        for (int i = 0; i < N; ++i)
+        {
+            rhs.diag(i) = 2.0 * m_matrix_mass.diag(i) + dt * m_matrix_op.diag(i);
+            lhs.diag(i) = 2.0 * m_matrix_mass.diag(i) - dt * m_matrix_op.diag(i);
+        }
+        for (int i = 0; i < N - 1; ++i)
+        {
+            rhs.lower(i) = 2.0 * m_matrix_mass.lower(i) + dt * m_matrix_op.lower(i);
+            lhs.lower(i) = 2.0 * m_matrix_mass.lower(i) - dt * m_matrix_op.lower(i);
+            rhs.upper(i) = 2.0 * m_matrix_mass.upper(i) + dt * m_matrix_op.upper(i);
+            lhs.upper(i) = 2.0 * m_matrix_mass.upper(i) - dt * m_matrix_op.upper(i);
+        }
+        return {std::move(rhs), std::move(lhs)};
+    }
 }
@@ -0,0 +1,116 @@
+#include "metrics.h"
+
+#include <cmath>
+
+namespace sc
+{
+    namespace
+    {
+        // Time at which a quantity going linearly from a (at ta) to b (at
+        // tb) reaches `level`.
+        double crossing(double ta, double a, double tb, double b, double level)
+        {
+            return b == a ? tb : ta + (level - a) / (b - a) * (tb - ta);
+        }
+    }
+
+    void MetricsAccumulator::start(const MetricsParams& p, int sim_time,
+                                   const MetricsSample& first)
+    {
+        m_active  = true;
+        m_ss_from = p.ss_from * sim_time;
+        m_ss_to   = p.ss_to * sim_time;
+        m_sink0   = first.sink_mass;
+        m_donor0  = std::isnan(first.donor_mass) ? 0.0 : first.donor_mass;
+        m_donor_last = m_donor0;
+        m_targets.clear();
+        for (const auto f : p.permeated) m_targets.push_back(f * m_donor0);
+
+        m_out = RunMetrics{};
+        m_out.t_permeated.assign(p.permeated.size(), RunMetrics::kNaN);
+        m_n = 0;
+        m_mean_t = m_mean_q = m_m_tt = m_m_qq = m_c_tq = 0.0;
+
+        m_prev = first;
+        m_prev.donor_mass = std::numeric_limits<double>::quiet_NaN();
+        add(first);
+    }
+
+    void MetricsAccumulator::add(const MetricsSample& s)
+    {
+        const auto dt = s.t - m_prev.t;
+        const auto first = m_out.samples == 0;
+        ++m_out.samples;
+
+        if (first || s.conc > m_out.c_max)
+        {
+            m_out.c_max = s.conc;
+            m_out.t_max = s.t;
+        }
+
+        if (!std::isnan(s.donor_mass))
+        {
+            const auto half = 0.5 * m_donor0;
+            if (std::isnan(m_out.t_donor_half) && m_donor0 > 0.0 && s.donor_mass <= half)
+            {
+                m_out.t_donor_half = dt > 0.0 && !std::isnan(m_prev.donor_mass)
+                    ? crossing(m_prev.t, m_prev.donor_mass, s.t, s.donor_mass, half)
+                    : s.t;
+            }
+            m_donor_last = s.donor_mass;
+        }
+
+        if (dt > 0.0)
+        {
+            const auto dq = s.sink_mass - m_prev.sink_mass;
+            const auto j  = dq / dt;
+            if (std::isnan(m_out.j_max) || j > m_out.j_max)
+            {
+                m_out.j_max   = j;
+                m_out.t_j_max = m_prev.t + 0.5 * dt;
+            }
+            m_out.auc += 0.5 * (m_prev.conc + s.conc) * dt;
+
+            for (std::size_t k = 0; k < m_targets.size(); ++k)
+            {
+                const auto target = m_sink0 + m_targets[k];
+                if (std::isnan(m_out.t_permeated[k]) && m_targets[k] > 0.0 &&
+                    s.sink_mass >= target)
+                {
+                    m_out.t_permeated[k] =
+                        crossing(m_prev.t, m_prev.sink_mass, s.t, s.sink_mass, target);
+                }
+            }
+        }
+
+        if ((first || dt > 0.0) && s.t >= m_ss_from && s.t <= m_ss_to)
+        {
+            ++m_n;
+            const auto n  = static_cast<double>(m_n);
+            const auto et = s.t - m_mean_t;
+            const auto eq = s.sink_mass - m_mean_q;
+            m_mean_t += et / n;
+            m_mean_q += eq / n;
+            m_m_tt += et * (s.t - m_mean_t);
+            m_m_qq += eq * (s.sink_mass - m_mean_q);
+            m_c_tq += et * (s.sink_mass - m_mean_q);
+        }
+
+        m_out.q_total = s.sink_mass;
+        m_prev = s;
+    }
+
+    RunMetrics MetricsAccumulator::result() const
+    {
+        auto out = m_out;
+        if (m_n >= 2 && m_m_tt > 0.0)
+        {
+            out.j_ss = m_c_tq / m_m_tt;
+            const auto intercept = m_mean_q - out.j_ss * m_mean_t;
+            if (out.j_ss > 0.0) out.t_lag = -intercept / out.j_ss;
+            out.r2_ss = m_m_qq > 0.0 ? m_c_tq * m_c_tq / (m_m_tt * m_m_qq) : 1.0;
+        }
+        if (m_donor0 > 0.0) out.depletion = (m_donor0 - m_donor_last) / m_donor0;
+        return out;
+    }
+}
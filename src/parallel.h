@@ -0,0 +1,70 @@
+#ifndef SC_PARALLEL_H
+#define SC_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sc
+{
+    // Number of worker threads to use for a requested count: 0 means "one
+    // per hardware thread", anything else is taken as is (min. 1).
+    [[nodiscard]] inline int resolveThreads(int requested) noexcept
+    {
+        if (requested > 0) return requested;
+        const auto hw = static_cast<int>(std::thread::hardware_concurrency());
+        return std::max(1, hw);
+    }
+
+    // Runs fun(i) for i in [0, n) on up to n_threads std::threads. Work is
+    // handed out one index at a time, so uneven task costs balance out.
+    // The first exception thrown by any task is re-thrown on the calling
+    // thread after all workers have joined.
+    //
+    // Tasks must not touch the R API -- only the calling thread may.
+    template <typename Fun>
+    void parallelFor(int n, int n_threads, Fun&& fun)
+    {
+        if (n <= 0) return;
+        const auto workers = std::min(n, resolveThreads(n_threads));
+        if (workers == 1)
+        {
+            for (int i = 0; i < n; ++i) fun(i);
+            return;
+        }
+
+        std::atomic<int>   next{0};
+        std::exception_ptr error;
+        std::mutex         error_mutex;
+
+        auto worker = [&]()
+        {
+            for (int i = next.fetch_add(1); i < n; i = next.fetch_add(1))
+            {
+                try
+                {
+                    fun(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    next.store(n);
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(static_cast<std::size_t>(workers - 1));
+        for (int w = 1; w < workers; ++w) pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool) th.join();
+
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+#endif  // SC_PARALLEL_H
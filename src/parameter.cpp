@@ -40,6 +40,25 @@ namespace sc
         return 1.0;
     }
 
+    std::string_view toString(StopKind k) noexcept
+    {
+        switch (k)
+        {
+            case StopKind::PermeatedFraction:  return "permeated";
+            case StopKind::DonorFractionBelow: return "donor_below";
+            case StopKind::ReceptorConcAbove:  return "receptor_above";
+        }
+        return "permeated";
+    }
+
+    std::optional<StopKind> stopKindFromString(std::string_view str) noexcept
+    {
+        if (str == "permeated")      return StopKind::PermeatedFraction;
+        if (str == "donor_below")    return StopKind::DonorFractionBelow;
+        if (str == "receptor_above") return StopKind::ReceptorConcAbove;
+        return std::nullopt;
+    }
+
     namespace
     {
         std::optional<std::string> validate(const VehicleParams& v)
@@ -65,6 +84,34 @@ namespace sc
             if (l.cross_section <= 0.0 || l.cross_section > 1.0)
                 return tag.str() + "cross_section not in (0, 1]";
             if (l.height < 3)                            return tag.str() + "height < 3 um";
+            if (l.brick.enabled)
+            {
+                const auto& b = l.brick;
+                if (b.width <= 0.0 || b.thickness <= 0.0 || b.mortar <= 0.0)
+                    return tag.str() + "brick dimensions must be > 0";
+                if (b.width <= b.mortar)                 return tag.str() + "brick.width <= mortar";
+                if (b.thickness + 2.0 * b.mortar > l.height)
+                    return tag.str() + "height too small for one brick course";
+                if (b.D_brick < 0.0)                     return tag.str() + "brick.D_brick < 0";
+                if (b.K_brick <= 0.0)                    return tag.str() + "brick.K_brick <= 0";
+                if (b.brick_cells < 1 || b.lateral_cells < 1 || b.mortar_cells < 1)
+                    return tag.str() + "brick cell counts must be >= 1";
+            }
+            return std::nullopt;
+        }
+
+        std::optional<std::string> validate(const PathwayParams& p, std::size_t idx)
+        {
+            std::ostringstream tag;
+            tag << "pathway[" << idx << "].";
+            if (p.name.empty())   return tag.str() + "name is empty";
+            if (p.layers.empty()) return tag.str() + "has no layers";
+            for (std::size_t i = 0; i < p.layers.size(); ++i)
+            {
+                if (auto err = validate(p.layers[i], i)) return tag.str() + *err;
+                if (p.layers[i].brick.enabled)
+                    return tag.str() + "layers cannot have a brick-and-mortar structure";
+            }
             return std::nullopt;
         }
 
@@ -73,6 +120,13 @@ namespace sc
             if (s.name.empty())  return "sink.name is empty";
             if (s.Vd     <= 0.0) return "sink.Vd <= 0";
             if (s.c_init <  0.0) return "sink.c_init < 0";
+            if (s.pk.enabled)
+            {
+                if (s.pk.V1  <= 0.0) return "sink.pk.V1 <= 0";
+                if (s.pk.CL  <  0.0) return "sink.pk.CL < 0";
+                if (s.pk.k12 <  0.0) return "sink.pk.k12 < 0";
+                if (s.pk.k21 <  0.0) return "sink.pk.k21 < 0";
+            }
             return std::nullopt;
         }
 
@@ -81,6 +135,48 @@ namespace sc
             if (s.resolution      <= 0)             return "sys.resolution <= 0";
             if (s.max_module      <= 0.0)           return "sys.max_module <= 0";
             if (s.simulation_time <= 0)             return "sys.simulation_time <= 0";
+            if (s.n_threads       <  0)             return "sys.n_threads < 0";
+            if (s.parareal_slices <  0)             return "sys.parareal_slices < 0";
+            if (s.parareal_coarse_step <= 0)        return "sys.parareal_coarse_step <= 0";
+            if (s.parareal_max_iter <  0)           return "sys.parareal_max_iter < 0";
+            if (s.parareal_tol    <= 0.0)           return "sys.parareal_tol <= 0";
+            if (s.steady_state_tol <  0.0)          return "sys.steady_state_tol < 0";
+            if (s.reduced_order   <  0)             return "sys.reduced_order < 0";
+            if (s.log_buffer      <  0)             return "sys.log_buffer < 0";
+            if (s.active_window_tol < 0.0 || s.active_window_tol >= 1.0)
+                return "sys.active_window_tol not in [0, 1)";
+            if (s.periodic_tol < 0.0 || s.periodic_tol >= 1.0)
+                return "sys.periodic_tol not in [0, 1)";
+            if (s.auto_resolution_tol < 0.0 || s.auto_resolution_tol >= 1.0)
+                return "sys.auto_resolution_tol not in [0, 1)";
+            if (s.mixed_precision && s.fused_sweeps)
+                return "sys.mixed_precision with sys.fused_sweeps";
+            if (s.mixed_precision && s.active_window_tol > 0.0)
+                return "sys.mixed_precision with sys.active_window_tol";
+            if (s.compact_scheme && (s.fused_sweeps || s.mixed_precision))
+                return "sys.compact_scheme with sys.fused_sweeps or sys.mixed_precision";
+            return std::nullopt;
+        }
+
+        std::optional<std::string> validate(const StopCondition& c, std::size_t idx)
+        {
+            std::ostringstream tag;
+            tag << "stop[" << idx << "].";
+            if (c.value <= 0.0) return tag.str() + "value <= 0";
+            if (c.kind == StopKind::DonorFractionBelow && c.value >= 1.0)
+                return tag.str() + "donor fraction not in (0, 1)";
+            return std::nullopt;
+        }
+
+        std::optional<std::string> validate(const MetricsParams& m)
+        {
+            if (!m.enabled) return std::nullopt;
+            if (!(m.ss_from >= 0.0 && m.ss_from < m.ss_to && m.ss_to <= 1.0))
+                return "metrics.ss_from / ss_to not 0 <= from < to <= 1";
+            for (const auto f : m.permeated)
+            {
+                if (!(f > 0.0)) return "metrics.permeated <= 0";
+            }
             return std::nullopt;
         }
 
@@ -96,12 +192,116 @@ namespace sc
     {
         if (auto err = validate(p.sys))     return err;
         if (auto err = validate(p.log))     return err;
+        if (auto err = validate(p.metrics)) return err;
         if (auto err = validate(p.sink))    return err;
         if (auto err = validate(p.vehicle)) return err;
         for (std::size_t i = 0; i < p.layers.size(); ++i)
         {
             if (auto err = validate(p.layers[i], i)) return err;
         }
+        for (std::size_t i = 0; i < p.pathways.size(); ++i)
+        {
+            if (auto err = validate(p.pathways[i], i)) return err;
+        }
+        for (std::size_t i = 0; i < p.stop.size(); ++i)
+        {
+            if (auto err = validate(p.stop[i], i)) return err;
+        }
+        if (p.sys.reduced_order > 0 &&
+            (p.vehicle.replaces() || p.vehicle.removed() || !p.stop.empty()))
+        {
+            return "sys.reduced_order does not support donor events or stop conditions";
+        }
+        if (p.sys.periodic_tol > 0.0 &&
+            (!p.vehicle.replaces() || p.vehicle.removed() || !p.stop.empty() ||
+             p.sys.reduced_order > 0 || !p.pathways.empty()))
+        {
+            return "sys.periodic_tol needs vehicle.replace_after and no donor removal, stop "
+                   "conditions, pathways or sys.reduced_order";
+        }
+        const auto n_brick = std::count_if(p.layers.begin(), p.layers.end(),
+                                           [](const LayerParams& l) { return l.brick.enabled; });
+        if (n_brick > 1)
+        {
+            return "at most one layer can have a brick-and-mortar structure";
+        }
+        if (p.sink.pk.enabled &&
+            std::any_of(p.stop.begin(), p.stop.end(), [](const StopCondition& c) {
+                return c.kind == StopKind::ReceptorConcAbove;
+            }))
+        {
+            return "a receptor_above stop condition does not support sink.pk";
+        }
+        if (p.sys.steady_state_tol > 0.0 &&
+            (p.sys.parareal() || p.sys.reduced_order > 0 || n_brick > 0 || !p.pathways.empty()))
+        {
+            return "sys.steady_state_tol does not support sys.parareal_slices, "
+                   "sys.reduced_order, brick-and-mortar layers or pathways";
+        }
+        if (p.sink.pk.enabled &&
+            (n_brick > 0 || !p.pathways.empty() || p.sys.reduced_order > 0 ||
+             p.sys.steady_state_tol > 0.0 || p.sys.periodic_tol > 0.0))
+        {
+            return "sink.pk does not support brick-and-mortar layers, pathways, "
+                   "sys.reduced_order, sys.steady_state_tol or sys.periodic_tol";
+        }
+        if (p.sys.compact_scheme && (n_brick > 0 || !p.pathways.empty() || p.sys.reduced_order > 0))
+        {
+            return "sys.compact_scheme does not support brick-and-mortar layers, pathways or "
+                   "sys.reduced_order";
+        }
+        if (p.sys.auto_resolution_tol > 0.0 &&
+            (n_brick > 0 || !p.pathways.empty() || !p.stop.empty() || p.sys.reduced_order > 0))
+        {
+            return "sys.auto_resolution_tol does not support brick-and-mortar layers, pathways, "
+                   "stop conditions or sys.reduced_order";
+        }
+        if (p.metrics.enabled &&
+            (n_brick > 0 || !p.pathways.empty() || p.sys.reduced_order > 0 || p.sys.parareal()))
+        {
+            return "metrics do not support brick-and-mortar layers, pathways, "
+                   "sys.reduced_order or sys.parareal_slices";
+        }
+        if (p.sys.log_buffer > 0 &&
+            (n_brick > 0 || !p.pathways.empty() || p.sys.reduced_order > 0 || p.sys.parareal()))
+        {
+            return "sys.log_buffer does not support brick-and-mortar layers, pathways, "
+                   "sys.reduced_order or sys.parareal_slices";
+        }
+        if (n_brick > 0 && (p.vehicle.replaces() || p.vehicle.removed() || !p.stop.empty() ||
+                            p.sys.reduced_order > 0))
+        {
+            return "a brick-and-mortar layer does not support donor events, stop conditions "
+                   "or sys.reduced_order";
+        }
+        if (!p.pathways.empty())
+        {
+            if (p.layers.empty())
+            {
+                return "pathways need at least one layer in the main stack";
+            }
+            if (n_brick > 0 || p.vehicle.removed() || !p.stop.empty() || p.sys.reduced_order > 0)
+            {
+                return "pathways do not support brick-and-mortar layers, donor removal, stop "
+                       "conditions or sys.reduced_order";
+            }
+            // Shunt layers are logged next to the main ones, by name.
+            std::vector<std::string> names{p.vehicle.name};
+            for (const auto& l : p.layers) names.push_back(l.name);
+            for (const auto& pw : p.pathways)
+            {
+                for (const auto& l : pw.layers) names.push_back(l.name);
+            }
+            std::sort(names.begin(), names.end());
+            if (std::adjacent_find(names.begin(), names.end()) != names.end())
+            {
+                return "compartment names must be unique when pathways are used";
+            }
+        }
+        if (p.vehicle.lumped && p.layers.empty())
+        {
+            return "a lumped vehicle needs at least one layer";
+        }
         if (p.vehicle.removed() && p.layers.empty())
         {
             return "cannot remove the vehicle if no layers are defined";
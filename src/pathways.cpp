@@ -0,0 +1,329 @@
+#include "pathways.h"
+
+#include "algorithms.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace sc
+{
+    namespace
+    {
+        // Bands of `op` for the cells [from, to).
+        TDMatrix slice(const TDMatrix& op, int from, int to)
+        {
+            TDMatrix result(to - from);
+            for (int i = from; i < to; ++i)
+            {
+                result.diag(i - from) = op.diag(i);
+                if (i + 1 < to)
+                {
+                    result.lower(i - from) = op.lower(i);
+                    result.upper(i - from) = op.upper(i);
+                }
+            }
+            return result;
+        }
+
+        // I + s * a
+        TDMatrix shifted(const TDMatrix& a, double s)
+        {
+            const auto n = a.size();
+            TDMatrix result(n);
+            for (int i = 0; i < n; ++i) result.diag(i) = 1.0 + s * a.diag(i);
+            for (int i = 0; i < n - 1; ++i)
+            {
+                result.lower(i) = s * a.lower(i);
+                result.upper(i) = s * a.upper(i);
+            }
+            return result;
+        }
+
+        double harmonic(double k_l, double h_l, double k_r, double h_r) noexcept
+        {
+            const auto den = h_l * k_r + h_r * k_l;
+            return den > 0.0 ? 2.0 * k_l * k_r / den : 0.0;
+        }
+
+        void axpy(double a, const std::vector<double>& x, std::vector<double>& y) noexcept
+        {
+            for (std::size_t i = 0; i < y.size(); ++i) y[i] += a * x[i];
+        }
+    }
+
+    void Pathways::build(const std::vector<PathwayParams>& pathways,
+                         const std::vector<Compartment>& compartments, const Geometry& geometry,
+                         const Sink& sink, const TDMatrix& op, int n_ts, int resolution,
+                         double max_module)
+    {
+        m_chains.clear();
+        m_layers.clear();
+        m_layer_chain.clear();
+        if (pathways.empty()) return;
+
+        const auto& donor = compartments.front();
+        const auto& h     = geometry.spaceSteps();
+        m_v = donor.geo_to;
+        m_s = sink.geo_from;
+        assert(m_s > m_v + 1);
+
+        // An infinite-dose donor is clamped and a lumped one has no
+        // internal resistance; both couple through the skin side only
+        // (see MatrixBuilder).
+        const auto clamped       = !donor.finite_dose;
+        const auto dirichlet_top = clamped || donor.lumped;
+        const auto h_v     = h[static_cast<std::size_t>(m_v)];
+        const auto w_v     = donor.K * donor.area_um2 * h_v;
+        const auto w_s     = sink.area_um2 * h[static_cast<std::size_t>(m_s)];
+
+        m_diag_S[kV] = op.diag(m_v);
+        m_diag_S[kS] = op.diag(m_s);
+
+        if (m_v > 0)
+        {
+            addChain(slice(op, 0, m_v), -1, kV, 0.0, op.upper(m_v - 1), 0.0, op.lower(m_v - 1));
+        }
+        addChain(slice(op, m_v + 1, m_s), kV, kS, op.lower(m_v), op.upper(m_s - 1),
+                 op.upper(m_v), op.lower(m_s - 1));
+        m_first_pathway = m_chains.size();
+
+        double rate = 0.0;
+        for (const auto& pw : pathways)
+        {
+            std::vector<Compartment> comps;
+            for (const auto& l : pw.layers)
+            {
+                Compartment c{l.height, l.D, l.K, donor.area_um2 * l.cross_section, l.name};
+                c.c_init = l.c_init * 1.0e-12;   // mg/ml -> mg/um^3
+                comps.push_back(std::move(c));
+            }
+            Geometry g;
+            g.create(comps, resolution);
+            const auto n   = g.size();
+            const auto& hp = g.spaceSteps();
+
+            std::vector<double> K(static_cast<std::size_t>(n)), kappa(K.size()), w(K.size());
+            for (const auto& c : comps)
+            {
+                for (int i = c.geo_from; i <= c.geo_to; ++i)
+                {
+                    const auto idx = static_cast<std::size_t>(i);
+                    K[idx]     = c.K;
+                    kappa[idx] = c.K * c.area_um2 * c.D;
+                    w[idx]     = c.K * c.area_um2 * hp[idx];
+                }
+            }
+
+            // Faces: vehicle / first cell, interior, last cell / sink. The
+            // vehicle side of the top face is the column above the pathway.
+            std::vector<double> alpha(static_cast<std::size_t>(n + 1));
+            const auto kappa_v = donor.K * comps.front().area_um2 * donor.D;
+            alpha[0] = dirichlet_top ? 2.0 * kappa[0] / hp[0]
+                                     : harmonic(kappa_v, h_v, kappa[0], hp[0]);
+            for (int i = 1; i < n; ++i)
+            {
+                const auto l = static_cast<std::size_t>(i - 1), r = static_cast<std::size_t>(i);
+                alpha[r] = harmonic(kappa[l], hp[l], kappa[r], hp[r]);
+            }
+            const auto last = static_cast<std::size_t>(n - 1);
+            alpha[last + 1] = 2.0 * kappa[last] / hp[last];
+
+            TDMatrix a(n);
+            for (int i = 0; i < n; ++i)
+            {
+                const auto idx = static_cast<std::size_t>(i);
+                a.diag(i) = -(alpha[idx] + alpha[idx + 1]) / w[idx];
+                if (i > 0)     a.lower(i - 1) = alpha[idx] / w[idx];
+                if (i < n - 1) a.upper(i)     = alpha[idx + 1] / w[idx];
+            }
+            rate = std::max(rate, a.absMax());
+
+            if (!clamped) m_diag_S[kV] -= alpha[0] / w_v;
+            addChain(a, kV, kS, alpha[0] / w[0], 0.0, clamped ? 0.0 : alpha[0] / w_v,
+                     alpha[last + 1] / w_s);
+
+            auto& chain = m_chains.back();
+            chain.h.assign(hp.begin(), hp.end());
+            chain.K = K;
+            for (auto& c : comps)
+            {
+                for (int i = c.geo_from; i <= c.geo_to; ++i)
+                {
+                    chain.x[static_cast<std::size_t>(i)] = c.c_init / c.K;
+                }
+                m_layers.push_back(std::move(c));
+                m_layer_chain.push_back(m_chains.size() - 1);
+            }
+        }
+        rate = std::max(rate, std::abs(m_diag_S[kV]));
+
+        m_n_sub = std::max(n_ts, static_cast<int>(std::ceil(rate / max_module)));
+        m_tau   = 0.5 / m_n_sub;
+        prepare();
+    }
+
+    void Pathways::addChain(const TDMatrix& a, int top, int bot, double to_top, double to_bot,
+                            double from_top, double from_bot)
+    {
+        Chain c;
+        c.rhs      = a;   // the chain's operator until prepare()
+        c.x.assign(static_cast<std::size_t>(a.size()), 0.0);
+        c.top      = top;
+        c.bot      = bot;
+        c.to_top   = to_top;
+        c.to_bot   = to_bot;
+        c.from_top = from_top;
+        c.from_bot = from_bot;
+        m_chains.push_back(std::move(c));
+    }
+
+    void Pathways::prepare()
+    {
+        const auto tau = m_tau;
+        double S[2][2] = {{1.0 - tau * m_diag_S[kV], 0.0}, {0.0, 1.0 - tau * m_diag_S[kS]}};
+
+        for (auto& c : m_chains)
+        {
+            const auto a = c.rhs;
+            c.rhs = shifted(a, tau);
+            c.lhs = shifted(a, -tau);
+            algorithm::prepareThomas(c.lhs);
+
+            const auto n = c.x.size();
+            auto response = [&](double coupling, std::size_t row)
+            {
+                std::vector<double> r;
+                if (coupling == 0.0) return r;
+                r.assign(n, 0.0);
+                r[row] = tau * coupling;
+                algorithm::thomasReUseIP(static_cast<const TDMatrix&>(c.lhs), r);
+                return r;
+            };
+            c.r_top = c.top >= 0 ? response(c.to_top, 0) : std::vector<double>{};
+            c.r_bot = c.bot >= 0 ? response(c.to_bot, n - 1) : std::vector<double>{};
+
+            // S = L_SS - sum_c L_Sc r_c, with L_Sc = -tau * from_*.
+            if (c.top >= 0)
+            {
+                if (!c.r_top.empty()) S[c.top][c.top] -= tau * c.from_top * c.r_top.front();
+                if (!c.r_bot.empty()) S[c.top][c.bot] -= tau * c.from_top * c.r_bot.front();
+            }
+            if (c.bot >= 0)
+            {
+                if (!c.r_top.empty()) S[c.bot][c.top] -= tau * c.from_bot * c.r_top.back();
+                if (!c.r_bot.empty()) S[c.bot][c.bot] -= tau * c.from_bot * c.r_bot.back();
+            }
+        }
+
+        const auto det = S[0][0] * S[1][1] - S[0][1] * S[1][0];
+        assert(det != 0.0);
+        m_S_inv[0][0] =  S[1][1] / det;
+        m_S_inv[0][1] = -S[0][1] / det;
+        m_S_inv[1][0] = -S[1][0] / det;
+        m_S_inv[1][1] =  S[0][0] / det;
+    }
+
+    void Pathways::step()
+    {
+        const auto tau = m_tau;
+        double g[2];
+        for (int k = 0; k < 2; ++k) g[k] = m_x_S[k] + tau * m_diag_S[k] * m_x_S[k];
+
+        // Explicit half and chain solves for the old shared values; the
+        // shared rows pick up the chain ends before and after.
+        for (auto& c : m_chains)
+        {
+            auto& x = c.x;
+            if (c.top >= 0) g[c.top] += tau * c.from_top * x.front();
+            if (c.bot >= 0) g[c.bot] += tau * c.from_bot * x.back();
+
+            if (x.size() > 1)
+            {
+                algorithm::crankNicolsonStepIP(c.rhs, static_cast<const TDMatrix&>(c.lhs), x);
+            }
+            else
+            {
+                x[0] = c.rhs.diag(0) * x[0] * c.lhs.diag(0);   // prepared: 1 / diag
+            }
+            if (!c.r_top.empty()) axpy(m_x_S[c.top], c.r_top, x);
+            if (!c.r_bot.empty()) axpy(m_x_S[c.bot], c.r_bot, x);
+
+            if (c.top >= 0) g[c.top] += tau * c.from_top * x.front();
+            if (c.bot >= 0) g[c.bot] += tau * c.from_bot * x.back();
+        }
+
+        m_x_S[kV] = m_S_inv[0][0] * g[0] + m_S_inv[0][1] * g[1];
+        m_x_S[kS] = m_S_inv[1][0] * g[0] + m_S_inv[1][1] * g[1];
+
+        for (auto& c : m_chains)
+        {
+            if (!c.r_top.empty()) axpy(m_x_S[c.top], c.r_top, c.x);
+            if (!c.r_bot.empty()) axpy(m_x_S[c.bot], c.r_bot, c.x);
+        }
+    }
+
+    void Pathways::advanceMinute(std::vector<double>& state)
+    {
+        const auto v = static_cast<std::size_t>(m_v);
+        const auto s = static_cast<std::size_t>(m_s);
+        const auto skin = m_first_pathway - 1;
+        if (skin > 0) std::copy(state.begin(), state.begin() + m_v, m_chains[0].x.begin());
+        std::copy(state.begin() + m_v + 1, state.begin() + m_s, m_chains[skin].x.begin());
+        m_x_S[kV] = state[v];
+        m_x_S[kS] = state[s];
+
+        for (int ts = 0; ts < m_n_sub; ++ts) step();
+
+        if (skin > 0) std::copy(m_chains[0].x.begin(), m_chains[0].x.end(), state.begin());
+        std::copy(m_chains[skin].x.begin(), m_chains[skin].x.end(), state.begin() + m_v + 1);
+        state[v] = m_x_S[kV];
+        state[s] = m_x_S[kS];
+    }
+
+    const Pathways::Chain& Pathways::chainOf(std::size_t k) const
+    {
+        return m_chains[m_layer_chain[k]];
+    }
+
+    double Pathways::mass(std::size_t k, double scale) const
+    {
+        const auto& comp = m_layers[k];
+        const auto& c    = chainOf(k);
+        double mass = 0.0;
+        for (int i = comp.geo_from; i <= comp.geo_to; ++i)
+        {
+            const auto idx = static_cast<std::size_t>(i);
+            mass += c.x[idx] * c.K[idx] * c.h[idx];
+        }
+        return mass * scale * comp.area_um2;
+    }
+
+    std::vector<double> Pathways::profile(std::size_t k, double scale) const
+    {
+        const auto& comp = m_layers[k];
+        const auto& c    = chainOf(k);
+        std::vector<double> result;
+        for (int i = comp.geo_from; i <= comp.geo_to; ++i)
+        {
+            const auto idx = static_cast<std::size_t>(i);
+            result.push_back(c.x[idx] * c.K[idx] * scale * 1.0e12);
+        }
+        return result;
+    }
+
+    std::vector<double> Pathways::depths(std::size_t k) const
+    {
+        const auto& comp = m_layers[k];
+        const auto& c    = chainOf(k);
+        std::vector<double> result;
+        double pos = 0.0;
+        for (int i = comp.geo_from; i <= comp.geo_to; ++i)
+        {
+            const auto step = c.h[static_cast<std::size_t>(i)];
+            result.push_back(pos + step / 2.0);
+            pos += step;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,494 @@
+#include "population.h"
+
+#include "autoresolution.h"
+#include "parallel.h"
+#include "sensitivity.h"
+#include "system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace sc
+{
+    namespace
+    {
+        constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+        constexpr double kPi  = 3.14159265358979323846;
+
+        // Scale function k1 of the t-digest and its inverse.
+        double scaleK(double q, double compression)
+        {
+            return compression / (2.0 * kPi) * std::asin(2.0 * q - 1.0);
+        }
+
+        double scaleQ(double k, double compression)
+        {
+            if (k >= compression / 4.0) return 1.0;
+            return (std::sin(2.0 * kPi * k / compression) + 1.0) / 2.0;
+        }
+
+        std::uint64_t splitmix64(std::uint64_t& state)
+        {
+            std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in (0, 1), never 0 or 1.
+        double uniform(std::uint64_t& state)
+        {
+            return (static_cast<double>(splitmix64(state) >> 11) + 0.5) * 0x1.0p-53;
+        }
+
+        double normalCdf(double z) { return 0.5 * std::erfc(-z / std::sqrt(2.0)); }
+
+        double factorValue(const PopulationFactor& f, double z)
+        {
+            using Dist = PopulationFactor::Dist;
+            switch (f.dist)
+            {
+                case Dist::Normal:     return f.a + f.b * z;
+                case Dist::LogNormal:  return std::exp(f.a + f.b * z);
+                case Dist::Uniform:    return f.a + (f.b - f.a) * normalCdf(z);
+                case Dist::LogUniform:
+                    return std::exp(std::log(f.a) + (std::log(f.b) - std::log(f.a)) * normalCdf(z));
+            }
+            return kNaN;
+        }
+
+        const LayerParams* findLayer(const Parameters& p, const std::string& name)
+        {
+            for (const auto& l : p.layers)
+            {
+                if (l.name == name) return &l;
+            }
+            for (const auto& pw : p.pathways)
+            {
+                for (const auto& l : pw.layers)
+                {
+                    if (l.name == name) return &l;
+                }
+            }
+            return nullptr;
+        }
+
+        // Volume (ml) of the vehicle or layer `name` of `p`.
+        double compartmentVolume(const Parameters& p, const std::string& name)
+        {
+            if (name == p.vehicle.name) return p.vehicle.app_area * p.vehicle.height * 1e-4;
+            const auto* l = findLayer(p, name);
+            return p.vehicle.app_area * l->cross_section * l->height * 1e-4;
+        }
+
+        // Series values of a finished run, [series * times.size() + time].
+        std::vector<double> seriesOf(const System& sys, const std::vector<PopulationSeries>& series,
+                                     const std::vector<double>& times,
+                                     const std::vector<double>& volumes)
+        {
+            const auto& p     = sys.parameters();
+            const auto& names = sys.compartmentNames();
+            std::vector<double> out;
+            out.reserve(series.size() * times.size());
+            for (std::size_t s = 0; s < series.size(); ++s)
+            {
+                const MassSeries* from    = nullptr;
+                double            divisor = 1.0;
+                switch (series[s].kind)
+                {
+                    case PopulationSeries::Kind::Permeated:
+                        from    = &sys.sinkMass();
+                        divisor = p.vehicle.app_area;
+                        break;
+                    case PopulationSeries::Kind::Compartment:
+                    {
+                        const auto it = std::find(names.begin(), names.end(), series[s].name);
+                        from    = &sys.compartmentMass()[static_cast<std::size_t>(
+                            std::distance(names.begin(), it))];
+                        divisor = volumes[s];
+                        break;
+                    }
+                    case PopulationSeries::Kind::Plasma:
+                        from = &sys.plasma();
+                        break;
+                }
+                for (const auto t : times) out.push_back(from->at(t) / divisor);
+            }
+            return out;
+        }
+    }
+
+    TDigest::TDigest(double compression) : m_compression(compression)
+    {
+        if (!(compression >= 10.0))
+        {
+            throw std::invalid_argument("TDigest: compression must be at least 10");
+        }
+    }
+
+    void TDigest::add(double x, double weight)
+    {
+        if (!std::isfinite(x) || !(weight > 0.0)) return;
+        if (m_count == 0.0)
+        {
+            m_min = m_max = x;
+        }
+        else
+        {
+            m_min = std::min(m_min, x);
+            m_max = std::max(m_max, x);
+        }
+        m_count += weight;
+        m_buffer.push_back(Centroid{x, weight});
+        if (m_buffer.size() >= static_cast<std::size_t>(5.0 * m_compression)) fold();
+    }
+
+    void TDigest::merge(const TDigest& other)
+    {
+        if (other.m_count == 0.0) return;
+        other.fold();
+        if (m_count == 0.0)
+        {
+            m_min = other.m_min;
+            m_max = other.m_max;
+        }
+        else
+        {
+            m_min = std::min(m_min, other.m_min);
+            m_max = std::max(m_max, other.m_max);
+        }
+        m_count += other.m_count;
+        m_buffer.insert(m_buffer.end(), other.m_centroids.begin(), other.m_centroids.end());
+        fold();
+    }
+
+    // Sorts the buffer into the centroids and merges neighbours while the
+    // merged centroid spans at most one unit of k.
+    void TDigest::fold() const
+    {
+        if (m_buffer.empty()) return;
+        m_buffer.insert(m_buffer.end(), m_centroids.begin(), m_centroids.end());
+        std::stable_sort(m_buffer.begin(), m_buffer.end(),
+                         [](const Centroid& x, const Centroid& y) { return x.mean < y.mean; });
+
+        m_centroids.clear();
+        m_centroids.push_back(m_buffer.front());
+        double before = 0.0;   // weight left of the last centroid
+        double limit  = m_count * scaleQ(scaleK(0.0, m_compression) + 1.0, m_compression);
+        for (std::size_t i = 1; i < m_buffer.size(); ++i)
+        {
+            auto&      last = m_centroids.back();
+            const auto& c   = m_buffer[i];
+            if (before + last.weight + c.weight <= limit)
+            {
+                last.weight += c.weight;
+                last.mean += (c.mean - last.mean) * c.weight / last.weight;
+            }
+            else
+            {
+                before += last.weight;
+                limit = m_count * scaleQ(scaleK(before / m_count, m_compression) + 1.0,
+                                         m_compression);
+                m_centroids.push_back(c);
+            }
+        }
+        m_buffer.clear();
+    }
+
+    double TDigest::quantile(double q) const
+    {
+        if (m_count == 0.0 || !(q >= 0.0 && q <= 1.0)) return kNaN;
+        fold();
+        if (m_centroids.size() == 1) return m_centroids.front().mean;
+
+        const double index = q * m_count;
+        const auto&  first = m_centroids.front();
+        const auto&  last  = m_centroids.back();
+        if (index <= first.weight / 2.0)
+        {
+            return m_min + (first.mean - m_min) * index / (first.weight / 2.0);
+        }
+        if (index >= m_count - last.weight / 2.0)
+        {
+            return m_max - (m_max - last.mean) * (m_count - index) / (last.weight / 2.0);
+        }
+        // Between the centres of two neighbouring centroids.
+        double centre = first.weight / 2.0;
+        for (std::size_t i = 0; i + 1 < m_centroids.size(); ++i)
+        {
+            const auto& a    = m_centroids[i];
+            const auto& b    = m_centroids[i + 1];
+            const auto  step = (a.weight + b.weight) / 2.0;
+            if (index <= centre + step)
+            {
+                return a.mean + (b.mean - a.mean) * (index - centre) / step;
+            }
+            centre += step;
+        }
+        return last.mean;
+    }
+
+    std::size_t TDigest::centroids() const
+    {
+        fold();
+        return m_centroids.size();
+    }
+
+    PopulationSampler::PopulationSampler(std::vector<PopulationFactor> factors,
+                                         const std::vector<double>& correlation,
+                                         std::uint64_t seed)
+        : m_factors(std::move(factors)), m_seed(seed)
+    {
+        const auto n = m_factors.size();
+        m_chol.assign(n * n, 0.0);
+        if (correlation.empty())
+        {
+            for (std::size_t i = 0; i < n; ++i) m_chol[i * n + i] = 1.0;
+            return;
+        }
+        if (correlation.size() != n * n)
+        {
+            throw std::invalid_argument("the correlation matrix must be n_factors x n_factors");
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (std::abs(correlation[i * n + i] - 1.0) > 1e-12)
+            {
+                throw std::invalid_argument("the correlation matrix needs a unit diagonal");
+            }
+            for (std::size_t j = 0; j < i; ++j)
+            {
+                const auto c = correlation[i * n + j];
+                if (!(std::abs(c) <= 1.0) || std::abs(c - correlation[j * n + i]) > 1e-12)
+                {
+                    throw std::invalid_argument(
+                        "the correlation matrix must be symmetric with entries in [-1, 1]");
+                }
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (std::size_t j = 0; j <= i; ++j)
+            {
+                double s = correlation[i * n + j];
+                for (std::size_t k = 0; k < j; ++k) s -= m_chol[i * n + k] * m_chol[j * n + k];
+                if (i == j)
+                {
+                    if (!(s > 1e-12))
+                    {
+                        throw std::invalid_argument(
+                            "the correlation matrix is not positive definite");
+                    }
+                    m_chol[i * n + i] = std::sqrt(s);
+                }
+                else
+                {
+                    m_chol[i * n + j] = s / m_chol[j * n + j];
+                }
+            }
+        }
+    }
+
+    std::vector<double> PopulationSampler::draw(std::uint64_t subject) const
+    {
+        const auto n = m_factors.size();
+        std::uint64_t state = m_seed;
+        state = splitmix64(state) ^ (subject * 0xD1B54A32D192ED03ULL);
+
+        // Box-Muller, two normals per pair of uniforms.
+        std::vector<double> e(n);
+        for (std::size_t i = 0; i < n; i += 2)
+        {
+            const auto r  = std::sqrt(-2.0 * std::log(uniform(state)));
+            const auto th = 2.0 * kPi * uniform(state);
+            e[i] = r * std::cos(th);
+            if (i + 1 < n) e[i + 1] = r * std::sin(th);
+        }
+        std::vector<double> out(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double z = 0.0;
+            for (std::size_t k = 0; k <= i; ++k) z += m_chol[i * n + k] * e[k];
+            out[i] = factorValue(m_factors[i], z);
+        }
+        return out;
+    }
+
+    std::optional<std::string> populationError(const Parameters& base,
+                                               const std::vector<PopulationFactor>& factors,
+                                               const std::vector<double>& correlation,
+                                               const std::vector<PopulationSeries>& series,
+                                               const std::vector<double>& times)
+    {
+        if (auto err = validate(base)) return err;
+        if (factors.empty()) return "no factors to draw";
+        if (series.empty()) return "no series to summarise";
+        if (times.empty()) return "no output times";
+
+        using Dist = PopulationFactor::Dist;
+        for (std::size_t j = 0; j < factors.size(); ++j)
+        {
+            const auto& f = factors[j];
+            for (std::size_t i = 0; i < j; ++i)
+            {
+                if (factors[i].path == f.path) return "factor " + f.path + " is given twice";
+            }
+            Parameters probe = base;
+            if (!setParameter(probe, f.path, 1.0)) return "no numeric parameter " + f.path;
+            if (!std::isfinite(f.a) || !std::isfinite(f.b))
+            {
+                return "factor " + f.path + " needs finite distribution parameters";
+            }
+            if ((f.dist == Dist::Normal || f.dist == Dist::LogNormal) && !(f.b > 0.0))
+            {
+                return "factor " + f.path + " needs a positive spread";
+            }
+            if ((f.dist == Dist::Uniform || f.dist == Dist::LogUniform) && !(f.a < f.b))
+            {
+                return "factor " + f.path + " needs a range with lower < upper";
+            }
+            if (f.dist == Dist::LogUniform && !(f.a > 0.0))
+            {
+                return "factor " + f.path + " is drawn log-uniformly and needs lower > 0";
+            }
+        }
+        try
+        {
+            const PopulationSampler check(factors, correlation, 0);
+        }
+        catch (const std::invalid_argument& e)
+        {
+            return std::string(e.what());
+        }
+
+        for (const auto& s : series)
+        {
+            if (s.kind == PopulationSeries::Kind::Compartment && s.name != base.vehicle.name &&
+                !findLayer(base, s.name))
+            {
+                return "no vehicle or layer named " + s.name;
+            }
+            if (s.kind == PopulationSeries::Kind::Plasma && !base.sink.pk.enabled)
+            {
+                return "plasma concentrations need sink.pk";
+            }
+        }
+        for (const auto t : times)
+        {
+            if (!(t >= 0.0 && t <= base.sys.simulation_time))
+            {
+                return "output time " + std::to_string(t) + " min is outside the run";
+            }
+        }
+        return std::nullopt;
+    }
+
+    PopulationSummary simulatePopulation(const Parameters& base,
+                                         const std::vector<PopulationFactor>& factors,
+                                         const std::vector<double>& correlation,
+                                         const std::vector<PopulationSeries>& series,
+                                         const std::vector<double>& times, std::size_t n,
+                                         std::uint64_t seed, int n_threads, std::size_t chunk,
+                                         double compression,
+                                         const std::function<void()>& between_chunks)
+    {
+        if (auto err = populationError(base, factors, correlation, series, times))
+        {
+            throw std::invalid_argument(*err);
+        }
+        if (chunk == 0) throw std::invalid_argument("simulatePopulation: chunk must be >= 1");
+
+        // Log only the series summarised, and no metrics.
+        Parameters p = base;
+        p.sys.n_threads = 1;
+        p.log.cdp_dir.clear();
+        p.log.enabled      = true;
+        p.metrics.enabled  = false;
+        p.vehicle.log_mass = false;
+        p.vehicle.log_cdp  = false;
+        for (auto& l : p.layers) l.log_mass = l.log_cdp = false;
+        for (auto& pw : p.pathways)
+        {
+            for (auto& l : pw.layers) l.log_mass = l.log_cdp = false;
+        }
+        p.sink.log_mass = false;
+        for (const auto& s : series)
+        {
+            if (s.kind == PopulationSeries::Kind::Permeated) p.sink.log_mass = true;
+            if (s.kind != PopulationSeries::Kind::Compartment) continue;
+            if (s.name == p.vehicle.name)
+            {
+                p.vehicle.log_mass = true;
+                continue;
+            }
+            for (auto& l : p.layers) l.log_mass = l.log_mass || l.name == s.name;
+            for (auto& pw : p.pathways)
+            {
+                for (auto& l : pw.layers) l.log_mass = l.log_mass || l.name == s.name;
+            }
+        }
+
+        const PopulationSampler sampler(factors, correlation, seed);
+        auto subject = [&](std::size_t i) -> std::vector<double> {
+            Parameters q = p;
+            const auto values = sampler.draw(i);
+            for (std::size_t j = 0; j < factors.size(); ++j)
+            {
+                setParameter(q, factors[j].path, values[j]);
+            }
+            if (validate(q)) return {};
+            std::vector<double> volumes(series.size(), 1.0);
+            for (std::size_t s = 0; s < series.size(); ++s)
+            {
+                if (series[s].kind == PopulationSeries::Kind::Compartment)
+                {
+                    volumes[s] = compartmentVolume(q, series[s].name);
+                }
+            }
+            try
+            {
+                if (q.sys.auto_resolution_tol > 0.0)
+                {
+                    const auto choice = chooseResolution(q);
+                    q.sys.resolution = choice.resolution;
+                    q.sys.max_module = choice.max_module;
+                }
+                System sys(std::move(q));
+                if (sys.run() == System::Result::Failed) return {};
+                return seriesOf(sys, series, times, volumes);
+            }
+            catch (const std::runtime_error&)
+            {
+                return {};
+            }
+        };
+
+        PopulationSummary out;
+        out.n_times = times.size();
+        out.sketches.assign(series.size() * times.size(), TDigest(compression));
+        std::vector<std::vector<double>> rows;
+        for (std::size_t from = 0; from < n; from += chunk)
+        {
+            const auto count = std::min(chunk, n - from);
+            rows.assign(count, {});
+            parallelFor(static_cast<int>(count), n_threads, [&](int k) {
+                rows[static_cast<std::size_t>(k)] = subject(from + static_cast<std::size_t>(k));
+            });
+            for (const auto& row : rows)
+            {
+                ++out.subjects;
+                if (row.empty())
+                {
+                    ++out.failed;
+                    continue;
+                }
+                for (std::size_t c = 0; c < row.size(); ++c) out.sketches[c].add(row[c]);
+            }
+            if (between_chunks) between_chunks();
+        }
+        return out;
+    }
+}
@@ -0,0 +1,357 @@
+#include "rcpp_altrep.h"
+
+#include "cdpstore.h"
+
+#include <R_ext/Altrep.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+
+using namespace sc;
+
+namespace
+{
+    // An ALTREP real vector over a CdpMapping. data1 is an external
+    // pointer owning the mapping (unmapped when collected), data2 the
+    // file path. A duplicate maps the file again: the mappings are
+    // copy-on-write, so copies stay independent without reading the file.
+    // Without a Serialized_state method, saveRDS() and friends write the
+    // values as an ordinary vector.
+    R_altrep_class_t cdp_class;
+
+    CdpMapping* mapping(SEXP x)
+    {
+        return static_cast<CdpMapping*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+    }
+
+    void finalizeMapping(SEXP ptr)
+    {
+        delete static_cast<CdpMapping*>(R_ExternalPtrAddr(ptr));
+        R_ClearExternalPtr(ptr);
+    }
+
+    // nullptr if the file cannot be mapped.
+    SEXP newCdpVector(SEXP path)
+    {
+        auto m = CdpMapping::open(CHAR(STRING_ELT(path, 0)));
+        if (!m) return nullptr;
+        SEXP ptr = PROTECT(R_MakeExternalPtr(m.release(), R_NilValue, R_NilValue));
+        R_RegisterCFinalizerEx(ptr, finalizeMapping, TRUE);
+        SEXP out = R_new_altrep(cdp_class, ptr, path);
+        UNPROTECT(1);
+        return out;
+    }
+
+    R_xlen_t cdpLength(SEXP x)
+    {
+        const auto* m = mapping(x);
+        return static_cast<R_xlen_t>(m->depths() * m->times());
+    }
+
+    Rboolean cdpInspect(SEXP x, int, int, int, void (*)(SEXP, int, int, int))
+    {
+        Rprintf(" skindiff CDP store %s\n", CHAR(STRING_ELT(R_altrep_data2(x), 0)));
+        return TRUE;
+    }
+
+    SEXP cdpDuplicate(SEXP x, Rboolean)
+    {
+        return newCdpVector(R_altrep_data2(x));
+    }
+
+    void* cdpDataptr(SEXP x, Rboolean)
+    {
+        return mapping(x)->data();
+    }
+
+    const void* cdpDataptrOrNull(SEXP x)
+    {
+        return mapping(x)->data();
+    }
+
+    double cdpElt(SEXP x, R_xlen_t i)
+    {
+        return mapping(x)->data()[i];
+    }
+
+    R_xlen_t cdpGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, double* buf)
+    {
+        const auto k = std::max<R_xlen_t>(0, std::min(n, cdpLength(x) - i));
+        std::memcpy(buf, mapping(x)->data() + i, static_cast<std::size_t>(k) * sizeof(double));
+        return k;
+    }
+
+    // An ALTREP real vector over a series of a finished run. data1 is the
+    // run pointer, shared by all vectors of one result, so the series live
+    // as long as any of them; data2 a list of the spec (kind, series,
+    // length, divisor) and, once something needed the whole vector in
+    // memory, that copy. Until then elements are read from the run.
+    R_altrep_class_t series_class;
+
+    enum class SeriesKind
+    {
+        MassTime  = 0,   // times of mass series `series`
+        MassValue = 1,   // its values / divisor, NA beyond its end
+        Cdp       = 2    // profiles of CDP series `series`, [depth, time]
+    };
+
+    void finalizeRun(SEXP ptr)
+    {
+        delete static_cast<RunSeries*>(R_ExternalPtrAddr(ptr));
+        R_ClearExternalPtr(ptr);
+    }
+
+    // Mass series k: the compartments', then the sink's.
+    const MassSeries& massSeries(const RunSeries& run, std::size_t k)
+    {
+        const auto& comp = run.logged.mass;
+        return k < comp.size() ? comp[k] : run.logged.sink_mass;
+    }
+
+    SEXP newSeriesVector(SEXP run, SeriesKind kind, std::size_t series, std::size_t length,
+                         double divisor)
+    {
+        SEXP spec = PROTECT(Rf_allocVector(REALSXP, 4));
+        REAL(spec)[0] = static_cast<double>(kind);
+        REAL(spec)[1] = static_cast<double>(series);
+        REAL(spec)[2] = static_cast<double>(length);
+        REAL(spec)[3] = divisor;
+        SEXP state = PROTECT(Rf_allocVector(VECSXP, 2));
+        SET_VECTOR_ELT(state, 0, spec);
+        SEXP out = R_new_altrep(series_class, run, state);
+        UNPROTECT(2);
+        return out;
+    }
+
+    const double* seriesSpec(SEXP x)
+    {
+        return REAL(VECTOR_ELT(R_altrep_data2(x), 0));
+    }
+
+    SEXP seriesCopy(SEXP x)
+    {
+        return VECTOR_ELT(R_altrep_data2(x), 1);
+    }
+
+    R_xlen_t seriesLength(SEXP x)
+    {
+        return static_cast<R_xlen_t>(seriesSpec(x)[2]);
+    }
+
+    Rboolean seriesInspect(SEXP x, int, int, int, void (*)(SEXP, int, int, int))
+    {
+        Rprintf(" skindiff run series%s\n", Rf_isNull(seriesCopy(x)) ? "" : " (in memory)");
+        return TRUE;
+    }
+
+    double seriesValue(SEXP x, R_xlen_t i)
+    {
+        const auto* spec = seriesSpec(x);
+        const auto* run  = runOf(R_altrep_data1(x));
+        if (!run) return NA_REAL;
+        const auto k = static_cast<std::size_t>(i);
+        const auto s = static_cast<std::size_t>(spec[1]);
+        switch (static_cast<SeriesKind>(static_cast<int>(spec[0])))
+        {
+            case SeriesKind::MassTime:
+                return massSeries(*run, s).times[k];
+            case SeriesKind::MassValue:
+            {
+                const auto& v = massSeries(*run, s).values;
+                return k < v.size() ? v[k] / spec[3] : NA_REAL;
+            }
+            case SeriesKind::Cdp:
+            {
+                const auto& c  = run->logged.cdp[s];
+                const auto  nd = c.depths_um.size();
+                return c.conc_per_time[k / nd][k % nd];
+            }
+        }
+        return NA_REAL;
+    }
+
+    R_xlen_t seriesGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, double* buf)
+    {
+        const auto k = std::max<R_xlen_t>(0, std::min(n, seriesLength(x) - i));
+        SEXP copy = seriesCopy(x);
+        if (!Rf_isNull(copy))
+        {
+            std::memcpy(buf, REAL(copy) + i, static_cast<std::size_t>(k) * sizeof(double));
+            return k;
+        }
+        for (R_xlen_t j = 0; j < k; ++j) buf[j] = seriesValue(x, i + j);
+        return k;
+    }
+
+    double seriesElt(SEXP x, R_xlen_t i)
+    {
+        SEXP copy = seriesCopy(x);
+        return Rf_isNull(copy) ? seriesValue(x, i) : REAL(copy)[i];
+    }
+
+    // Times and undivided, unpadded values can be read in place.
+    const void* seriesDataptrOrNull(SEXP x)
+    {
+        SEXP copy = seriesCopy(x);
+        if (!Rf_isNull(copy)) return REAL(copy);
+        const auto* spec = seriesSpec(x);
+        const auto* run  = runOf(R_altrep_data1(x));
+        const auto  kind = static_cast<SeriesKind>(static_cast<int>(spec[0]));
+        if (!run || kind == SeriesKind::Cdp) return nullptr;
+        const auto& s = massSeries(*run, static_cast<std::size_t>(spec[1]));
+        if (kind == SeriesKind::MassTime) return s.times.data();
+        const auto whole = s.values.size() == static_cast<std::size_t>(spec[2]);
+        return whole && spec[3] == 1.0 ? s.values.data() : nullptr;
+    }
+
+    void* seriesDataptr(SEXP x, Rboolean)
+    {
+        SEXP copy = seriesCopy(x);
+        if (Rf_isNull(copy))
+        {
+            const auto n = seriesLength(x);
+            copy = PROTECT(Rf_allocVector(REALSXP, n));
+            seriesGetRegion(x, 0, n, REAL(copy));
+            SET_VECTOR_ELT(R_altrep_data2(x), 1, copy);
+            UNPROTECT(1);
+        }
+        return REAL(copy);
+    }
+
+    SEXP seriesDuplicate(SEXP x, Rboolean)
+    {
+        SEXP copy = seriesCopy(x);
+        if (!Rf_isNull(copy)) return Rf_duplicate(copy);
+        const auto* spec = seriesSpec(x);
+        return newSeriesVector(R_altrep_data1(x),
+                               static_cast<SeriesKind>(static_cast<int>(spec[0])),
+                               static_cast<std::size_t>(spec[1]),
+                               static_cast<std::size_t>(spec[2]), spec[3]);
+    }
+}
+
+SEXP cdpStoreMatrix(const std::string& path)
+{
+    SEXP file = PROTECT(Rf_mkString(path.c_str()));
+    SEXP out  = newCdpVector(file);
+    if (!out)
+    {
+        UNPROTECT(1);
+        Rcpp::stop("Cannot map the CDP store " + path);
+    }
+    PROTECT(out);
+    const auto* m = mapping(out);
+    SEXP dim = PROTECT(Rf_allocVector(INTSXP, 2));
+    INTEGER(dim)[0] = static_cast<int>(m->depths());
+    INTEGER(dim)[1] = static_cast<int>(m->times());
+    Rf_setAttrib(out, R_DimSymbol, dim);
+    UNPROTECT(3);
+    return out;
+}
+
+SEXP runPointer(System& sys)
+{
+    auto* series = new RunSeries{sys.takeSeries(), sys.parameters().sink.name};
+    SEXP ptr = PROTECT(R_MakeExternalPtr(series, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(ptr, finalizeRun, TRUE);
+    UNPROTECT(1);
+    return ptr;
+}
+
+const RunSeries* runOf(SEXP run)
+{
+    if (TYPEOF(run) != EXTPTRSXP) return nullptr;
+    return static_cast<const RunSeries*>(R_ExternalPtrAddr(run));
+}
+
+Rcpp::List runMassColumns(SEXP run, Rcpp::Nullable<Rcpp::NumericVector> divisor)
+{
+    const auto* series = runOf(run);
+    if (!series) Rcpp::stop("The run behind this result is gone");
+
+    std::vector<std::pair<std::string, std::size_t>> logged;
+    const auto& names = series->logged.names;
+    const auto& comp  = series->logged.mass;
+    for (std::size_t k = 0; k < comp.size(); ++k)
+    {
+        if (comp[k].enabled) logged.emplace_back(names[k], k);
+    }
+    if (series->logged.sink_mass.enabled) logged.emplace_back(series->sink_name, comp.size());
+
+    Rcpp::List out;
+    if (logged.empty()) return out;
+    std::size_t grid = logged.front().second;
+    for (const auto& [name, k] : logged)
+    {
+        if (massSeries(*series, k).times.size() > massSeries(*series, grid).times.size())
+        {
+            grid = k;
+        }
+    }
+    const auto length = massSeries(*series, grid).times.size();
+
+    Rcpp::NumericVector div;
+    Rcpp::CharacterVector div_names;
+    if (divisor.isNotNull())
+    {
+        div = Rcpp::NumericVector(divisor.get());
+        if (div.size() > 0) div_names = div.names();
+    }
+    auto divisorOf = [&](const std::string& name) {
+        for (R_xlen_t i = 0; i < div_names.size(); ++i)
+        {
+            if (name == Rcpp::as<std::string>(div_names[i])) return div[i];
+        }
+        return 1.0;
+    };
+
+    out.push_back(Rcpp::RObject(newSeriesVector(run, SeriesKind::MassTime, grid, length, 1.0)),
+                  "time");
+    for (const auto& [name, k] : logged)
+    {
+        out.push_back(Rcpp::RObject(newSeriesVector(run, SeriesKind::MassValue, k, length,
+                                                    divisorOf(name))),
+                      name);
+    }
+    return out;
+}
+
+SEXP runCdpMatrix(SEXP run, std::size_t series)
+{
+    const auto* kept = runOf(run);
+    if (!kept) Rcpp::stop("The run behind this result is gone");
+    const auto& c = kept->logged.cdp[series];
+    SEXP out = PROTECT(newSeriesVector(run, SeriesKind::Cdp, series,
+                                       c.depths_um.size() * c.times.size(), 1.0));
+    SEXP dim = PROTECT(Rf_allocVector(INTSXP, 2));
+    INTEGER(dim)[0] = static_cast<int>(c.depths_um.size());
+    INTEGER(dim)[1] = static_cast<int>(c.times.size());
+    Rf_setAttrib(out, R_DimSymbol, dim);
+    UNPROTECT(2);
+    return out;
+}
+
+// [[Rcpp::init]]
+void registerAltrep(DllInfo* dll)
+{
+    cdp_class = R_make_altreal_class("cdp_store", "skindiff", dll);
+    R_set_altrep_Length_method(cdp_class, cdpLength);
+    R_set_altrep_Inspect_method(cdp_class, cdpInspect);
+    R_set_altrep_Duplicate_method(cdp_class, cdpDuplicate);
+    R_set_altvec_Dataptr_method(cdp_class, cdpDataptr);
+    R_set_altvec_Dataptr_or_null_method(cdp_class, cdpDataptrOrNull);
+    R_set_altreal_Elt_method(cdp_class, cdpElt);
+    R_set_altreal_Get_region_method(cdp_class, cdpGetRegion);
+
+    series_class = R_make_altreal_class("run_series", "skindiff", dll);
+    R_set_altrep_Length_method(series_class, seriesLength);
+    R_set_altrep_Inspect_method(series_class, seriesInspect);
+    R_set_altrep_Duplicate_method(series_class, seriesDuplicate);
+    R_set_altvec_Dataptr_method(series_class, seriesDataptr);
+    R_set_altvec_Dataptr_or_null_method(series_class, seriesDataptrOrNull);
+    R_set_altreal_Elt_method(series_class, seriesElt);
+    R_set_altreal_Get_region_method(series_class, seriesGetRegion);
+}
@@ -0,0 +1,41 @@
+#ifndef SC_RCPP_ALTREP_H
+#define SC_RCPP_ALTREP_H
+
+#include "system.h"
+
+#include <Rcpp.h>
+
+#include <cstddef>
+#include <string>
+
+// The profiles of a CdpStore file as an R matrix indexed [depth, time]
+// whose values are paged in from the file as they are read. Stops if the
+// file cannot be mapped.
+SEXP cdpStoreMatrix(const std::string& path);
+
+// What a skin_result reads from a finished run after it was built: the
+// logged series and the sink's name, without the System's matrices,
+// operators and state.
+struct RunSeries
+{
+    sc::System::LoggedSeries logged;
+    std::string              sink_name;
+};
+
+// The series of the finished `sys` (moved out, see System::takeSeries)
+// as an R external pointer owning them, behind the columns of a
+// skin_result that are filled from them when first read and behind the
+// native accessors. `sys` itself can be dropped afterwards.
+SEXP runPointer(sc::System& sys);
+// The series of `run`; nullptr if it is no run pointer or was cleared
+// (the result was read back from a file).
+const RunSeries* runOf(SEXP run);
+
+// The logged mass series of `run` as a named list starting with `time`,
+// the grid of the longest series (a removed donor's ends early and is
+// padded with NA). The columns named in `divisor` are divided by it.
+Rcpp::List runMassColumns(SEXP run, Rcpp::Nullable<Rcpp::NumericVector> divisor);
+// The profiles of CDP series `series` of `run` as a [depth, time] matrix.
+SEXP runCdpMatrix(SEXP run, std::size_t series);
+
+#endif  // SC_RCPP_ALTREP_H
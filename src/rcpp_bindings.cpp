@@ -1,9 +1,25 @@
+#include "api.h"
+#include "autoresolution.h"
+#include "batchstore.h"
+#include "checkpoint.h"
+#include "parallel.h"
 #include "parameter.h"
+#include "population.h"
+#include "rcpp_altrep.h"
+#include "sensitivity.h"
 #include "system.h"
 
 #include <Rcpp.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -35,6 +51,21 @@ namespace
         out.resolution      = pick<int>(sys,    "resolution",      1);
         out.max_module      = pick<double>(sys, "max_module",      50.0);
         out.simulation_time = pick<int>(sys,    "simulation_time", 600);
+        out.n_threads       = pick<int>(sys,    "n_threads",       0);
+        out.compact_scheme  = pick<bool>(sys,   "compact_scheme",  false);
+        out.parareal_slices      = pick<int>(sys,    "parareal_slices",      0);
+        out.parareal_coarse_step = pick<int>(sys,    "parareal_coarse_step", 60);
+        out.parareal_max_iter    = pick<int>(sys,    "parareal_max_iter",    0);
+        out.parareal_tol         = pick<double>(sys, "parareal_tol",         1e-8);
+        out.steady_state_tol     = pick<double>(sys, "steady_state_tol",     0.0);
+        out.reduced_order        = pick<int>(sys,    "reduced_order",        0);
+        out.active_window_tol    = pick<double>(sys, "active_window_tol",    0.0);
+        out.fused_sweeps         = pick<bool>(sys,   "fused_sweeps",         false);
+        out.packed_operator      = pick<bool>(sys,   "packed_operator",      false);
+        out.mixed_precision      = pick<bool>(sys,   "mixed_precision",      false);
+        out.periodic_tol         = pick<double>(sys, "periodic_tol",         0.0);
+        out.auto_resolution_tol  = pick<double>(sys, "auto_resolution_tol",  0.0);
+        out.log_buffer           = pick<int>(sys,    "log_buffer",           0);
         return out;
     }
 
@@ -44,6 +75,19 @@ namespace
         out.scaling           = parseScaling(pick<std::string>(log, "scaling", "mg"));
         out.mass_log_interval = pick<int>(log, "mass_log_interval", 1);
         out.cdp_log_interval  = pick<int>(log, "cdp_log_interval",  1);
+        out.enabled           = pick<bool>(log, "enabled", true);
+        out.cdp_dir           = pick<std::string>(log, "cdp_dir", "");
+        return out;
+    }
+
+    PkParams readPk(const Rcpp::List& k)
+    {
+        PkParams out;
+        out.enabled = true;
+        out.V1      = pick<double>(k, "V1",  1.0);
+        out.CL      = pick<double>(k, "CL",  0.0);
+        out.k12     = pick<double>(k, "k12", 0.0);
+        out.k21     = pick<double>(k, "k21", 0.0);
         return out;
     }
 
@@ -54,6 +98,10 @@ namespace
         out.c_init   = pick<double>(s,      "c_init",   0.0);
         out.Vd       = pick<double>(s,      "Vd",       1.0);
         out.log_mass = pick<bool>(s,        "log_mass", true);
+        if (s.containsElementNamed("pk") && !Rf_isNull(s["pk"]))
+        {
+            out.pk = readPk(s["pk"]);
+        }
         return out;
     }
 
@@ -68,11 +116,27 @@ namespace
         out.replace_after = pick<int>(v,         "replace_after", 0);
         out.remove_at     = pick<int>(v,         "remove_at",     0);
         out.finite_dose   = pick<bool>(v,        "finite_dose",   true);
+        out.lumped        = pick<bool>(v,        "lumped",        false);
         out.log_mass      = pick<bool>(v,        "log_mass",      true);
         out.log_cdp       = pick<bool>(v,        "log_cdp",       false);
         return out;
     }
 
+    BrickParams readBrick(const Rcpp::List& b)
+    {
+        BrickParams out;
+        out.enabled       = true;
+        out.width         = pick<double>(b, "width",         40.0);
+        out.thickness     = pick<double>(b, "thickness",     0.8);
+        out.mortar        = pick<double>(b, "mortar",        0.1);
+        out.D_brick       = pick<double>(b, "D_brick",       1.0);
+        out.K_brick       = pick<double>(b, "K_brick",       1.0);
+        out.brick_cells   = pick<int>(b,    "brick_cells",   4);
+        out.lateral_cells = pick<int>(b,    "lateral_cells", 8);
+        out.mortar_cells  = pick<int>(b,    "mortar_cells",  2);
+        return out;
+    }
+
     std::vector<LayerParams> readLayers(const Rcpp::List& layers)
     {
         std::vector<LayerParams> out;
@@ -89,11 +153,63 @@ namespace
             p.height        = pick<int>(l,         "height",        10);
             p.log_mass      = pick<bool>(l,        "log_mass",      true);
             p.log_cdp       = pick<bool>(l,        "log_cdp",       false);
+            if (l.containsElementNamed("brick") && !Rf_isNull(l["brick"]))
+            {
+                p.brick = readBrick(l["brick"]);
+            }
+            out.push_back(std::move(p));
+        }
+        return out;
+    }
+
+    std::vector<PathwayParams> readPathways(const Rcpp::List& pathways)
+    {
+        std::vector<PathwayParams> out;
+        out.reserve(static_cast<std::size_t>(pathways.size()));
+        for (R_xlen_t i = 0; i < pathways.size(); ++i)
+        {
+            const Rcpp::List pw(pathways[i]);
+            PathwayParams p;
+            p.name = pick<std::string>(pw, "name", "Pathway");
+            if (pw.containsElementNamed("layers")) p.layers = readLayers(pw["layers"]);
             out.push_back(std::move(p));
         }
         return out;
     }
 
+    // `stop` arrives as list(kind = <chr>, value = <dbl>), parallel vectors
+    // with one entry per condition.
+    std::vector<StopCondition> readStop(const Rcpp::List& s)
+    {
+        std::vector<StopCondition> out;
+        if (!s.containsElementNamed("kind")) return out;
+        const Rcpp::CharacterVector kind  = s["kind"];
+        const Rcpp::NumericVector   value = s["value"];
+        if (kind.size() != value.size()) Rcpp::stop("stop: kind / value length mismatch");
+        for (R_xlen_t i = 0; i < kind.size(); ++i)
+        {
+            const auto name = Rcpp::as<std::string>(kind[i]);
+            const auto k    = stopKindFromString(name);
+            if (!k)
+            {
+                Rcpp::stop("Unknown stop condition '" + name +
+                           "' (expected 'permeated', 'donor_below', or 'receptor_above')");
+            }
+            out.push_back(StopCondition{*k, value[i]});
+        }
+        return out;
+    }
+
+    MetricsParams readMetrics(const Rcpp::List& m)
+    {
+        MetricsParams out;
+        out.enabled   = true;
+        out.ss_from   = pick<double>(m, "ss_from", 0.7);
+        out.ss_to     = pick<double>(m, "ss_to",   1.0);
+        out.permeated = pick<std::vector<double>>(m, "permeated", {});
+        return out;
+    }
+
     Parameters parametersFromR(const Rcpp::List& p)
     {
         Parameters out;
@@ -102,6 +218,12 @@ namespace
         if (p.containsElementNamed("sink"))    out.sink    = readSink(p["sink"]);
         if (p.containsElementNamed("vehicle")) out.vehicle = readVehicle(p["vehicle"]);
         if (p.containsElementNamed("layers"))  out.layers  = readLayers(p["layers"]);
+        if (p.containsElementNamed("pathways")) out.pathways = readPathways(p["pathways"]);
+        if (p.containsElementNamed("stop"))    out.stop    = readStop(p["stop"]);
+        if (p.containsElementNamed("metrics") && !Rf_isNull(p["metrics"]))
+        {
+            out.metrics = readMetrics(p["metrics"]);
+        }
         return out;
     }
 
@@ -184,8 +306,10 @@ namespace
         return out;
     }
 
+    // With a `run` pointer the in-memory profiles are matrices filled
+    // from the run when first read.
     Rcpp::List cdpToList(const std::vector<CdpSeries>& series,
-                         const std::vector<std::string>& names)
+                         const std::vector<std::string>& names, SEXP run = R_NilValue)
     {
         Rcpp::List out;
         for (std::size_t i = 0; i < series.size(); ++i)
@@ -193,6 +317,27 @@ namespace
             const auto& s = series[i];
             if (!s.enabled) continue;
 
+            if (s.store)
+            {
+                Rcpp::List entry = Rcpp::List::create(
+                    Rcpp::Named("time")     = s.times,
+                    Rcpp::Named("depth_um") = s.depths_um,
+                    Rcpp::Named("conc")     = Rcpp::RObject(cdpStoreMatrix(s.store->path())),
+                    Rcpp::Named("file")     = s.store->path());
+                out.push_back(entry, names[i]);
+                continue;
+            }
+
+            if (!Rf_isNull(run))
+            {
+                Rcpp::List entry = Rcpp::List::create(
+                    Rcpp::Named("time")     = s.times,
+                    Rcpp::Named("depth_um") = s.depths_um,
+                    Rcpp::Named("conc")     = Rcpp::RObject(runCdpMatrix(run, i)));
+                out.push_back(entry, names[i]);
+                continue;
+            }
+
             const auto n_t = s.times.size();
             const auto n_d = s.depths_um.size();
 
@@ -221,6 +366,298 @@ namespace
             Rcpp::Named("max_step_um") = g.maxSpaceStep(),
             Rcpp::Named("n_cells")     = g.size());
     }
+
+    // Final 2-D field of a brick-and-mortar layer, in scaling units / ml,
+    // indexed [depth, lateral].
+    Rcpp::List brickToList(const System& sys, double scale)
+    {
+        const auto& brick = *sys.brickLayer();
+        const auto  c     = brick.concentrations();
+        Rcpp::NumericMatrix conc(brick.rows(), brick.cols());
+        for (int i = 0; i < brick.rows(); ++i)
+        {
+            for (int j = 0; j < brick.cols(); ++j)
+            {
+                conc(i, j) = c[static_cast<std::size_t>(i * brick.cols() + j)] * scale * 1.0e12;
+            }
+        }
+        return Rcpp::List::create(
+            Rcpp::Named("layer")      = sys.compartmentNames()[
+                                            static_cast<std::size_t>(sys.brickLayerIndex())],
+            Rcpp::Named("depth_um")   = brick.depth(),
+            Rcpp::Named("lateral_um") = brick.lateral(),
+            Rcpp::Named("conc")       = conc);
+    }
+
+    // ---------- Results kept in the engine ----------
+
+    // Logged mass series `name` of `run` (a compartment or the sink),
+    // nullptr if there is none.
+    const MassSeries* findMass(const RunSeries& run, const std::string& name)
+    {
+        const auto& names = run.logged.names;
+        for (std::size_t k = 0; k < names.size(); ++k)
+        {
+            const auto& s = run.logged.mass[k];
+            if (names[k] == name && s.enabled) return &s;
+        }
+        if (name == run.sink_name && run.logged.sink_mass.enabled)
+        {
+            return &run.logged.sink_mass;
+        }
+        return nullptr;
+    }
+
+    const CdpSeries* findCdp(const RunSeries& run, const std::string& name)
+    {
+        const auto& names = run.logged.names;
+        for (std::size_t k = 0; k < names.size(); ++k)
+        {
+            const auto& s = run.logged.cdp[k];
+            if (names[k] == name && s.enabled) return &s;
+        }
+        return nullptr;
+    }
+
+    // ---------- Batch files ----------
+
+    // What a batch file holds per scenario besides its id, status and
+    // parameters: the mass series the first scenario logs, on the time
+    // grid of the longest, and its metrics if it tracks them.
+    struct BatchLayout
+    {
+        std::vector<std::string> mass;   // compartment and sink names
+        bool                     plasma    = false;
+        bool                     metrics   = false;
+        std::size_t              permeated = 0;
+        std::vector<BatchColumn> columns;
+    };
+
+    constexpr const char* kBatchMetrics[] = {
+        "q_total", "j_ss", "t_lag", "r2_ss", "j_max", "t_j_max",
+        "auc", "c_max", "t_max", "t_donor_half", "depletion"};
+
+    BatchLayout batchLayout(const Parameters& p, const std::vector<std::string>& param_names)
+    {
+        BatchLayout out;
+        if (p.log.enabled)
+        {
+            if (p.vehicle.log_mass) out.mass.push_back(p.vehicle.name);
+            for (const auto& l : p.layers)
+            {
+                if (l.log_mass) out.mass.push_back(l.name);
+            }
+            for (const auto& pw : p.pathways)
+            {
+                for (const auto& l : pw.layers)
+                {
+                    if (l.log_mass) out.mass.push_back(l.name);
+                }
+            }
+            if (p.sink.log_mass) out.mass.push_back(p.sink.name);
+        }
+        out.plasma    = p.sink.pk.enabled;
+        out.metrics   = p.metrics.enabled;
+        out.permeated = p.metrics.permeated.size();
+
+        using Kind  = BatchColumn::Kind;
+        out.columns = {{"scenario", Kind::Int}, {"status", Kind::Int}};
+        for (const auto& n : param_names) out.columns.push_back({"param." + n, Kind::Double});
+        if (!out.mass.empty() || out.plasma) out.columns.push_back({"time", Kind::Series});
+        for (const auto& n : out.mass) out.columns.push_back({"mass." + n, Kind::Series});
+        if (out.plasma) out.columns.push_back({"plasma", Kind::Series});
+        if (out.metrics)
+        {
+            for (const auto* n : kBatchMetrics)
+            {
+                out.columns.push_back({std::string("metric.") + n, Kind::Double});
+            }
+            for (std::size_t k = 0; k < out.permeated; ++k)
+            {
+                out.columns.push_back({"metric.t_permeated_" + std::to_string(k + 1),
+                                       Kind::Double});
+            }
+        }
+        return out;
+    }
+
+    // Status codes of the batch file, in the order of R's status strings.
+    std::int64_t batchStatus(System::Result r)
+    {
+        if (r == System::Result::Stopped) return 1;
+        if (r == System::Result::Failed)  return 2;
+        return 0;
+    }
+
+    BatchRow batchRow(const System& sys, System::Result status, int id,
+                      std::vector<double> param_values, const BatchLayout& layout)
+    {
+        constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+        BatchRow row;
+        row.ints    = {id, batchStatus(status)};
+        row.doubles = std::move(param_values);
+
+        // Series this run does not log stay empty; one that ends early
+        // (a removed donor) is padded with NaN.
+        std::vector<const MassSeries*> series;
+        const auto& names = sys.compartmentNames();
+        for (const auto& n : layout.mass)
+        {
+            const MassSeries* s = nullptr;
+            if (n == sys.parameters().sink.name)
+            {
+                s = &sys.sinkMass();
+            }
+            else
+            {
+                const auto it = std::find(names.begin(), names.end(), n);
+                if (it != names.end())
+                {
+                    s = &sys.compartmentMass()[static_cast<std::size_t>(it - names.begin())];
+                }
+            }
+            series.push_back(s && s->enabled ? s : nullptr);
+        }
+        if (layout.plasma) series.push_back(sys.plasma().enabled ? &sys.plasma() : nullptr);
+        if (!series.empty())
+        {
+            const MassSeries* grid = nullptr;
+            for (const auto* s : series)
+            {
+                if (s && (!grid || s->times.size() > grid->times.size())) grid = s;
+            }
+            row.series.push_back(grid ? grid->times : std::vector<double>{});
+            for (const auto* s : series)
+            {
+                auto values = s ? s->values : std::vector<double>{};
+                values.resize(row.series.front().size(), nan);
+                row.series.push_back(std::move(values));
+            }
+        }
+
+        if (layout.metrics)
+        {
+            const auto m = sys.metrics();
+            row.doubles.insert(row.doubles.end(),
+                               {m.q_total, m.j_ss, m.t_lag, m.r2_ss, m.j_max, m.t_j_max, m.auc,
+                                m.c_max, m.t_max, m.t_donor_half, m.depletion});
+            for (std::size_t k = 0; k < layout.permeated; ++k)
+            {
+                row.doubles.push_back(k < m.t_permeated.size() ? m.t_permeated[k] : nan);
+            }
+        }
+        return row;
+    }
+
+    // ---------- Checkpoints <-> raw vectors ----------
+
+    Rcpp::RawVector checkpointToRaw(const Checkpoint& cp)
+    {
+        std::ostringstream out(std::ios::binary);
+        writeCheckpoint(out, cp);
+        const auto bytes = out.str();
+        return Rcpp::RawVector(bytes.begin(), bytes.end());
+    }
+
+    Checkpoint checkpointFromRaw(const Rcpp::RawVector& raw)
+    {
+        std::istringstream in(std::string(raw.begin(), raw.end()), std::ios::binary);
+        auto cp = readCheckpoint(in);
+        if (!cp) Rcpp::stop("Not a skindiff checkpoint (or one from another version)");
+        return std::move(*cp);
+    }
+
+    // `choice` is the automatic mesh the run used, if any.
+    // With a `run` pointer holding the series of `sys` (runPointer) the
+    // result carries it as `run` instead of `mass`, whose columns R takes
+    // from it (runMassColumns), and its profiles are filled from it when
+    // read.
+    Rcpp::List resultToList(const System& sys, System::Result status,
+                            const ResolutionChoice* choice = nullptr, SEXP run = R_NilValue)
+    {
+        std::string status_str = "executed";
+        if (status == System::Result::Stopped) status_str = "stopped";
+        if (status == System::Result::Failed)  status_str = "failed";
+
+        const auto& parms = sys.parameters();
+        const auto* kept  = runOf(run);
+        Rcpp::List out = Rcpp::List::create(
+            Rcpp::Named("status")   = status_str,
+            Rcpp::Named("scaling")  = std::string(toString(parms.log.scaling)),
+            Rcpp::Named("cdp")      = kept ? cdpToList(kept->logged.cdp, kept->logged.names, run)
+                                           : cdpToList(sys.cdp(), sys.compartmentNames()),
+            Rcpp::Named("geometry") = geometryToList(sys.geometry()));
+        if (!kept)
+        {
+            out["mass"] = massSeriesToList(sys.compartmentMass(), sys.compartmentNames(),
+                                           sys.sinkMass(), parms.sink.name);
+        }
+        else
+        {
+            out["run"] = Rcpp::RObject(run);
+        }
+        if (parms.sink.pk.enabled)
+        {
+            out["plasma"] = Rcpp::List::create(Rcpp::Named("time")  = sys.plasma().times,
+                                               Rcpp::Named("value") = sys.plasma().values);
+        }
+        if (parms.sys.steady_state_tol > 0.0)
+        {
+            out["steady_state_at"] = sys.steadyStateTime();
+        }
+        if (parms.sys.periodic_tol > 0.0)
+        {
+            out["periodic"] = Rcpp::List::create(
+                Rcpp::Named("periods")  = sys.periodicPeriods(),
+                Rcpp::Named("residual") = sys.periodicResidual(),
+                Rcpp::Named("flux")     = sys.periodicFlux());
+        }
+        if (parms.sys.reduced_order > 0)
+        {
+            out["reduced"] = Rcpp::List::create(
+                Rcpp::Named("order")          = sys.reducedOrder(),
+                Rcpp::Named("error_estimate") = sys.reducedErrorEstimate());
+        }
+        if (choice)
+        {
+            out["auto_resolution"] = Rcpp::List::create(
+                Rcpp::Named("resolution") = choice->resolution,
+                Rcpp::Named("max_module") = choice->max_module,
+                Rcpp::Named("sink_error") = choice->sink_error,
+                Rcpp::Named("cdp_error")  = choice->cdp_error);
+        }
+        if (sys.brickLayer())
+        {
+            out["brick"] = brickToList(sys, scaleFactor(parms.log.scaling));
+        }
+        if (parms.metrics.enabled)
+        {
+            const auto m = sys.metrics();
+            out["metrics"] = Rcpp::List::create(
+                Rcpp::Named("samples")      = m.samples,
+                Rcpp::Named("q_total")      = m.q_total,
+                Rcpp::Named("j_ss")         = m.j_ss,
+                Rcpp::Named("t_lag")        = m.t_lag,
+                Rcpp::Named("r2_ss")        = m.r2_ss,
+                Rcpp::Named("j_max")        = m.j_max,
+                Rcpp::Named("t_j_max")      = m.t_j_max,
+                Rcpp::Named("auc")          = m.auc,
+                Rcpp::Named("c_max")        = m.c_max,
+                Rcpp::Named("t_max")        = m.t_max,
+                Rcpp::Named("t_donor_half") = m.t_donor_half,
+                Rcpp::Named("depletion")    = m.depletion,
+                Rcpp::Named("t_permeated")  = m.t_permeated);
+        }
+        if (!parms.stop.empty())
+        {
+            const auto idx  = sys.stopIndex();
+            const auto kind = idx < 0 ? std::string()
+                : std::string(toString(parms.stop[static_cast<std::size_t>(idx)].kind));
+            out["stop"] = Rcpp::List::create(Rcpp::Named("time") = sys.stopTime(),
+                                             Rcpp::Named("kind") = kind);
+        }
+        return out;
+    }
 }  // namespace
 
 // [[Rcpp::export(name = ".cpp_validate", rng = false)]]
@@ -246,29 +683,573 @@ Rcpp::List cpp_validate(Rcpp::List params)
                               Rcpp::Named("error") = R_NilValue);
 }
 
+// With `resume` (a raw checkpoint) the run continues from it; with
+// `checkpoint` the result carries the end state as `checkpoint` (NULL if
+// the run did not reach its end).
 // [[Rcpp::export(name = ".cpp_simulate", rng = false)]]
-Rcpp::List cpp_simulate(Rcpp::List params, bool show_progress = false)
+Rcpp::List cpp_simulate(Rcpp::List params, bool show_progress = false,
+                        bool checkpoint = false,
+                        Rcpp::Nullable<Rcpp::RawVector> resume = R_NilValue)
+{
+    Parameters p = parametersFromR(params);
+    if (auto err = validate(p))
+    {
+        Rcpp::stop(*err);
+    }
+    if (resume.isNotNull() && p.sys.auto_resolution_tol > 0.0)
+    {
+        Rcpp::stop("sys.auto_resolution_tol cannot be combined with a resumed run");
+    }
+
+    std::unique_ptr<ResolutionChoice> choice;
+    if (p.sys.auto_resolution_tol > 0.0)
+    {
+        choice = std::make_unique<ResolutionChoice>(chooseResolution(p, [](Parameters q) {
+            return std::make_unique<SystemR>(std::move(q), false);
+        }));
+        p.sys.resolution = choice->resolution;
+        p.sys.max_module = choice->max_module;
+    }
+
+    auto sys = std::make_unique<SystemR>(std::move(p), show_progress);
+    System::Result status;
+    if (resume.isNotNull())
+    {
+        const auto cp = checkpointFromRaw(Rcpp::RawVector(resume.get()));
+        if (auto err = sys->resumeError(cp)) Rcpp::stop(*err);
+        status = sys->resume(cp);
+    }
+    else
+    {
+        status = sys->run();
+    }
+
+    // The checkpoint needs the series, which then move to the result; the
+    // System goes with this frame.
+    Rcpp::RObject end(R_NilValue);
+    if (checkpoint)
+    {
+        const auto cp = sys->checkpoint();
+        if (cp) end = checkpointToRaw(*cp);
+    }
+    const Rcpp::RObject run(runPointer(*sys));
+    auto out = resultToList(*sys, status, choice.get(), run);
+    if (checkpoint) out["checkpoint"] = end;
+    return out;
+}
+
+// Runs independent simulations side by side, one per worker thread. All
+// R <-> C++ conversion happens on the calling thread; the workers only
+// step plain Systems (automatic meshes are chosen on the worker too).
+// Each run is forced serial internally so the batch is the only parallel
+// level.
+// [[Rcpp::export(name = ".cpp_simulate_batch", rng = false)]]
+Rcpp::List cpp_simulate_batch(Rcpp::List params_list, int n_threads = 0)
+{
+    const auto n = static_cast<int>(params_list.size());
+    std::vector<Parameters> params;
+    params.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i)
+    {
+        Parameters p = parametersFromR(Rcpp::as<Rcpp::List>(params_list[i]));
+        if (auto err = validate(p))
+        {
+            Rcpp::stop("params_list[[" + std::to_string(i + 1) + "]]: " + *err);
+        }
+        p.sys.n_threads = 1;
+        params.push_back(std::move(p));
+    }
+
+    const auto size = static_cast<std::size_t>(n);
+    std::vector<std::unique_ptr<System>>           systems(size);
+    std::vector<std::unique_ptr<ResolutionChoice>> choices(size);
+    std::vector<System::Result> status(size, System::Result::Failed);
+    parallelFor(n, n_threads, [&](int i)
+    {
+        const auto k = static_cast<std::size_t>(i);
+        auto& p = params[k];
+        if (p.sys.auto_resolution_tol > 0.0)
+        {
+            choices[k] = std::make_unique<ResolutionChoice>(chooseResolution(p));
+            p.sys.resolution = choices[k]->resolution;
+            p.sys.max_module = choices[k]->max_module;
+        }
+        systems[k] = std::make_unique<System>(std::move(p));
+        status[k]  = systems[k]->run();
+    });
+
+    Rcpp::List out(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const auto k = static_cast<std::size_t>(i);
+        out[i] = resultToList(*systems[k], status[k], choices[k].get());
+    }
+    return out;
+}
+
+// Continues every entry of `params_list` from one raw checkpoint, side by
+// side as in cpp_simulate_batch; `checkpoint` as for cpp_simulate.
+// [[Rcpp::export(name = ".cpp_fork", rng = false)]]
+Rcpp::List cpp_fork(Rcpp::RawVector from, Rcpp::List params_list, int n_threads = 0,
+                    bool checkpoint = false)
+{
+    const auto cp = checkpointFromRaw(from);
+    const auto n  = static_cast<int>(params_list.size());
+    std::vector<std::unique_ptr<System>> systems;
+    systems.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i)
+    {
+        const auto tag = "params_list[[" + std::to_string(i + 1) + "]]: ";
+        Parameters p = parametersFromR(Rcpp::as<Rcpp::List>(params_list[i]));
+        if (auto err = validate(p)) Rcpp::stop(tag + *err);
+        if (p.sys.auto_resolution_tol > 0.0)
+        {
+            Rcpp::stop(tag + "sys.auto_resolution_tol cannot be combined with a resumed run");
+        }
+        p.sys.n_threads = 1;
+        systems.push_back(std::make_unique<System>(std::move(p)));
+        if (auto err = systems.back()->resumeError(cp)) Rcpp::stop(tag + *err);
+    }
+
+    std::vector<System::Result> status(static_cast<std::size_t>(n), System::Result::Failed);
+    parallelFor(n, n_threads, [&](int i)
+    {
+        const auto k = static_cast<std::size_t>(i);
+        status[k] = systems[k]->resume(cp);
+    });
+
+    // Each System is dropped once its result holds its series, so only
+    // the results stay resident.
+    Rcpp::List out(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const auto k = static_cast<std::size_t>(i);
+        Rcpp::RObject end(R_NilValue);
+        if (checkpoint)
+        {
+            const auto cp_end = systems[k]->checkpoint();
+            if (cp_end) end = checkpointToRaw(*cp_end);
+        }
+        const Rcpp::RObject run(runPointer(*systems[k]));
+        auto res = resultToList(*systems[k], status[k], nullptr, run);
+        if (checkpoint) res["checkpoint"] = end;
+        out[i] = res;
+        systems[k].reset();
+    }
+    return out;
+}
+
+// The mass columns of a run kept by skin_simulate()/skin_fork(), filled
+// when first read (runMassColumns).
+// [[Rcpp::export(name = ".cpp_result_mass", rng = false)]]
+Rcpp::List cpp_result_mass(SEXP run, Rcpp::Nullable<Rcpp::NumericVector> divisor = R_NilValue)
+{
+    return runMassColumns(run, divisor);
+}
+
+// Mass series `name` of the run interpolated at the times `t` (minutes)
+// as approx(rule = 2) would; NULL if the run is gone or did not log it.
+// [[Rcpp::export(name = ".cpp_result_at", rng = false)]]
+SEXP cpp_result_at(SEXP run, std::string name, Rcpp::NumericVector t)
+{
+    const auto* kept = runOf(run);
+    const auto* s    = kept ? findMass(*kept, name) : nullptr;
+    if (!s) return R_NilValue;
+    Rcpp::NumericVector out(t.size());
+    for (R_xlen_t i = 0; i < t.size(); ++i) out[i] = s->at(t[i]);
+    return out;
+}
+
+// Rate of change of mass series `name` over each sample interval, at the
+// midpoints: list(time, rate); NULL as for cpp_result_at.
+// [[Rcpp::export(name = ".cpp_result_rate", rng = false)]]
+SEXP cpp_result_rate(SEXP run, std::string name)
+{
+    const auto* kept = runOf(run);
+    const auto* s    = kept ? findMass(*kept, name) : nullptr;
+    if (!s) return R_NilValue;
+    const auto n = s->times.empty() ? std::size_t{0} : s->times.size() - 1;
+    std::vector<double> time(n), rate(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        const auto dt = s->times[k + 1] - s->times[k];
+        time[k] = (s->times[k] + s->times[k + 1]) / 2.0;
+        rate[k] = (s->values[k + 1] - s->values[k]) / dt;
+    }
+    return Rcpp::List::create(Rcpp::Named("time") = time, Rcpp::Named("rate") = rate);
+}
+
+// Profile of CDP series `name` at time `t` (minutes), interpolated per
+// depth; NULL as for cpp_result_at.
+// [[Rcpp::export(name = ".cpp_result_profile_at", rng = false)]]
+SEXP cpp_result_profile_at(SEXP run, std::string name, double t)
+{
+    const auto* kept = runOf(run);
+    const auto* s    = kept ? findCdp(*kept, name) : nullptr;
+    if (!s) return R_NilValue;
+    return Rcpp::wrap(s->profileAt(t));
+}
+
+// Runs the scenarios handed out by `next_chunk` -- an R function of the
+// chunk number (1 to n_chunks) returning list(params, ids, values) -- into
+// the batch file at `path`, side by side as in cpp_simulate_batch. Each
+// row is written as its run finishes and only the current chunk is held
+// in memory. The columns follow the first scenario (batchLayout), with the
+// parameter columns named by the column names of the first `values`;
+// every scenario has a row of `values`. Profiles are not kept. Returns the
+// number of scenarios written.
+// [[Rcpp::export(name = ".cpp_batch", rng = false)]]
+double cpp_batch(std::string path, Rcpp::Function next_chunk, int n_chunks, int chunk_rows,
+                 int n_threads = 0)
+{
+    std::unique_ptr<BatchWriter> writer;
+    BatchLayout layout;
+    std::mutex  write_mutex;
+    for (int k = 1; k <= n_chunks; ++k)
+    {
+        const Rcpp::List chunk = next_chunk(k);
+        const Rcpp::List          params_list = chunk["params"];
+        const Rcpp::IntegerVector ids         = chunk["ids"];
+        const Rcpp::NumericMatrix values      = chunk["values"];
+        const auto n = static_cast<int>(params_list.size());
+        if (ids.size() != n || values.nrow() != n)
+        {
+            Rcpp::stop("batch chunk " + std::to_string(k) + ": ids and values do not match params");
+        }
+
+        std::vector<Parameters> params;
+        params.reserve(static_cast<std::size_t>(n));
+        for (int i = 0; i < n; ++i)
+        {
+            Parameters p = parametersFromR(Rcpp::as<Rcpp::List>(params_list[i]));
+            if (auto err = validate(p))
+            {
+                Rcpp::stop("scenario " + std::to_string(ids[i]) + ": " + *err);
+            }
+            p.sys.n_threads = 1;
+            p.log.cdp_dir.clear();
+            p.vehicle.log_cdp = false;
+            for (auto& l : p.layers) l.log_cdp = false;
+            for (auto& pw : p.pathways)
+            {
+                for (auto& l : pw.layers) l.log_cdp = false;
+            }
+            params.push_back(std::move(p));
+        }
+        if (n == 0) continue;
+
+        if (!writer)
+        {
+            std::vector<std::string> names;
+            SEXP dimnames = Rf_getAttrib(values, R_DimNamesSymbol);
+            if (!Rf_isNull(dimnames) && !Rf_isNull(VECTOR_ELT(dimnames, 1)))
+            {
+                names = Rcpp::as<std::vector<std::string>>(VECTOR_ELT(dimnames, 1));
+            }
+            layout = batchLayout(params.front(), names);
+            writer = std::make_unique<BatchWriter>(path, layout.columns,
+                                                   static_cast<std::size_t>(chunk_rows));
+        }
+        const auto n_param = static_cast<std::size_t>(values.ncol());
+        if (n_param != static_cast<std::size_t>(std::count_if(
+                           layout.columns.begin(), layout.columns.end(),
+                           [](const BatchColumn& c) { return c.name.rfind("param.", 0) == 0; })))
+        {
+            Rcpp::stop("batch chunk " + std::to_string(k) + ": parameter columns changed");
+        }
+
+        // Copied out of R, which the workers must not touch.
+        const std::vector<int> id(ids.begin(), ids.end());
+        std::vector<std::vector<double>> param_values(static_cast<std::size_t>(n));
+        for (int i = 0; i < n; ++i)
+        {
+            for (std::size_t j = 0; j < n_param; ++j)
+            {
+                param_values[static_cast<std::size_t>(i)].push_back(
+                    values(i, static_cast<int>(j)));
+            }
+        }
+
+        parallelFor(n, n_threads, [&](int i)
+        {
+            const auto k_i = static_cast<std::size_t>(i);
+            auto& p = params[k_i];
+            if (p.sys.auto_resolution_tol > 0.0)
+            {
+                const auto choice = chooseResolution(p);
+                p.sys.resolution = choice.resolution;
+                p.sys.max_module = choice.max_module;
+            }
+            System sys(std::move(p));
+            const auto status = sys.run();
+            auto row = batchRow(sys, status, id[k_i], std::move(param_values[k_i]), layout);
+            std::lock_guard<std::mutex> lock(write_mutex);
+            writer->add(row);
+        });
+        Rcpp::checkUserInterrupt();
+    }
+    if (!writer) Rcpp::stop("a batch needs at least one scenario");
+    writer->close();
+    return static_cast<double>(writer->rows());
+}
+
+// Sobol' indices of the outputs `output_kinds` (SensitivityOutput::Kind
+// codes; `output_times` for Permeated) over runs of `params` with the
+// parameters at `paths` drawn from [lower, upper], `n_base` base samples
+// run `chunk` at a time. Returns n_factors x n_outputs matrices `first`
+// and `total` and, per output, the base samples used and the mean and
+// variance of the output.
+// [[Rcpp::export(name = ".cpp_sensitivity", rng = false)]]
+Rcpp::List cpp_sensitivity(Rcpp::List params, std::vector<std::string> paths,
+                           std::vector<double> lower, std::vector<double> upper,
+                           std::vector<bool> log, std::vector<int> output_kinds,
+                           std::vector<double> output_times, int n_base, int n_threads = 0,
+                           int chunk = 64)
 {
     Parameters p = parametersFromR(params);
     if (auto err = validate(p))
     {
         Rcpp::stop(*err);
     }
+    if (lower.size() != paths.size() || upper.size() != paths.size() ||
+        log.size() != paths.size() || output_times.size() != output_kinds.size())
+    {
+        Rcpp::stop("sensitivity: factor and output fields differ in length");
+    }
+    if (n_base < 2 || chunk < 1)
+    {
+        Rcpp::stop("sensitivity: n_base must be >= 2 and chunk >= 1");
+    }
+
+    std::vector<SensitivityFactor> factors;
+    for (std::size_t j = 0; j < paths.size(); ++j)
+    {
+        factors.push_back(SensitivityFactor{paths[j], lower[j], upper[j], log[j]});
+    }
+    std::vector<SensitivityOutput> outputs;
+    for (std::size_t o = 0; o < output_kinds.size(); ++o)
+    {
+        if (output_kinds[o] < 0 ||
+            output_kinds[o] > static_cast<int>(SensitivityOutput::Kind::TMax))
+        {
+            Rcpp::stop("sensitivity: unknown output kind " + std::to_string(output_kinds[o]));
+        }
+        outputs.push_back(SensitivityOutput{
+            static_cast<SensitivityOutput::Kind>(output_kinds[o]), output_times[o]});
+    }
+    if (auto err = sensitivityError(p, factors, outputs))
+    {
+        Rcpp::stop(*err);
+    }
+
+    const auto acc = parameterSensitivity(p, factors, outputs, static_cast<std::size_t>(n_base),
+                                          n_threads, static_cast<std::size_t>(chunk),
+                                          [] { Rcpp::checkUserInterrupt(); });
+
+    const auto n_f = static_cast<int>(factors.size());
+    const auto n_o = static_cast<int>(outputs.size());
+    Rcpp::NumericMatrix first(n_f, n_o), total(n_f, n_o);
+    Rcpp::IntegerVector samples(n_o);
+    Rcpp::NumericVector mean(n_o), variance(n_o);
+    for (int o = 0; o < n_o; ++o)
+    {
+        const auto k = static_cast<std::size_t>(o);
+        for (int j = 0; j < n_f; ++j)
+        {
+            first(j, o) = acc.first(static_cast<std::size_t>(j), k);
+            total(j, o) = acc.total(static_cast<std::size_t>(j), k);
+        }
+        samples[o]  = static_cast<int>(acc.samples(k));
+        mean[o]     = acc.mean(k);
+        variance[o] = acc.variance(k);
+    }
+    return Rcpp::List::create(Rcpp::Named("first") = first, Rcpp::Named("total") = total,
+                              Rcpp::Named("samples") = samples, Rcpp::Named("mean") = mean,
+                              Rcpp::Named("variance") = variance);
+}
+
+// Quantiles `probs` at `times` (min) of the series `series_kinds`
+// (PopulationSeries::Kind codes; `series_names` for Compartment) over `n`
+// subjects of `params` with the parameters at `paths` drawn from
+// `dists` (PopulationFactor::Dist codes) with parameters `a` and `b`,
+// correlated by `correlation` (row-major, or empty). Returns one
+// n_times x n_probs matrix per series in `quantiles`, and the number of
+// subjects run and left out as `subjects` and `failed`.
+// [[Rcpp::export(name = ".cpp_population", rng = false)]]
+Rcpp::List cpp_population(Rcpp::List params, std::vector<std::string> paths,
+                          std::vector<int> dists, std::vector<double> a, std::vector<double> b,
+                          std::vector<double> correlation, std::vector<int> series_kinds,
+                          std::vector<std::string> series_names, std::vector<double> times,
+                          std::vector<double> probs, int n, double seed, int n_threads = 0,
+                          int chunk = 256)
+{
+    Parameters p = parametersFromR(params);
+    if (dists.size() != paths.size() || a.size() != paths.size() || b.size() != paths.size() ||
+        series_names.size() != series_kinds.size())
+    {
+        Rcpp::stop("population: factor and series fields differ in length");
+    }
+    if (n < 1 || chunk < 1)
+    {
+        Rcpp::stop("population: n and chunk must be >= 1");
+    }
+
+    std::vector<PopulationFactor> factors;
+    for (std::size_t j = 0; j < paths.size(); ++j)
+    {
+        if (dists[j] < 0 || dists[j] > static_cast<int>(PopulationFactor::Dist::LogUniform))
+        {
+            Rcpp::stop("population: unknown distribution " + std::to_string(dists[j]));
+        }
+        factors.push_back(PopulationFactor{
+            paths[j], static_cast<PopulationFactor::Dist>(dists[j]), a[j], b[j]});
+    }
+    std::vector<PopulationSeries> series;
+    for (std::size_t s = 0; s < series_kinds.size(); ++s)
+    {
+        if (series_kinds[s] < 0 ||
+            series_kinds[s] > static_cast<int>(PopulationSeries::Kind::Plasma))
+        {
+            Rcpp::stop("population: unknown series kind " + std::to_string(series_kinds[s]));
+        }
+        series.push_back(PopulationSeries{static_cast<PopulationSeries::Kind>(series_kinds[s]),
+                                          series_names[s]});
+    }
+    if (auto err = populationError(p, factors, correlation, series, times))
+    {
+        Rcpp::stop(*err);
+    }
 
-    SystemR sys(std::move(p), show_progress);
-    const auto status = sys.run();
+    const auto summary = simulatePopulation(
+        p, factors, correlation, series, times, static_cast<std::size_t>(n),
+        static_cast<std::uint64_t>(seed), n_threads, static_cast<std::size_t>(chunk), 100.0,
+        [] { Rcpp::checkUserInterrupt(); });
 
-    std::string status_str = "executed";
-    if (status == System::Result::Stopped) status_str = "stopped";
-    if (status == System::Result::Failed)  status_str = "failed";
+    const auto n_t = static_cast<int>(times.size());
+    const auto n_p = static_cast<int>(probs.size());
+    Rcpp::List quantiles(series.size());
+    for (std::size_t s = 0; s < series.size(); ++s)
+    {
+        Rcpp::NumericMatrix m(n_t, n_p);
+        for (int t = 0; t < n_t; ++t)
+        {
+            const auto& sketch = summary.at(s, static_cast<std::size_t>(t));
+            for (int k = 0; k < n_p; ++k)
+            {
+                m(t, k) = sketch.quantile(probs[static_cast<std::size_t>(k)]);
+            }
+        }
+        quantiles[static_cast<R_xlen_t>(s)] = m;
+    }
+    return Rcpp::List::create(Rcpp::Named("quantiles") = quantiles,
+                              Rcpp::Named("subjects")  = static_cast<double>(summary.subjects),
+                              Rcpp::Named("failed")    = static_cast<double>(summary.failed));
+}
+
+// Columns `columns` (all if NULL) of the batch file at `path` for the
+// scenario ids `scenarios` (all if NULL, by increasing id), as a named
+// list that starts with `scenario`. Series columns come as lists.
+// [[Rcpp::export(name = ".cpp_batch_read", rng = false)]]
+Rcpp::List cpp_batch_read(std::string path,
+                          Rcpp::Nullable<Rcpp::CharacterVector> columns = R_NilValue,
+                          Rcpp::Nullable<Rcpp::IntegerVector> scenarios = R_NilValue)
+{
+    auto reader = BatchReader::open(path);
+    if (!reader || reader->find("scenario") != 0)
+    {
+        Rcpp::stop("Not a complete skindiff batch file: " + path);
+    }
+
+    std::vector<std::size_t> all(reader->rows());
+    std::iota(all.begin(), all.end(), std::size_t{0});
+    const auto ids = reader->ints(0, all);
+    std::vector<std::size_t> rows;
+    if (scenarios.isNull())
+    {
+        rows = all;
+        std::sort(rows.begin(), rows.end(),
+                  [&ids](std::size_t a, std::size_t b) { return ids[a] < ids[b]; });
+    }
+    else
+    {
+        std::unordered_map<std::int64_t, std::size_t> row_of;
+        for (std::size_t r = 0; r < ids.size(); ++r) row_of.emplace(ids[r], r);
+        for (const auto id : Rcpp::IntegerVector(scenarios.get()))
+        {
+            const auto it = row_of.find(id);
+            if (it == row_of.end())
+            {
+                Rcpp::stop("scenario " + std::to_string(id) + " is not in " + path);
+            }
+            rows.push_back(it->second);
+        }
+    }
 
-    const auto& parms = sys.parameters();
-    return Rcpp::List::create(
-        Rcpp::Named("status")   = status_str,
-        Rcpp::Named("scaling")  = std::string(toString(parms.log.scaling)),
-        Rcpp::Named("mass")     = massSeriesToList(sys.compartmentMass(),
-                                                   sys.compartmentNames(),
-                                                   sys.sinkMass(), parms.sink.name),
-        Rcpp::Named("cdp")      = cdpToList(sys.cdp(), sys.compartmentNames()),
-        Rcpp::Named("geometry") = geometryToList(sys.geometry()));
+    std::vector<std::string> names;
+    if (columns.isNull())
+    {
+        for (const auto& c : reader->columns()) names.push_back(c.name);
+    }
+    else
+    {
+        names = Rcpp::as<std::vector<std::string>>(columns.get());
+        names.insert(names.begin(), "scenario");
+    }
+
+    Rcpp::List out;
+    std::vector<std::string> done;
+    for (const auto& name : names)
+    {
+        if (std::find(done.begin(), done.end(), name) != done.end()) continue;
+        const auto col = reader->find(name);
+        if (col < 0) Rcpp::stop("No column '" + name + "' in " + path);
+        const auto c = static_cast<std::size_t>(col);
+        switch (reader->columns()[c].kind)
+        {
+            case BatchColumn::Kind::Int:
+            {
+                const auto v = reader->ints(c, rows);
+                out.push_back(Rcpp::wrap(std::vector<int>(v.begin(), v.end())), name);
+                break;
+            }
+            case BatchColumn::Kind::Double:
+                out.push_back(Rcpp::wrap(reader->doubles(c, rows)), name);
+                break;
+            case BatchColumn::Kind::Series:
+            {
+                const auto v = reader->series(c, rows);
+                Rcpp::List l(v.size());
+                for (std::size_t r = 0; r < v.size(); ++r)
+                {
+                    l[static_cast<R_xlen_t>(r)] = Rcpp::wrap(v[r]);
+                }
+                out.push_back(l, name);
+                break;
+            }
+        }
+        done.push_back(name);
+    }
+    return out;
+}
+
+// Callables for compiled code in other packages (see inst/include/skindiff.h).
+// [[Rcpp::init]]
+void registerApi(DllInfo* /*dll*/)
+{
+    auto reg = [](const char* name, auto fn) {
+        using Generic = void (*)();
+        R_RegisterCCallable("skindiff", name,
+                            reinterpret_cast<DL_FUNC>(reinterpret_cast<Generic>(fn)));
+    };
+    reg("skindiff_api_version",       &skindiff_api_version);
+    reg("skindiff_validate",          &skindiff_validate);
+    reg("skindiff_system_new",        &skindiff_system_new);
+    reg("skindiff_system_delete",     &skindiff_system_delete);
+    reg("skindiff_system_run",        &skindiff_system_run);
+    reg("skindiff_system_resume",     &skindiff_system_resume);
+    reg("skindiff_system_checkpoint", &skindiff_system_checkpoint);
+    reg("skindiff_system_metrics",    &skindiff_system_metrics);
+    reg("skindiff_choose_resolution", &skindiff_choose_resolution);
+    reg("skindiff_geometry_create",   &skindiff_geometry_create);
+    reg("skindiff_build_matrix",      &skindiff_build_matrix);
 }
@@ -0,0 +1,368 @@
+#include "reducedmodel.h"
+
+#include "algorithms.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+namespace sc
+{
+    namespace
+    {
+        using Vec = std::vector<double>;
+
+        double dotW(const Vec& x, const Vec& y, const Vec& w) noexcept
+        {
+            double s = 0.0;
+            for (std::size_t i = 0; i < x.size(); ++i) s += w[i] * x[i] * y[i];
+            return s;
+        }
+
+        // Cyclic Jacobi eigen-decomposition of the symmetric r x r matrix
+        // `a` (row-major, destroyed). Eigenvectors are returned as the
+        // columns of `q` (row-major). r stays in the tens, so the O(r^3)
+        // sweeps are negligible next to building the basis.
+        void jacobiEigen(Vec& a, int r, Vec& eval, Vec& q)
+        {
+            const auto at = [r](int i, int j) { return static_cast<std::size_t>(i * r + j); };
+            q.assign(static_cast<std::size_t>(r * r), 0.0);
+            for (int i = 0; i < r; ++i) q[at(i, i)] = 1.0;
+
+            for (int sweep = 0; sweep < 100; ++sweep)
+            {
+                double off = 0.0, scale = 0.0;
+                for (int i = 0; i < r; ++i)
+                {
+                    scale += a[at(i, i)] * a[at(i, i)];
+                    for (int j = i + 1; j < r; ++j) off += a[at(i, j)] * a[at(i, j)];
+                }
+                if (off <= 1e-30 * scale) break;
+
+                for (int p = 0; p < r - 1; ++p)
+                {
+                    for (int k = p + 1; k < r; ++k)
+                    {
+                        const auto apk = a[at(p, k)];
+                        if (apk == 0.0) continue;
+                        const auto theta = (a[at(k, k)] - a[at(p, p)]) / (2.0 * apk);
+                        const auto t = (theta >= 0.0 ? 1.0 : -1.0) /
+                                       (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                        const auto c = 1.0 / std::sqrt(t * t + 1.0);
+                        const auto s = t * c;
+
+                        for (int i = 0; i < r; ++i)
+                        {
+                            const auto aip = a[at(i, p)];
+                            const auto aik = a[at(i, k)];
+                            a[at(i, p)] = c * aip - s * aik;
+                            a[at(i, k)] = s * aip + c * aik;
+                        }
+                        for (int j = 0; j < r; ++j)
+                        {
+                            const auto apj = a[at(p, j)];
+                            const auto akj = a[at(k, j)];
+                            a[at(p, j)] = c * apj - s * akj;
+                            a[at(k, j)] = s * apj + c * akj;
+                        }
+                        for (int i = 0; i < r; ++i)
+                        {
+                            const auto qip = q[at(i, p)];
+                            const auto qik = q[at(i, k)];
+                            q[at(i, p)] = c * qip - s * qik;
+                            q[at(i, k)] = s * qip + c * qik;
+                        }
+                    }
+                }
+            }
+
+            eval.resize(static_cast<std::size_t>(r));
+            for (int i = 0; i < r; ++i) eval[static_cast<std::size_t>(i)] = a[at(i, i)];
+        }
+
+        // phi_1(l, t) = (e^{lt} - 1) / l and phi_2(l, t) = (e^{lt} - 1 - lt) / l^2,
+        // with series for small |l t| to avoid cancellation.
+        void phi12(double l, double t, double& phi1, double& phi2) noexcept
+        {
+            const auto x = l * t;
+            if (std::abs(x) < 1e-5)
+            {
+                phi1 = t * (1.0 + x / 2.0 + x * x / 6.0);
+                phi2 = t * t * (0.5 + x / 6.0 + x * x / 24.0);
+                return;
+            }
+            const auto em1 = std::expm1(x);
+            phi1 = em1 / l;
+            phi2 = (em1 - x) / (l * l);
+        }
+    }
+
+    bool ReducedModel::build(const TDMatrix& op, const std::vector<double>& weights,
+                             const std::vector<double>& state, int first, int last,
+                             int order, double horizon)
+    {
+        assert(first >= 0 && last > first && last + 1 < op.size());
+        assert(order > 0 && horizon > 0.0);
+
+        const auto n  = last - first + 1;
+        const auto un = static_cast<std::size_t>(n);
+        m_first = first;
+        m_n     = n;
+
+        // Free block of A, capacities, initial state, donor source.
+        TDMatrix a_free(n);
+        Vec w(un), x0(un), b(un, 0.0);
+        for (int j = 0; j < n; ++j)
+        {
+            const auto i = first + j;
+            a_free.diag(j) = op.diag(i);
+            if (j < n - 1)
+            {
+                a_free.lower(j) = op.lower(i);
+                a_free.upper(j) = op.upper(i);
+            }
+            w[static_cast<std::size_t>(j)]  = weights[static_cast<std::size_t>(i)];
+            x0[static_cast<std::size_t>(j)] = state[static_cast<std::size_t>(i)];
+        }
+        if (first > 0)
+        {
+            b[0] = op.lower(first - 1) * state[static_cast<std::size_t>(first - 1)];
+        }
+        m_sink0         = state[static_cast<std::size_t>(last + 1)];
+        m_sink_coupling = op.lower(last);
+
+        // ---- W-orthonormal rational Krylov basis ----
+        std::vector<Vec> basis;
+        const auto add = [&](Vec v)
+        {
+            if (static_cast<int>(basis.size()) >= order) return;
+            const auto norm0 = std::sqrt(dotW(v, v, w));
+            if (!(norm0 > 0.0)) return;
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (const auto& q : basis)
+                {
+                    const auto c = dotW(q, v, w);
+                    for (std::size_t i = 0; i < un; ++i) v[i] -= c * q[i];
+                }
+            }
+            const auto norm = std::sqrt(dotW(v, v, w));
+            if (!(norm > 1e-10 * norm0)) return;
+            for (auto& x : v) x /= norm;
+            basis.push_back(std::move(v));
+        };
+
+        std::vector<Vec> seeds;
+        const auto has_x0 = std::any_of(x0.begin(), x0.end(), [](double x) { return x != 0.0; });
+        if (has_x0) seeds.push_back(x0);
+        if (b[0] != 0.0)
+        {
+            Vec e(un, 0.0);
+            e[0] = 1.0;
+            seeds.push_back(std::move(e));
+        }
+        {
+            Vec e(un, 0.0);
+            e[un - 1] = 1.0;
+            seeds.push_back(std::move(e));
+        }
+
+        if (has_x0) add(x0);
+
+        // Shifts from the slowest time scale of the run to the fastest one
+        // that is still visible at minute resolution.
+        double a_max = 0.0;
+        for (int j = 0; j < n; ++j) a_max = std::max(a_max, std::abs(a_free.diag(j)));
+        const auto s_lo = 0.1 / horizon;
+        const auto s_hi = std::max(s_lo * 10.0, std::min(2.0 * a_max, 50.0));
+        const auto n_seeds  = static_cast<int>(seeds.size());
+        const auto n_left   = order - static_cast<int>(basis.size());
+        const auto n_shifts = std::max(1, (n_left + n_seeds - 1) / n_seeds);
+
+        // Even-indexed shifts first: the basis built from them is a Galerkin
+        // space on a grid twice as coarse, nested in the full one, and is
+        // reused below for the error estimate.
+        int coarse = 0;
+        for (int i = 0; i < n_shifts; ++i)
+        {
+            const auto k = i < (n_shifts + 1) / 2 ? 2 * i : 2 * (i - (n_shifts + 1) / 2) + 1;
+            if (i == (n_shifts + 1) / 2) coarse = static_cast<int>(basis.size());
+            const auto frac  = n_shifts > 1 ? static_cast<double>(k) / (n_shifts - 1) : 0.0;
+            const auto sigma = s_lo * std::pow(s_hi / s_lo, frac);
+            TDMatrix shifted(n);
+            for (int j = 0; j < n; ++j) shifted.diag(j) = sigma - a_free.diag(j);
+            for (int j = 0; j < n - 1; ++j)
+            {
+                shifted.lower(j) = -a_free.lower(j);
+                shifted.upper(j) = -a_free.upper(j);
+            }
+            for (const auto& s : seeds)
+            {
+                auto v = s;
+                algorithm::thomasIP(shifted, v);
+                add(std::move(v));
+            }
+        }
+
+        const auto r  = static_cast<int>(basis.size());
+        const auto ur = static_cast<std::size_t>(r);
+        m_order = r;
+        if (r == 0) return false;
+
+        // ---- Reduced operator V^T W A V, diagonalised ----
+        Vec ar(ur * ur);
+        {
+            std::vector<Vec> av(ur);
+            for (std::size_t k = 0; k < ur; ++k) av[k] = a_free * basis[k];
+            for (std::size_t p = 0; p < ur; ++p)
+            {
+                for (std::size_t k = p; k < ur; ++k)
+                {
+                    const auto v = 0.5 * (dotW(basis[p], av[k], w) + dotW(basis[k], av[p], w));
+                    ar[p * ur + k] = v;
+                    ar[k * ur + p] = v;
+                }
+            }
+        }
+        // Initial state and source in basis coordinates: V^T W x.
+        Vec p0(ur), pb(ur);
+        for (std::size_t k = 0; k < ur; ++k)
+        {
+            p0[k] = dotW(basis[k], x0, w);
+            pb[k] = dotW(basis[k], b, w);
+        }
+
+        Vec q;
+        {
+            auto a_copy = ar;
+            jacobiEigen(a_copy, r, m_lambda, q);
+        }
+        m_modes.assign(un * ur, 0.0);
+        for (std::size_t j = 0; j < un; ++j)
+        {
+            for (std::size_t m = 0; m < ur; ++m)
+            {
+                double u = 0.0;
+                for (std::size_t k = 0; k < ur; ++k) u += basis[k][j] * q[k * ur + m];
+                m_modes[j * ur + m] = u;
+            }
+        }
+        m_z0.assign(ur, 0.0);
+        m_g.assign(ur, 0.0);
+        for (std::size_t m = 0; m < ur; ++m)
+        {
+            for (std::size_t k = 0; k < ur; ++k)
+            {
+                m_z0[m] += q[k * ur + m] * p0[k];
+                m_g[m]  += q[k * ur + m] * pb[k];
+            }
+        }
+
+        // ---- Embedded model on the even-indexed shifts ----
+        // The leading columns of V are a Galerkin space of their own, whose
+        // reduced operator is the leading block of V^T W A V. Only its sink
+        // output is kept; the gap to the full model estimates (but does not
+        // bound) the error.
+        m_coarse_lambda.clear();
+        m_coarse_row.clear();
+        m_coarse_z0.clear();
+        m_coarse_g.clear();
+        const auto rc = std::min(coarse, r - 1);
+        if (rc > 0)
+        {
+            const auto urc = static_cast<std::size_t>(rc);
+            Vec ac(urc * urc), qc;
+            for (std::size_t p = 0; p < urc; ++p)
+            {
+                for (std::size_t k = 0; k < urc; ++k) ac[p * urc + k] = ar[p * ur + k];
+            }
+            jacobiEigen(ac, rc, m_coarse_lambda, qc);
+            m_coarse_row.assign(urc, 0.0);
+            m_coarse_z0.assign(urc, 0.0);
+            m_coarse_g.assign(urc, 0.0);
+            for (std::size_t m = 0; m < urc; ++m)
+            {
+                for (std::size_t k = 0; k < urc; ++k)
+                {
+                    m_coarse_row[m] += basis[k][un - 1] * qc[k * urc + m];
+                    m_coarse_z0[m]  += qc[k * urc + m] * p0[k];
+                    m_coarse_g[m]   += qc[k * urc + m] * pb[k];
+                }
+            }
+        }
+        return true;
+    }
+
+    void ReducedModel::modal(double t, std::vector<double>& z, double& sink) const
+    {
+        const auto ur = static_cast<std::size_t>(m_order);
+        const auto row = static_cast<std::size_t>(m_n - 1) * ur;
+        z.resize(ur);
+        double mem_int = 0.0;
+        for (std::size_t m = 0; m < ur; ++m)
+        {
+            double phi1 = 0.0, phi2 = 0.0;
+            phi12(m_lambda[m], t, phi1, phi2);
+            const auto phi0 = 1.0 + m_lambda[m] * phi1;   // e^{lt}
+            z[m] = phi0 * m_z0[m] + phi1 * m_g[m];
+            mem_int += m_modes[row + m] * (phi1 * m_z0[m] + phi2 * m_g[m]);
+        }
+        // Sink: s(t) = s(0) + coupling * int_0^t u_membrane.
+        sink = m_sink0 + m_sink_coupling * mem_int;
+    }
+
+    void ReducedModel::expand(const std::vector<double>& z, int from, int to,
+                              std::vector<double>& state) const
+    {
+        const auto ur = static_cast<std::size_t>(m_order);
+        for (int j = std::max(0, from - m_first); j <= std::min(m_n - 1, to - m_first); ++j)
+        {
+            const auto row = static_cast<std::size_t>(j) * ur;
+            double u = 0.0;
+            for (std::size_t m = 0; m < ur; ++m) u += m_modes[row + m] * z[m];
+            state[static_cast<std::size_t>(m_first + j)] = u;
+        }
+    }
+
+    void ReducedModel::evaluate(double t, std::vector<double>& state) const
+    {
+        Vec    z;
+        double sink = 0.0;
+        modal(t, z, sink);
+        expand(z, m_first, m_first + m_n - 1, state);
+        state[static_cast<std::size_t>(m_first + m_n)] = sink;
+    }
+
+    std::vector<double> ReducedModel::project(const std::vector<double>& c) const
+    {
+        const auto ur = static_cast<std::size_t>(m_order);
+        Vec out(ur, 0.0);
+        for (int j = 0; j < m_n; ++j)
+        {
+            const auto cj = c[static_cast<std::size_t>(m_first + j)];
+            if (cj == 0.0) continue;
+            const auto row = static_cast<std::size_t>(j) * ur;
+            for (std::size_t m = 0; m < ur; ++m) out[m] += cj * m_modes[row + m];
+        }
+        return out;
+    }
+
+    double ReducedModel::sinkErrorEstimate(double t) const
+    {
+        if (m_coarse_lambda.empty()) return -1.0;
+
+        Vec    z;
+        double sink = 0.0;
+        modal(t, z, sink);
+
+        double mem_int = 0.0;
+        for (std::size_t m = 0; m < m_coarse_lambda.size(); ++m)
+        {
+            double phi1 = 0.0, phi2 = 0.0;
+            phi12(m_coarse_lambda[m], t, phi1, phi2);
+            mem_int += m_coarse_row[m] * (phi1 * m_coarse_z0[m] + phi2 * m_coarse_g[m]);
+        }
+        return std::abs(sink - (m_sink0 + m_sink_coupling * mem_int));
+    }
+}
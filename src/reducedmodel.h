@@ -0,0 +1,82 @@
+#ifndef SC_REDUCEDMODEL_H
+#define SC_REDUCEDMODEL_H
+
+#include "tdmatrix.h"
+
+#include <vector>
+
+namespace sc
+{
+    // Galerkin reduced-order model of the semi-discrete system du/dt = A u
+    // (A = MatrixBuilder::matrixOperator(), per minute).
+    //
+    // Cells [first, last] are the free unknowns. Cells before `first` (a
+    // clamped donor) keep their initial value and act as a constant source;
+    // cell last + 1 is the sink accumulator, whose value is the time
+    // integral of the membrane flux. On the free block A is self-adjoint
+    // and dissipative in the inner product <x, y>_W = sum w_i x_i y_i with
+    // the cell capacities w_i = K_i * A_i * h_i, so a W-orthonormal Galerkin
+    // basis V gives a symmetric, stable reduced operator V^T W A V.
+    //
+    // V spans a rational Krylov space: the initial state plus the solutions
+    // of (sigma I - A) v = s for log-spaced shifts sigma over the time
+    // scales of the run and the seeds s = {initial state, donor source,
+    // membrane output}. Every basis vector costs one tri-diagonal solve.
+    // The reduced operator is diagonalised once, after which the model is
+    // evaluated in closed form at any time: O(N r) for the full state,
+    // O(r^2) for the residual that drives the error estimate.
+    class ReducedModel
+    {
+      public:
+        ReducedModel() = default;
+
+        // `state` is the initial state over the full mesh; `horizon` the
+        // run length in minutes. `order` caps the basis size; near-linearly
+        // dependent candidates are dropped, so order() may come out lower.
+        bool build(const TDMatrix& op, const std::vector<double>& weights,
+                   const std::vector<double>& state, int first, int last, int order,
+                   double horizon);
+
+        [[nodiscard]] int order() const noexcept { return m_order; }
+
+        // Writes the reduced solution at time t (min) into state[first ..
+        // last + 1]. Clamped donor cells are left untouched.
+        void evaluate(double t, std::vector<double>& state) const;
+
+        // The same in two parts, for callers that need only a few outputs:
+        // modal coordinates z(t) plus the sink cell value, then expansion
+        // of z into the cells [from, to] (clipped to the free range).
+        void modal(double t, std::vector<double>& z, double& sink) const;
+        void expand(const std::vector<double>& z, int from, int to,
+                    std::vector<double>& state) const;
+        // Reduced form U^T c of a linear functional c over the full mesh,
+        // so that c^T u(t) = project(c) . z(t) on the free cells.
+        [[nodiscard]] std::vector<double> project(const std::vector<double>& c) const;
+
+        // Error estimate for the sink cell at time t: the gap to the nested
+        // Galerkin model built from every other shift. A heuristic, not a
+        // bound -- the true error can exceed it. Negative if the basis has a
+        // single shift.
+        [[nodiscard]] double sinkErrorEstimate(double t) const;
+
+      private:
+        int    m_first = 0;
+        int    m_n     = 0;    // free cells
+        int    m_order = 0;
+        double m_sink0 = 0.0;
+        double m_sink_coupling = 0.0;
+
+        std::vector<double> m_modes;     // n x r, row-major: V * Q
+        std::vector<double> m_lambda;    // eigenvalues of V^T W A V
+        std::vector<double> m_z0;        // modal initial state
+        std::vector<double> m_g;         // modal source
+
+        // Embedded lower-order model, sink output only.
+        std::vector<double> m_coarse_lambda;
+        std::vector<double> m_coarse_row;
+        std::vector<double> m_coarse_z0;
+        std::vector<double> m_coarse_g;
+    };
+}
+
+#endif  // SC_REDUCEDMODEL_H
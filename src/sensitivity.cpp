@@ -0,0 +1,445 @@
+#include "sensitivity.h"
+
+#include "autoresolution.h"
+#include "parallel.h"
+#include "system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace sc
+{
+    namespace
+    {
+        // Degree s, coefficients a and initial direction numbers m_1..m_s
+        // of dimensions 2 to 40 of new-joe-kuo-6.21201.
+        struct Direction
+        {
+            int           s;
+            std::uint32_t a;
+            std::uint32_t m[8];
+        };
+
+        const Direction kDirections[SobolSequence::kMaxDims - 1] = {
+            {1, 0, {1}},
+            {2, 1, {1, 3}},
+            {3, 1, {1, 3, 1}},
+            {3, 2, {1, 1, 1}},
+            {4, 1, {1, 1, 3, 3}},
+            {4, 4, {1, 3, 5, 13}},
+            {5, 2, {1, 1, 5, 5, 17}},
+            {5, 4, {1, 1, 5, 5, 5}},
+            {5, 7, {1, 1, 7, 11, 19}},
+            {5, 11, {1, 1, 5, 1, 1}},
+            {5, 13, {1, 1, 1, 3, 11}},
+            {5, 14, {1, 3, 5, 5, 31}},
+            {6, 1, {1, 3, 3, 9, 7, 49}},
+            {6, 13, {1, 1, 1, 15, 21, 21}},
+            {6, 16, {1, 3, 1, 13, 27, 49}},
+            {6, 19, {1, 1, 1, 15, 7, 5}},
+            {6, 22, {1, 3, 1, 15, 13, 25}},
+            {6, 25, {1, 1, 5, 5, 19, 61}},
+            {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+            {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+            {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+            {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+            {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+            {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+            {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+            {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+            {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+            {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+            {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+            {7, 41, {1, 3, 5, 13, 23, 1, 55}},
+            {7, 42, {1, 3, 7, 3, 13, 59, 17}},
+            {7, 50, {1, 3, 1, 3, 5, 53, 69}},
+            {7, 55, {1, 1, 5, 5, 23, 33, 13}},
+            {7, 56, {1, 1, 7, 7, 1, 61, 123}},
+            {7, 59, {1, 1, 7, 9, 13, 61, 49}},
+            {7, 62, {1, 3, 3, 5, 3, 55, 33}},
+            {8, 14, {1, 3, 1, 15, 31, 13, 49, 245}},
+            {8, 21, {1, 3, 5, 15, 31, 59, 63, 97}},
+            {8, 22, {1, 3, 1, 11, 11, 11, 77, 249}},
+        };
+
+        constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+        bool setLayer(LayerParams& l, const std::string& field, double v)
+        {
+            if (field == "c_init")               l.c_init          = v;
+            else if (field == "D")               l.D               = v;
+            else if (field == "K")               l.K               = v;
+            else if (field == "cross_section")   l.cross_section   = v;
+            else if (field == "height")          l.height = static_cast<int>(std::lround(v));
+            else if (field == "brick.width")     l.brick.width     = v;
+            else if (field == "brick.thickness") l.brick.thickness = v;
+            else if (field == "brick.mortar")    l.brick.mortar    = v;
+            else if (field == "brick.D_brick")   l.brick.D_brick   = v;
+            else if (field == "brick.K_brick")   l.brick.K_brick   = v;
+            else return false;
+            return true;
+        }
+
+        // The rest of `path` after `prefix`, if it starts with it.
+        std::optional<std::string> after(const std::string& path, const std::string& prefix)
+        {
+            if (path.size() <= prefix.size() || path.compare(0, prefix.size(), prefix) != 0)
+            {
+                return std::nullopt;
+            }
+            return path.substr(prefix.size());
+        }
+
+        double factorValue(const SensitivityFactor& f, double u)
+        {
+            return f.log ? f.lower * std::pow(f.upper / f.lower, u)
+                         : f.lower + u * (f.upper - f.lower);
+        }
+
+        std::vector<double> outputsOf(const System& sys,
+                                      const std::vector<SensitivityOutput>& outputs)
+        {
+            using Kind = SensitivityOutput::Kind;
+            const auto area = sys.parameters().vehicle.app_area;
+            const auto m    = sys.parameters().metrics.enabled ? sys.metrics() : RunMetrics{};
+            std::vector<double> out;
+            out.reserve(outputs.size());
+            for (const auto& o : outputs)
+            {
+                switch (o.kind)
+                {
+                    case Kind::Permeated:  out.push_back(sys.sinkMass().at(o.time) / area); break;
+                    case Kind::QTotal:     out.push_back(m.q_total / area); break;
+                    case Kind::JSS:        out.push_back(m.j_ss / area); break;
+                    case Kind::TLag:       out.push_back(m.t_lag); break;
+                    case Kind::JMax:       out.push_back(m.j_max / area); break;
+                    case Kind::TDonorHalf: out.push_back(m.t_donor_half); break;
+                    case Kind::AUC:        out.push_back(m.auc); break;
+                    case Kind::CMax:       out.push_back(m.c_max); break;
+                    case Kind::TMax:       out.push_back(m.t_max); break;
+                }
+            }
+            return out;
+        }
+    }
+
+    SobolSequence::SobolSequence(std::size_t dims)
+        : m_dims(dims)
+    {
+        if (dims == 0 || dims > kMaxDims)
+        {
+            throw std::invalid_argument("SobolSequence: 1 to 40 dimensions");
+        }
+        m_v.assign(dims * kBits, 0u);
+        for (int b = 0; b < kBits; ++b) m_v[static_cast<std::size_t>(b)] = 1u << (kBits - 1 - b);
+        for (std::size_t d = 1; d < dims; ++d)
+        {
+            const auto& dir = kDirections[d - 1];
+            auto* v = &m_v[d * kBits];
+            for (int b = 0; b < kBits; ++b)
+            {
+                if (b < dir.s)
+                {
+                    v[b] = dir.m[b] << (kBits - 1 - b);
+                    continue;
+                }
+                v[b] = v[b - dir.s] ^ (v[b - dir.s] >> dir.s);
+                for (int k = 1; k < dir.s; ++k)
+                {
+                    if ((dir.a >> (dir.s - 1 - k)) & 1u) v[b] ^= v[b - k];
+                }
+            }
+        }
+    }
+
+    std::vector<double> SobolSequence::point(std::uint64_t i) const
+    {
+        const auto gray = i ^ (i >> 1);
+        std::vector<double> out(m_dims);
+        for (std::size_t d = 0; d < m_dims; ++d)
+        {
+            std::uint32_t x = 0;
+            for (int b = 0; b < kBits && (gray >> b) != 0; ++b)
+            {
+                if ((gray >> b) & 1u) x ^= m_v[d * kBits + static_cast<std::size_t>(b)];
+            }
+            out[d] = std::ldexp(static_cast<double>(x), -kBits);
+        }
+        return out;
+    }
+
+    SobolAccumulator::SobolAccumulator(std::size_t n_factors, std::size_t n_outputs)
+        : m_factors(n_factors)
+        , m_out(n_outputs)
+    {
+        for (auto& o : m_out)
+        {
+            o.first.assign(n_factors, 0.0);
+            o.delta.assign(n_factors, 0.0);
+            o.total.assign(n_factors, 0.0);
+        }
+    }
+
+    void SobolAccumulator::add(const std::vector<double>& f_a, const std::vector<double>& f_b,
+                               const std::vector<std::vector<double>>& f_ab)
+    {
+        for (std::size_t k = 0; k < m_out.size(); ++k)
+        {
+            bool finite = std::isfinite(f_a[k]) && std::isfinite(f_b[k]);
+            for (std::size_t j = 0; finite && j < m_factors; ++j)
+                finite = std::isfinite(f_ab[j][k]);
+            if (!finite) continue;
+
+            auto& o = m_out[k];
+            if (!o.referenced)
+            {
+                o.ref        = f_a[k];
+                o.referenced = true;
+            }
+            const auto a = f_a[k] - o.ref;
+            const auto b = f_b[k] - o.ref;
+            for (const auto x : {a, b})
+            {
+                ++o.m;
+                const auto d = x - o.mean;
+                o.mean += d / static_cast<double>(o.m);
+                o.m2   += d * (x - o.mean);
+            }
+            for (std::size_t j = 0; j < m_factors; ++j)
+            {
+                const auto delta = (f_ab[j][k] - o.ref) - a;
+                o.first[j] += b * delta;
+                o.delta[j] += delta;
+                o.total[j] += delta * delta;
+            }
+            ++o.n;
+        }
+    }
+
+    double SobolAccumulator::mean(std::size_t output) const
+    {
+        const auto& o = m_out[output];
+        return o.n > 0 ? o.ref + o.mean : kNaN;
+    }
+
+    double SobolAccumulator::variance(std::size_t output) const
+    {
+        const auto& o = m_out[output];
+        return o.n > 1 ? o.m2 / static_cast<double>(o.m - 1) : kNaN;
+    }
+
+    double SobolAccumulator::first(std::size_t factor, std::size_t output) const
+    {
+        const auto& o = m_out[output];
+        const auto  v = variance(output);
+        if (!(v > 0.0)) return kNaN;
+        return (o.first[factor] - o.mean * o.delta[factor]) / static_cast<double>(o.n) / v;
+    }
+
+    double SobolAccumulator::total(std::size_t factor, std::size_t output) const
+    {
+        const auto& o = m_out[output];
+        const auto  v = variance(output);
+        if (!(v > 0.0)) return kNaN;
+        return o.total[factor] / (2.0 * static_cast<double>(o.n)) / v;
+    }
+
+    SobolAccumulator sobolIndices(std::size_t n_factors, std::size_t n_outputs,
+                                  std::size_t n_base, const SobolModel& model, int n_threads,
+                                  std::size_t chunk, const std::function<void()>& between_chunks)
+    {
+        if (n_factors == 0 || 2 * n_factors > SobolSequence::kMaxDims)
+        {
+            throw std::invalid_argument("sobolIndices: 1 to 20 factors");
+        }
+        const SobolSequence seq(2 * n_factors);
+        SobolAccumulator    acc(n_factors, n_outputs);
+        const auto per = n_factors + 2;   // A, B, AB_1 .. AB_d
+        chunk = std::max<std::size_t>(1, chunk);
+
+        for (std::size_t from = 0; from < n_base; from += chunk)
+        {
+            const auto n = std::min(chunk, n_base - from);
+            std::vector<std::vector<double>> f(n * per);
+            parallelFor(static_cast<int>(n * per), n_threads, [&](int task)
+            {
+                const auto t  = static_cast<std::size_t>(task);
+                const auto r  = t % per;
+                const auto pt = seq.point(from + t / per + 1);
+                const auto split = pt.begin() + static_cast<std::ptrdiff_t>(n_factors);
+                std::vector<double> x = r == 1 ? std::vector<double>(split, pt.end())
+                                               : std::vector<double>(pt.begin(), split);
+                if (r >= 2) x[r - 2] = pt[n_factors + r - 2];
+                auto y = model(x);
+                if (y.size() != n_outputs)
+                {
+                    throw std::runtime_error("sobolIndices: wrong number of model outputs");
+                }
+                f[t] = std::move(y);
+            });
+
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                const auto at = f.begin() + static_cast<std::ptrdiff_t>(k * per);
+                acc.add(at[0], at[1], std::vector<std::vector<double>>(
+                                          at + 2, at + static_cast<std::ptrdiff_t>(per)));
+            }
+            if (between_chunks) between_chunks();
+        }
+        return acc;
+    }
+
+    bool setParameter(Parameters& p, const std::string& path, double value)
+    {
+        if (auto field = after(path, "vehicle."))
+        {
+            auto& v = p.vehicle;
+            if (*field == "c_init")        v.c_init   = value;
+            else if (*field == "app_area") v.app_area = value;
+            else if (*field == "D")        v.D        = value;
+            else if (*field == "height")   v.height   = static_cast<int>(std::lround(value));
+            else return false;
+            return true;
+        }
+        if (auto field = after(path, "sink.pk."))
+        {
+            auto& k = p.sink.pk;
+            if (*field == "V1")       k.V1  = value;
+            else if (*field == "CL")  k.CL  = value;
+            else if (*field == "k12") k.k12 = value;
+            else if (*field == "k21") k.k21 = value;
+            else return false;
+            return true;
+        }
+        if (auto field = after(path, "sink."))
+        {
+            if (*field == "c_init")  p.sink.c_init = value;
+            else if (*field == "Vd") p.sink.Vd     = value;
+            else return false;
+            return true;
+        }
+        for (auto& l : p.layers)
+        {
+            if (auto field = after(path, "layers." + l.name + "."))
+                return setLayer(l, *field, value);
+        }
+        for (auto& pw : p.pathways)
+        {
+            for (auto& l : pw.layers)
+            {
+                if (auto field = after(path, "pathways." + pw.name + ".layers." + l.name + "."))
+                {
+                    return setLayer(l, *field, value);
+                }
+            }
+        }
+        return false;
+    }
+
+    std::optional<std::string> sensitivityError(const Parameters& base,
+                                                const std::vector<SensitivityFactor>& factors,
+                                                const std::vector<SensitivityOutput>& outputs)
+    {
+        if (factors.empty()) return "no factors to vary";
+        if (2 * factors.size() > SobolSequence::kMaxDims)
+        {
+            return "at most " + std::to_string(SobolSequence::kMaxDims / 2) + " factors";
+        }
+        if (outputs.empty()) return "no outputs";
+
+        Parameters lower = base, upper = base;
+        for (std::size_t j = 0; j < factors.size(); ++j)
+        {
+            const auto& f = factors[j];
+            for (std::size_t i = 0; i < j; ++i)
+            {
+                if (factors[i].path == f.path) return "factor " + f.path + " is given twice";
+            }
+            if (!setParameter(lower, f.path, f.lower) || !setParameter(upper, f.path, f.upper))
+            {
+                return "no numeric parameter " + f.path;
+            }
+            if (!std::isfinite(f.lower) || !std::isfinite(f.upper) || !(f.lower < f.upper))
+            {
+                return "factor " + f.path + " needs a finite range with lower < upper";
+            }
+            if (f.log && !(f.lower > 0.0))
+            {
+                return "factor " + f.path + " is sampled on a log scale and needs lower > 0";
+            }
+        }
+        for (const auto& o : outputs)
+        {
+            if (o.kind == SensitivityOutput::Kind::Permeated &&
+                !(o.time >= 0.0 && o.time <= base.sys.simulation_time))
+            {
+                return "output time " + std::to_string(o.time) + " min is outside the run";
+            }
+        }
+        if (auto err = validate(lower)) return "with every factor at its lower end: " + *err;
+        if (auto err = validate(upper)) return "with every factor at its upper end: " + *err;
+        return std::nullopt;
+    }
+
+    SobolAccumulator parameterSensitivity(const Parameters& base,
+                                          const std::vector<SensitivityFactor>& factors,
+                                          const std::vector<SensitivityOutput>& outputs,
+                                          std::size_t n_base, int n_threads, std::size_t chunk,
+                                          const std::function<void()>& between_chunks)
+    {
+        if (auto err = sensitivityError(base, factors, outputs)) throw std::invalid_argument(*err);
+
+        // Log only the sink, and only for permeated amounts; the metrics
+        // are accumulated without any logging.
+        const auto permeated = std::any_of(outputs.begin(), outputs.end(), [](const auto& o) {
+            return o.kind == SensitivityOutput::Kind::Permeated;
+        });
+        Parameters p = base;
+        p.sys.n_threads = 1;
+        p.log.cdp_dir.clear();
+        p.log.enabled      = permeated;
+        p.vehicle.log_mass = false;
+        p.vehicle.log_cdp  = false;
+        for (auto& l : p.layers) l.log_mass = l.log_cdp = false;
+        for (auto& pw : p.pathways)
+        {
+            for (auto& l : pw.layers) l.log_mass = l.log_cdp = false;
+        }
+        p.sink.log_mass = permeated;
+        p.metrics.enabled = std::any_of(outputs.begin(), outputs.end(), [](const auto& o) {
+            return o.kind != SensitivityOutput::Kind::Permeated;
+        });
+        p.metrics.permeated.clear();
+
+        const SobolModel model = [&](const std::vector<double>& u) {
+            Parameters q = p;
+            for (std::size_t j = 0; j < factors.size(); ++j)
+            {
+                setParameter(q, factors[j].path, factorValue(factors[j], u[j]));
+            }
+            const std::vector<double> failed(outputs.size(), kNaN);
+            if (validate(q)) return failed;
+            try
+            {
+                if (q.sys.auto_resolution_tol > 0.0)
+                {
+                    const auto choice = chooseResolution(q);
+                    q.sys.resolution = choice.resolution;
+                    q.sys.max_module = choice.max_module;
+                }
+                System sys(std::move(q));
+                if (sys.run() == System::Result::Failed) return failed;
+                return outputsOf(sys, outputs);
+            }
+            catch (const std::runtime_error&)
+            {
+                return failed;
+            }
+        };
+        return sobolIndices(factors.size(), outputs.size(), n_base, model, n_threads, chunk,
+                            between_chunks);
+    }
+}
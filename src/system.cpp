@@ -1,8 +1,19 @@
 #include "system.h"
 
 #include "algorithms.h"
+#include "krylov.h"
+#include "logpipeline.h"
+#include "parallel.h"
+#include "reducedmodel.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
 #include <utility>
 
 namespace sc
@@ -54,6 +65,17 @@ namespace sc
             return cellConc(idx, state, K_per_cell) * ss * sink.area_um2 * scale;
         }
 
+        // Central-compartment concentration of the sink's PK model, in
+        // scaling units / ml. The central mass is the sink value less the
+        // first PK cell (see MatrixBuilder::buildMatrix).
+        double plasmaConcValue(const Sink& sink, const Geometry& geometry,
+                               const std::vector<double>& state, double scale)
+        {
+            const auto idx = static_cast<std::size_t>(sink.geo_from);
+            const auto ss  = geometry.spaceSteps()[idx];
+            return (state[idx] - state[idx + 1]) * ss * sink.area_um2 * scale / sink.pk_V1;
+        }
+
         // Sample concentration profile for a compartment in scaling units / ml.
         std::vector<double> sampleProfile(const Compartment& comp,
                                           const std::vector<double>& state,
@@ -86,6 +108,21 @@ namespace sc
             }
             return depths;
         }
+
+        // File for series `index` (named `name`) in a CDP store directory.
+        // The index keeps names apart that only differ in characters left
+        // out of the file name.
+        std::string cdpStorePath(const std::string& dir, std::size_t index,
+                                 const std::string& name)
+        {
+            auto file = std::to_string(index) + "_";
+            for (const auto ch : name)
+            {
+                const auto keep = std::isalnum(static_cast<unsigned char>(ch)) || ch == '-';
+                file += keep ? ch : '_';
+            }
+            return dir + "/" + file + ".cdp";
+        }
     }
 
     System::System(Parameters parameters)
@@ -100,12 +137,14 @@ namespace sc
         const auto& sk  = m_parameters.sink;
 
         m_matrix_builder.setMaxModule(sys.max_module);
+        m_matrix_builder.setCompact(sys.compact_scheme);
 
         // Vehicle / donor compartment.
         const auto app_area_um2 = cm2_to_um2(v.app_area);
         Compartment donor{v.height, v.D, 1.0, app_area_um2, v.name};
         donor.c_init      = mg_per_ml_to_mg_per_um3(v.c_init);
         donor.finite_dose = v.finite_dose;
+        donor.lumped      = v.lumped;
         m_compartments.push_back(std::move(donor));
 
         // Skin layers.
@@ -113,6 +152,7 @@ namespace sc
         {
             Compartment c{l.height, l.D, l.K, app_area_um2 * l.cross_section, l.name};
             c.c_init = mg_per_ml_to_mg_per_um3(l.c_init);
+            if (l.brick.enabled) m_brick_layer = static_cast<int>(m_compartments.size());
             m_compartments.push_back(std::move(c));
         }
 
@@ -124,8 +164,19 @@ namespace sc
             (m_parameters.layers.empty() ? 1.0 : m_parameters.layers.back().cross_section);
         m_sink.Vd     = sk.Vd;
         m_sink.c_init = mg_per_ml_to_mg_per_um3(sk.c_init);
+        if (sk.pk.enabled)
+        {
+            m_sink.pk     = true;
+            m_sink.pk_V1  = sk.pk.V1;
+            m_sink.pk_ke  = sk.pk.CL / sk.pk.V1;
+            m_sink.pk_k12 = sk.pk.k12;
+            m_sink.pk_k21 = sk.pk.k21;
+        }
 
         buildGeometryAndMatrices();
+        m_pathways.build(m_parameters.pathways, m_compartments, m_geometry, m_sink,
+                         m_matrix_builder.matrixOperator(), m_matrix_builder.timesteps(),
+                         sys.resolution, sys.max_module);
         initConcentrations();
         initLoggers();
     }
@@ -201,10 +252,10 @@ namespace sc
         for (std::size_t i = 0; i < m_compartments.size(); ++i)
         {
             const auto is_vehicle  = (i == 0);
-            const auto mass_enabled =
-                is_vehicle ? v.log_mass : m_parameters.layers[i - 1].log_mass;
-            const auto cdp_enabled =
-                is_vehicle ? v.log_cdp : m_parameters.layers[i - 1].log_cdp;
+            const auto mass_enabled = log.enabled &&
+                (is_vehicle ? v.log_mass : m_parameters.layers[i - 1].log_mass);
+            const auto cdp_enabled = log.enabled &&
+                (is_vehicle ? v.log_cdp : m_parameters.layers[i - 1].log_cdp);
 
             m_mass_series[i].enabled      = mass_enabled;
             m_mass_series[i].log_interval = log.mass_log_interval;
@@ -216,9 +267,53 @@ namespace sc
             m_cdp_series[i].reserve_for_total(m_sim_time);
         }
 
-        m_sink_mass.enabled      = m_parameters.sink.log_mass;
+        // Pathway layers follow the main compartments.
+        std::size_t k = 0;
+        for (const auto& pw : m_parameters.pathways)
+        {
+            for (const auto& l : pw.layers)
+            {
+                m_compartment_names.push_back(l.name);
+                auto& mass = m_mass_series.emplace_back();
+                mass.enabled      = log.enabled && l.log_mass;
+                mass.log_interval = log.mass_log_interval;
+                mass.reserve_for_total(m_sim_time);
+
+                auto& cdp = m_cdp_series.emplace_back();
+                cdp.enabled      = log.enabled && l.log_cdp;
+                cdp.log_interval = log.cdp_log_interval;
+                cdp.depths_um    = m_pathways.depths(k++);
+                cdp.reserve_for_total(m_sim_time);
+            }
+        }
+
+        if (!log.cdp_dir.empty())
+        {
+            const auto capacity = cdpStoreCapacity(0);
+            for (std::size_t i = 0; i < m_cdp_series.size(); ++i)
+            {
+                auto& cdp = m_cdp_series[i];
+                if (!cdp.enabled) continue;
+                cdp.store = std::make_shared<CdpStore>(
+                    cdpStorePath(log.cdp_dir, i, m_compartment_names[i]), cdp.depths_um,
+                    capacity);
+                cdp.conc_per_time = {};
+            }
+        }
+
+        m_sink_mass.enabled      = log.enabled && m_parameters.sink.log_mass;
         m_sink_mass.log_interval = log.mass_log_interval;
         m_sink_mass.reserve_for_total(m_sim_time);
+
+        m_plasma.enabled      = log.enabled && m_sink.pk;
+        m_plasma.log_interval = log.mass_log_interval;
+        m_plasma.reserve_for_total(m_sim_time);
+    }
+
+    std::size_t System::cdpStoreCapacity(int t_from) const noexcept
+    {
+        const auto interval = std::max(1, m_parameters.log.cdp_log_interval);
+        return 2u + static_cast<std::size_t>(std::max(0, m_sim_time - t_from) / interval);
     }
 
     void System::recordAt(double t)
@@ -238,11 +333,98 @@ namespace sc
                     t, sampleProfile(m_compartments[i], m_concentrations, m_K_per_cell, m_scale));
             }
         }
+        const auto n_shunt = m_pathways.compartments().size();
+        for (std::size_t k = 0; k < n_shunt; ++k)
+        {
+            const auto orig = m_mass_series.size() - n_shunt + k;
+            if (m_mass_series[orig].should_log(t))
+            {
+                m_mass_series[orig].record(t, m_pathways.mass(k, m_scale));
+            }
+            if (m_cdp_series[orig].should_log(t))
+            {
+                m_cdp_series[orig].record(t, m_pathways.profile(k, m_scale));
+            }
+        }
         if (m_sink_mass.should_log(t))
         {
             m_sink_mass.record(t, sinkMassValue(m_sink, m_geometry, m_concentrations,
                                                 m_K_per_cell, m_scale));
         }
+        if (m_plasma.should_log(t))
+        {
+            m_plasma.record(t, plasmaConcValue(m_sink, m_geometry, m_concentrations, m_scale));
+        }
+    }
+
+    bool System::shouldLogAt(int t) const noexcept
+    {
+        const auto td = static_cast<double>(t);
+        if (m_sink_mass.should_log(td) || m_plasma.should_log(td)) return true;
+        for (std::size_t i = 0; i < m_compartments.size(); ++i)
+        {
+            const auto orig = static_cast<std::size_t>(m_active_to_orig[i]);
+            if (m_mass_series[orig].should_log(td) || m_cdp_series[orig].should_log(td))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    System::LogRecord System::sampleRecord(double t, const std::vector<double>& state,
+                                           bool all_series) const
+    {
+        LogRecord rec;
+        rec.t = t;
+        rec.mass.assign(m_compartments.size(), 0.0);
+        rec.cdp.resize(m_compartments.size());
+        for (std::size_t i = 0; i < m_compartments.size(); ++i)
+        {
+            const auto orig = static_cast<std::size_t>(m_active_to_orig[i]);
+            if (all_series ? m_mass_series[orig].enabled : m_mass_series[orig].should_log(t))
+            {
+                rec.mass[i] = integrateMass(m_compartments[i], m_geometry, state,
+                                            m_K_per_cell, m_scale);
+            }
+            if (all_series ? m_cdp_series[orig].enabled : m_cdp_series[orig].should_log(t))
+            {
+                rec.cdp[i] = sampleProfile(m_compartments[i], state, m_K_per_cell, m_scale);
+            }
+        }
+        if (all_series || m_sink_mass.should_log(t))
+        {
+            rec.sink_mass = sinkMassValue(m_sink, m_geometry, state, m_K_per_cell, m_scale);
+        }
+        if (all_series ? m_plasma.enabled : m_plasma.should_log(t))
+        {
+            rec.plasma = plasmaConcValue(m_sink, m_geometry, state, m_scale);
+        }
+        return rec;
+    }
+
+    void System::commitRecord(const LogRecord& rec, bool all_series)
+    {
+        for (std::size_t i = 0; i < m_compartments.size(); ++i)
+        {
+            const auto orig = static_cast<std::size_t>(m_active_to_orig[i]);
+            if (all_series ? m_mass_series[orig].enabled : m_mass_series[orig].should_log(rec.t))
+            {
+                m_mass_series[orig].record(rec.t, rec.mass[i]);
+            }
+            if (all_series ? m_cdp_series[orig].enabled : m_cdp_series[orig].should_log(rec.t))
+            {
+                m_cdp_series[orig].record(rec.t, rec.cdp[i]);
+            }
+        }
+        if (all_series ? m_sink_mass.enabled : m_sink_mass.should_log(rec.t))
+        {
+            m_sink_mass.record(rec.t, rec.sink_mass);
+        }
+        if (all_series ? m_plasma.enabled : m_plasma.should_log(rec.t))
+        {
+            m_plasma.record(rec.t, rec.plasma);
+        }
     }
 
     void System::replaceTopCompartment()
@@ -253,6 +435,39 @@ namespace sc
         {
             m_concentrations[static_cast<std::size_t>(i)] = u_init;
         }
+        if (top.finite_dose) shiftFill(m_concentrations);
+    }
+
+    // The freshly filled donor is split into a jump (the fill less the
+    // skin's value at the face, extrapolated from its first two cells)
+    // and a remainder continuous at the face. Only the jump has a lag to
+    // make up; the membrane row does not see the sink, so stepping the
+    // rows above it is exact.
+    void System::shiftFill(std::vector<double>& state) const
+    {
+        if (m_fill_op.empty()) return;
+
+        const auto& top  = m_compartments.front();
+        const auto  skin = static_cast<std::size_t>(top.geo_to + 1);
+        auto face = state[skin];
+        if (m_compartments.size() > 1 && m_compartments[1].geo_to > top.geo_to + 1)
+        {
+            face = 1.5 * state[skin] - 0.5 * state[skin + 1];
+        }
+
+        std::vector<double> jump(state.size(), 0.0);
+        for (int i = top.geo_from; i <= top.geo_to; ++i)
+        {
+            const auto idx = static_cast<std::size_t>(i);
+            jump[idx] = state[idx] - face;
+        }
+        auto shifted = jump;
+        m_fill_op.step(shifted, 0, m_sink.geo_from - 1);
+        for (int i = 0; i < m_sink.geo_from; ++i)
+        {
+            const auto idx = static_cast<std::size_t>(i);
+            state[idx] += shifted[idx] - jump[idx];
+        }
     }
 
     void System::removeTopCompartment()
@@ -285,57 +500,1119 @@ namespace sc
         m_matrix_builder.buildMatrix(m_compartments, m_geometry, &m_sink);
     }
 
-    System::Result System::run()
+    void System::loadStepMatrices()
     {
-        if (!initRun())
+        const auto& sys = m_parameters.sys;
+        m_step_op     = CnOperator();
+        m_step_rhs    = TDMatrix();
+        m_step_lhs    = TDMatrix();
+        m_step_lhs_ul = TDMatrix();
+        if (sys.packed_operator || sys.mixed_precision)
         {
-            return Result::Failed;
+            m_step_op.build(m_matrix_builder.matrixRhs(), m_matrix_builder.matrixLhs(),
+                            sys.fused_sweeps, sys.mixed_precision);
+        }
+        else
+        {
+            m_step_rhs = m_matrix_builder.matrixRhs();
+            m_step_lhs = m_matrix_builder.matrixLhs();
+            if (sys.fused_sweeps)
+            {
+                m_step_lhs_ul = m_step_lhs;
+                algorithm::prepareThomasUL(m_step_lhs_ul);
+            }
+            algorithm::prepareThomas(m_step_lhs);
         }
+        m_n_ts = m_matrix_builder.timesteps();
+        m_fill_op = CnOperator();
+        if (m_matrix_builder.fillShift() > 0.0)
+        {
+            const auto cn = m_matrix_builder.crankNicolsonMatrices(m_matrix_builder.fillShift());
+            m_fill_op.build(cn.first, cn.second);
+        }
+        initWindow();
+    }
 
-        auto n_ts       = m_matrix_builder.timesteps();
-        auto rhs_matrix = m_matrix_builder.matrixRhs();
-        auto lhs_matrix = m_matrix_builder.matrixLhs();
+    // The clamped rows of an infinite-dose donor are identities and are
+    // skipped exactly. Below the front, a sub-step's lhs solve spreads a
+    // value by at most a factor rho per cell, so `pad` cells beyond the
+    // last significant one keep the truncation below the tolerance. rho
+    // is bounded row by row from the (unprepared) lhs, symmetrised.
+    void System::initWindow()
+    {
+        const auto tol = m_parameters.sys.active_window_tol;
+        m_window_to = -1;
+        if (tol <= 0.0) return;
 
-        bool vehicle_removed    = false;
-        const bool must_replace = m_replace_after != 0;
-        const bool must_remove  = m_remove_at != 0;
+        const auto& donor = m_compartments.front();
+        m_window_from = donor.finite_dose ? 0 : donor.geo_to + 1;
 
-        recordAt(0.0);
+        const auto& lhs = m_matrix_builder.matrixLhs();
+        double rho = 0.0;
+        for (int i = 1; i < lhs.size() - 1; ++i)
+        {
+            const auto d = std::abs(lhs.diag(i));
+            const auto o = std::sqrt(std::abs(lhs.lower(i - 1) * lhs.upper(i)));
+            if (o > 0.0 && d > 2.0 * o)
+            {
+                rho = std::max(rho, (d - std::sqrt(d * d - 4.0 * o * o)) / (2.0 * o));
+            }
+        }
+        const auto pad = rho > 0.0 ? std::ceil(std::log(tol) / std::log(rho)) : 0.0;
+        m_window_pad = static_cast<int>(std::min(pad, static_cast<double>(lhs.size()))) + 2;
+
+        // Mass already in the sink drives the PK cells from the start.
+        if (m_sink.pk && m_concentrations[static_cast<std::size_t>(m_sink.geo_from)] != 0.0)
+        {
+            m_window_to = lhs.size() - 1;
+        }
+    }
+
+    void System::widenWindow(const std::vector<double>& state, double threshold)
+    {
+        const auto last = m_geometry.size() - 1;
+        const auto sink = m_sink.geo_from;
+
+        // Last significant cell, searched down from the current edge.
+        auto front = m_window_from;
+        for (int i = std::min(m_window_to < 0 ? last : m_window_to, sink - 1);
+             i >= m_window_from; --i)
+        {
+            if (std::abs(state[static_cast<std::size_t>(i)]) > threshold)
+            {
+                front = i;
+                break;
+            }
+        }
+        // Once the front reaches the membrane the sink joins the window.
+        auto to = std::min(front + m_window_pad, last);
+        if (to >= sink - 1) to = last;
+        m_window_to = std::max(m_window_to, to);
+    }
+
+    double System::windowThreshold(const std::vector<double>& state) const
+    {
+        if (m_window_to >= m_geometry.size() - 1) return 0.0;
+        double ref = 0.0;
+        for (int i = 0; i < m_sink.geo_from; ++i)
+        {
+            ref = std::max(ref, std::abs(state[static_cast<std::size_t>(i)]));
+        }
+        return m_parameters.sys.active_window_tol * ref;
+    }
+
+    void System::advanceActive(std::vector<double>& state)
+    {
+        const auto last      = m_geometry.size() - 1;
+        const auto threshold = windowThreshold(state);
+        for (int ts = 1; ts <= m_n_ts; ++ts)
+        {
+            if (m_window_to < last) widenWindow(state, threshold);
+            subStep(state, m_window_from, m_window_to);
+        }
+    }
+
+    // The sub-steps of minute t one by one, each followed by a metrics
+    // sample. Stepping is the same as in advanceMinute() / advanceActive(),
+    // so the state is too; fused and mixed-precision sub-steps cannot be
+    // split and are sampled at the end of the minute only.
+    void System::advanceSampled(int t, std::vector<double>& state)
+    {
+        const auto window = m_parameters.sys.active_window_tol > 0.0;
+        if (!window && (m_parameters.sys.fused_sweeps || m_step_op.hasSingle()))
+        {
+            advanceMinute(state);
+            m_metrics.add(metricsSample(static_cast<double>(t), state));
+            return;
+        }
+
+        const auto last      = m_geometry.size() - 1;
+        const auto threshold = window ? windowThreshold(state) : 0.0;
+        for (int ts = 1; ts <= m_n_ts; ++ts)
+        {
+            if (window)
+            {
+                if (m_window_to < last) widenWindow(state, threshold);
+                subStep(state, m_window_from, m_window_to);
+            }
+            else
+            {
+                subStep(state);
+            }
+            m_metrics.add(metricsSample(t - 1 + static_cast<double>(ts) / m_n_ts, state));
+        }
+    }
+
+    MetricsSample System::metricsSample(double t, const std::vector<double>& state) const
+    {
+        MetricsSample s;
+        s.t         = t;
+        s.sink_mass = sinkMassValue(m_sink, m_geometry, state, m_K_per_cell, m_scale);
+        s.conc      = m_sink.pk ? plasmaConcValue(m_sink, m_geometry, state, m_scale)
+                                : s.sink_mass / m_sink.Vd;
+        if (!m_vehicle_removed)
+        {
+            s.donor_mass = integrateMass(m_compartments.front(), m_geometry, state,
+                                         m_K_per_cell, m_scale);
+        }
+        return s;
+    }
+
+    // In mixed precision the minute's sub-steps carry the change x of the
+    // state in floats, driven by the defect of the start state; the state
+    // is only touched in double, once at each end of the minute.
+    void System::subStep(std::vector<double>& state, int from, int to) const
+    {
+        if (m_step_op.empty())
+        {
+            algorithm::crankNicolsonStepIP(m_step_rhs, m_step_lhs, state, from, to);
+        }
+        else
+        {
+            m_step_op.step(state, from, to);
+        }
+    }
+
+    void System::advanceMinute(std::vector<double>& state) const
+    {
+        if (m_step_op.empty())
+        {
+            if (m_parameters.sys.fused_sweeps && state.size() > 1)
+            {
+                algorithm::crankNicolsonStepsIP(m_step_rhs, m_step_lhs, m_step_lhs_ul, state,
+                                                m_n_ts);
+                return;
+            }
+            for (int ts = 1; ts <= m_n_ts; ++ts)
+            {
+                algorithm::crankNicolsonStepIP(m_step_rhs, m_step_lhs, state);
+            }
+            return;
+        }
+        if (!m_step_op.hasSingle())
+        {
+            m_step_op.steps(state, m_n_ts);
+            return;
+        }
+        std::vector<float> s;
+        std::vector<float> x(state.size(), 0.0f);
+        m_step_op.defect(state, s);
+        for (int ts = 1; ts <= m_n_ts; ++ts) m_step_op.stepSingle(x, s);
+        for (std::size_t i = 0; i < state.size(); ++i) state[i] += static_cast<double>(x[i]);
+    }
+
+    void System::applyEvents(int t)
+    {
+        if (m_replace_after != 0 && !m_vehicle_removed && t > 1 && t % m_replace_after == 0)
+        {
+            replaceTopCompartment();
+        }
+
+        if (m_remove_at != 0 && t == m_remove_at)
+        {
+            m_vehicle_removed = true;
+            removeTopCompartment();
+            loadStepMatrices();
+        }
+    }
+
+    int System::nextEventTime(int t) const noexcept
+    {
+        auto next = m_sim_time;
+        if (m_replace_after != 0 && !m_vehicle_removed)
+        {
+            auto k = (t / m_replace_after + 1) * m_replace_after;
+            if (k <= 1) k += m_replace_after;
+            next = std::min(next, k);
+        }
+        if (m_remove_at != 0 && m_remove_at > t)
+        {
+            next = std::min(next, m_remove_at);
+        }
+        return next;
+    }
+
+    bool System::stepSerial(int t_from, int t_to)
+    {
+        // With a log buffer the series are filled on a second thread from
+        // snapshots of the state. It only reads the mesh and compartment
+        // list, so it is drained before anything that changes them or
+        // records on this thread.
+        std::optional<LogPipeline> pipe;
+        if (m_parameters.sys.log_buffer > 0)
+        {
+            pipe.emplace(m_parameters.sys.log_buffer, m_concentrations.size(),
+                         [this](double t, const std::vector<double>& state) {
+                             commitRecord(sampleRecord(t, state));
+                         });
+        }
+
+        std::vector<double> previous;
+        MetricsAccumulator  metrics_before;
+        for (int t = t_from + 1; t <= t_to; ++t)
+        {
+            if (testForStop(t))
+            {
+                return false;
+            }
+            progressCallback(t);
+
+            const auto watch = watchSteadyState();
+            const auto stops = !m_parameters.stop.empty();
+            if (watch || stops) previous = m_concentrations;
+            if (stops && m_metrics.active()) metrics_before = m_metrics;
+
+            if (m_metrics.active())
+            {
+                advanceSampled(t, m_concentrations);
+            }
+            else if (m_parameters.sys.active_window_tol > 0.0)
+            {
+                advanceActive(m_concentrations);
+            }
+            else
+            {
+                advanceMinute(m_concentrations);
+            }
+            if (stops)
+            {
+                double frac = 0.0;
+                if (earliestStop(probeStop(previous), probeStop(m_concentrations), frac) >= 0)
+                {
+                    if (pipe) pipe->drain();
+                    if (m_metrics.active()) m_metrics = metrics_before;
+                    locateStop(t, previous);
+                    return true;
+                }
+            }
+            if (pipe && t == m_remove_at) pipe->drain();
+            const auto event = t < m_sim_time && nextEventTime(t - 1) == t;
+            applyEvents(t);
+            if (event && m_metrics.active())
+            {
+                m_metrics.add(metricsSample(static_cast<double>(t), m_concentrations));
+            }
+            if (!pipe)
+            {
+                recordAt(static_cast<double>(t));
+            }
+            else if (shouldLogAt(t))
+            {
+                pipe->push(static_cast<double>(t), m_concentrations);
+            }
+
+            if (watch && isSteady(previous, m_concentrations))
+            {
+                m_steady_state_at = t;
+                if (pipe) pipe->drain();
+                return fastForward(t, t_to, previous);
+            }
+        }
+        if (pipe) pipe->drain();
+        return true;
+    }
+
+    bool System::watchSteadyState() const noexcept
+    {
+        // Only a clamped (infinite-dose) donor drives the stack to a true
+        // steady state; a pending removal would end it again.
+        return m_parameters.sys.steady_state_tol > 0.0 && m_steady_state_at < 0 &&
+               m_remove_at == 0 && !m_compartments.front().finite_dose;
+    }
+
+    bool System::isSteady(const std::vector<double>& previous,
+                          const std::vector<double>& current) const noexcept
+    {
+        // Relative max-norm change over the skin / donor cells. The sink
+        // cell keeps growing at the steady flux and is left out.
+        double diff = 0.0, scale = 0.0;
+        for (int i = 0; i < m_sink.geo_from; ++i)
+        {
+            const auto idx = static_cast<std::size_t>(i);
+            diff  = std::max(diff, std::abs(current[idx] - previous[idx]));
+            scale = std::max(scale, std::abs(current[idx]));
+        }
+        return scale > 0.0 && diff <= m_parameters.sys.steady_state_tol * scale;
+    }
+
+    // From steady state on, every cell but the sink is constant and the
+    // sink grows by the same amount each minute. Instead of stepping, log
+    // the frozen profile and a linearly extrapolated sink mass for the
+    // rest of the segment. Replace events are no-ops on a clamped donor.
+    bool System::fastForward(int t_ss, int t_to, const std::vector<double>& previous)
+    {
+        const auto sink_idx  = static_cast<std::size_t>(m_sink.geo_from);
+        const auto sink_rate = m_concentrations[sink_idx] - previous[sink_idx];
+
+        auto rec = sampleRecord(static_cast<double>(t_ss), m_concentrations, true);
+        const auto sink_ss   = rec.sink_mass;
+        const auto mass_rate =
+            sink_ss - sinkMassValue(m_sink, m_geometry, previous, m_K_per_cell, m_scale);
+
+        // Stop conditions see the same linear sink growth.
+        const auto probe_ss = probeStop(m_concentrations);
+        const auto mg_rate  = probe_ss.sink_mg - probeStop(previous).sink_mg;
+        auto sample = metricsSample(static_cast<double>(t_ss), m_concentrations);
+
+        for (int t = t_ss + 1; t <= t_to; ++t)
+        {
+            if (testForStop(t))
+            {
+                return false;
+            }
+            progressCallback(t);
+
+            if (!m_parameters.stop.empty())
+            {
+                auto a = probe_ss, b = probe_ss;
+                a.sink_mg += (t - 1 - t_ss) * mg_rate;
+                b.sink_mg += (t - t_ss) * mg_rate;
+                double frac = 0.0;
+                const auto hit = earliestStop(a, b, frac);
+                if (hit >= 0)
+                {
+                    m_concentrations[sink_idx] += (t - 1 - t_ss + frac) * sink_rate;
+                    finishAtStop(t - 1 + frac, hit);
+                    return true;
+                }
+            }
+
+            rec.t         = static_cast<double>(t);
+            rec.sink_mass = sink_ss + (t - t_ss) * mass_rate;
+            commitRecord(rec);
+            if (m_metrics.active())
+            {
+                sample.t         = rec.t;
+                sample.sink_mass = rec.sink_mass;
+                if (!m_sink.pk) sample.conc = sample.sink_mass / m_sink.Vd;
+                m_metrics.add(sample);
+            }
+        }
+
+        m_concentrations[sink_idx] += (t_to - t_ss) * sink_rate;
+        return true;
+    }
 
+    // ---------------------------------------------------------------------
+    // Parareal over the event-free segment (t_from, t_to].
+    //
+    // The segment is cut into K slices with boundaries T_0 < ... < T_K.
+    // F is the CN stepper over a slice, G is backward Euler with steps of
+    // about `parareal_coarse_step` minutes. Iteration k updates
+    //
+    //     U_{n+1}^k = G(U_n^k) + F(U_n^{k-1}) - G(U_n^{k-1})
+    //
+    // with all F evaluations of an iteration running in parallel. After k
+    // iterations the first k slices are exact, so K iterations reproduce
+    // the serial run; in practice the relative max-norm change between
+    // iterates drops below `parareal_tol` after a few. The logged values
+    // of each slice come from its last fine run.
+    // ---------------------------------------------------------------------
+    bool System::runParareal(int t_from, int t_to)
+    {
+        const auto& sys = m_parameters.sys;
+        const auto  len = t_to - t_from;
+        const auto  K   = std::min(sys.parareal_slices, len);
+        if (K < 2)
+        {
+            return stepSerial(t_from, t_to);
+        }
+
+        std::vector<int> bounds(static_cast<std::size_t>(K + 1));
+        for (int n = 0; n <= K; ++n)
+        {
+            bounds[static_cast<std::size_t>(n)] = t_from + static_cast<int>(
+                (static_cast<long long>(len) * n) / K);
+        }
+
+        // Coarse propagator; slices differ in length by at most a minute,
+        // so the prepared BE matrices are cached per slice length.
+        std::map<int, std::pair<TDMatrix, int>> coarse_cache;
+        auto coarse = [&](std::vector<double> state, int slice_len)
+        {
+            auto it = coarse_cache.find(slice_len);
+            if (it == coarse_cache.end())
+            {
+                const auto n_c = std::max(1, static_cast<int>(std::lround(
+                    static_cast<double>(slice_len) / sys.parareal_coarse_step)));
+                auto be = m_matrix_builder.backwardEulerMatrix(
+                    static_cast<double>(slice_len) / n_c);
+                algorithm::prepareThomas(be);
+                it = coarse_cache.emplace(slice_len, std::make_pair(std::move(be), n_c)).first;
+            }
+            for (int c = 0; c < it->second.second; ++c)
+            {
+                algorithm::thomasReUseIP(it->second.first, state);
+            }
+            return state;
+        };
+
+        auto slice_len = [&](int n)
+        {
+            return bounds[static_cast<std::size_t>(n + 1)] - bounds[static_cast<std::size_t>(n)];
+        };
+
+        const auto Ks = static_cast<std::size_t>(K);
+        std::vector<std::vector<double>> U(Ks + 1), G_old(Ks), F(Ks);
+        std::vector<std::vector<LogRecord>> records(Ks);
+
+        U[0] = m_concentrations;
+        for (std::size_t n = 0; n < Ks; ++n)
+        {
+            G_old[n] = coarse(U[n], slice_len(static_cast<int>(n)));
+            U[n + 1] = G_old[n];
+        }
+
+        const auto max_iter = sys.parareal_max_iter > 0 ? std::min(sys.parareal_max_iter, K) : K;
+        int converged = 0;  // U[0..converged] are exact
+        for (int iter = 0; iter < max_iter; ++iter)
+        {
+            if (testForStop(bounds[static_cast<std::size_t>(converged)] + 1))
+            {
+                return false;
+            }
+
+            parallelFor(K - converged, sys.n_threads, [&](int j)
+            {
+                const auto n     = static_cast<std::size_t>(converged + j);
+                const auto t_beg = bounds[n];
+                const auto t_end = bounds[n + 1];
+                F[n] = U[n];
+                records[n].clear();
+                for (int t = t_beg + 1; t <= t_end; ++t)
+                {
+                    advanceMinute(F[n]);
+                    if (t < t_to && shouldLogAt(t))
+                    {
+                        records[n].push_back(sampleRecord(static_cast<double>(t), F[n]));
+                    }
+                }
+            });
+
+            double max_change = 0.0;
+            for (auto n = static_cast<std::size_t>(converged); n < Ks; ++n)
+            {
+                auto g_new = coarse(U[n], slice_len(static_cast<int>(n)));
+                auto& next = U[n + 1];
+                double diff = 0.0, scale = 0.0;
+                for (std::size_t i = 0; i < next.size(); ++i)
+                {
+                    const auto v = F[n][i] + g_new[i] - G_old[n][i];
+                    diff  = std::max(diff, std::abs(v - next[i]));
+                    scale = std::max(scale, std::abs(v));
+                    next[i] = v;
+                }
+                if (scale > 0.0) max_change = std::max(max_change, diff / scale);
+                G_old[n] = std::move(g_new);
+            }
+
+            ++converged;
+            progressCallback(bounds[static_cast<std::size_t>(converged)]);
+            if (max_change <= sys.parareal_tol)
+            {
+                break;
+            }
+        }
+
+        for (const auto& slice : records)
+        {
+            for (const auto& rec : slice) commitRecord(rec);
+        }
+
+        m_concentrations = std::move(F[Ks - 1]);
+        applyEvents(t_to);
+        recordAt(static_cast<double>(t_to));
+        return true;
+    }
+
+    System::StopProbe System::probeStop(const std::vector<double>& state) const
+    {
+        StopProbe p;
+        p.donor_present = !m_vehicle_removed;
+        if (p.donor_present)
+        {
+            p.donor_mg = integrateMass(m_compartments.front(), m_geometry, state,
+                                       m_K_per_cell, 1.0);
+        }
+        p.sink_mg = sinkMassValue(m_sink, m_geometry, state, m_K_per_cell, 1.0);
+        return p;
+    }
+
+    // Signed distance to the threshold, >= 0 once the condition is met.
+    double System::stopMargin(const StopCondition& c, const StopProbe& p) const noexcept
+    {
+        constexpr auto never = -std::numeric_limits<double>::infinity();
+        switch (c.kind)
+        {
+            case StopKind::PermeatedFraction:
+                if (m_donor_mg0 <= 0.0) return never;
+                return (p.sink_mg - m_sink_mg0) / m_donor_mg0 - c.value;
+            case StopKind::DonorFractionBelow:
+                if (!p.donor_present || m_donor_mg0 <= 0.0) return never;
+                return c.value - p.donor_mg / m_donor_mg0;
+            case StopKind::ReceptorConcAbove:
+                return p.sink_mg / m_sink.Vd - c.value;
+        }
+        return never;
+    }
+
+    int System::earliestStop(const StopProbe& a, const StopProbe& b, double& frac) const noexcept
+    {
+        int hit = -1;
+        frac    = 1.0;
+        const auto& stops = m_parameters.stop;
+        for (std::size_t i = 0; i < stops.size(); ++i)
+        {
+            const auto g1 = stopMargin(stops[i], b);
+            if (!(g1 >= 0.0)) continue;
+            const auto g0 = stopMargin(stops[i], a);
+            const auto f  = g0 >= 0.0 ? 0.0 : g0 / (g0 - g1);
+            if (hit < 0 || f < frac)
+            {
+                hit  = static_cast<int>(i);
+                frac = f;
+            }
+        }
+        return hit;
+    }
+
+    // A condition was met somewhere in minute t. Re-step that minute one
+    // CN sub-step at a time from its start state, bracket the crossing to a
+    // single sub-step and place it by linear interpolation (regula falsi on
+    // the bracket) -- the CN state is piecewise linear to that order anyway.
+    void System::locateStop(int t, const std::vector<double>& start)
+    {
+        auto state  = start;
+        auto before = start;
+        auto p0     = probeStop(state);
+        for (int ts = 1; ts <= m_n_ts; ++ts)
+        {
+            before = state;
+            subStep(state);
+            const auto p1 = probeStop(state);
+
+            double frac = 0.0;
+            const auto hit = earliestStop(p0, p1, frac);
+            if (hit >= 0)
+            {
+                for (std::size_t i = 0; i < state.size(); ++i)
+                {
+                    state[i] = before[i] + frac * (state[i] - before[i]);
+                }
+                m_concentrations = std::move(state);
+                finishAtStop(t - 1 + (ts - 1 + frac) / m_n_ts, hit);
+                return;
+            }
+            if (m_metrics.active())
+            {
+                m_metrics.add(metricsSample(t - 1 + static_cast<double>(ts) / m_n_ts, state));
+            }
+            p0 = p1;
+        }
+
+        // Unreachable in exact arithmetic: the full minute crossed, so one
+        // of its sub-steps must have. End at the minute boundary regardless.
+        m_concentrations = std::move(state);
+        double frac = 0.0;
+        finishAtStop(static_cast<double>(t),
+                     std::max(0, earliestStop(probeStop(start), probeStop(m_concentrations), frac)));
+    }
+
+    void System::finishAtStop(double t, int index)
+    {
+        m_stop_time  = t;
+        m_stop_index = index;
+        commitRecord(sampleRecord(t, m_concentrations, true), true);
+        if (m_metrics.active()) m_metrics.add(metricsSample(t, m_concentrations));
+    }
+
+    // With the donor refilled at the start of every period, the skin cells
+    // s after one period are s' = P s + b: P is one period of stepping
+    // from s with an empty donor, b one period from a fresh donor and an
+    // empty skin (the sink never feeds back). The periodic state solves
+    // (I - P) s = b. Each operator call is one period of stepping, and
+    // since P only has a few eigenvalues near 1 -- the slow modes of the
+    // stack -- GMRES needs a handful of them where plain repetition needs
+    // dozens. The start guess is b, i.e. the state after the first
+    // period of an ordinary run.
+    bool System::solvePeriodic()
+    {
+        const auto first  = m_compartments.front().geo_to + 1;
+        const auto last   = m_sink.geo_from - 1;
+        const auto n_skin = static_cast<std::size_t>(std::max(0, last - first + 1));
+        const auto skin0  = static_cast<std::ptrdiff_t>(first);
+
+        int  periods = 0;
+        bool stopped = false;
+        auto period  = [&](std::vector<double>& state) {
+            ++periods;
+            shiftFill(state);
+            for (int t = 1; t <= m_replace_after && !stopped; ++t)
+            {
+                stopped = testForStop(t);
+                advanceMinute(state);
+            }
+        };
+
+        std::vector<double> work = m_concentrations;
+        std::fill(work.begin() + skin0, work.begin() + skin0 + static_cast<std::ptrdiff_t>(n_skin),
+                  0.0);
+        period(work);
+        const std::vector<double> b(work.begin() + skin0,
+                                    work.begin() + skin0 + static_cast<std::ptrdiff_t>(n_skin));
+
+        auto apply = [&](const std::vector<double>& v, std::vector<double>& out) {
+            std::fill(work.begin(), work.end(), 0.0);
+            std::copy(v.begin(), v.end(), work.begin() + skin0);
+            period(work);
+            for (std::size_t i = 0; i < n_skin; ++i)
+            {
+                out[i] = v[i] - work[static_cast<std::size_t>(first) + i];
+            }
+        };
+        auto x = b;
+        const auto res = algorithm::gmres(apply, b, x, m_parameters.sys.periodic_tol, 200);
+        if (stopped) return false;
+        std::copy(x.begin(), x.end(), m_concentrations.begin() + skin0);
+
+        // One more period from the periodic state gives the flux and the
+        // true residual.
+        work = m_concentrations;
+        period(work);
+        if (stopped) return false;
+        double diff = 0.0, scale = 0.0;
+        for (std::size_t i = 0; i < n_skin; ++i)
+        {
+            diff  = std::max(diff, std::abs(work[static_cast<std::size_t>(first) + i] - x[i]));
+            scale = std::max(scale, std::abs(x[i]));
+        }
+        m_periodic_periods  = periods;
+        m_periodic_residual = scale > 0.0 ? diff / scale : res.residual;
+        m_periodic_flux     = sinkMassValue(m_sink, m_geometry, work, m_K_per_cell, m_scale) -
+                              sinkMassValue(m_sink, m_geometry, m_concentrations, m_K_per_cell,
+                                            m_scale);
+        return true;
+    }
+
+    std::vector<double> System::cellWeights() const
+    {
+        // Capacity K_i * A_i * h_i of every cell: the FV operator is
+        // self-adjoint in the inner product these weights define.
+        const auto& ss = m_geometry.spaceSteps();
+        std::vector<double> w(ss.size(), 0.0);
+        for (const auto& comp : m_compartments)
+        {
+            for (int i = comp.geo_from; i <= comp.geo_to; ++i)
+            {
+                const auto idx = static_cast<std::size_t>(i);
+                w[idx] = comp.K * comp.area_um2 * ss[idx];
+            }
+        }
+        return w;
+    }
+
+    bool System::runReduced()
+    {
+        const auto& donor = m_compartments.front();
+        const auto  first = donor.finite_dose ? 0 : donor.geo_to + 1;
+        const auto  last  = m_sink.geo_from - 1;
+        const auto  w     = cellWeights();
+
+        ReducedModel rom;
+        rom.build(m_matrix_builder.matrixOperator(), w, m_concentrations, first, last,
+                  m_parameters.sys.reduced_order, static_cast<double>(m_sim_time));
+        m_reduced_order = rom.order();
+
+        // Compartment masses are linear functionals sum_i scale * w_i * u_i
+        // (see integrateMass); reduce them once so logging a mass costs
+        // O(r). Cells outside the free range (a clamped donor) are constant.
+        std::vector<std::vector<double>> mass_rows(m_compartments.size());
+        std::vector<double>              mass_const(m_compartments.size(), 0.0);
+        for (std::size_t c = 0; c < m_compartments.size(); ++c)
+        {
+            const auto& comp = m_compartments[c];
+            std::vector<double> row(w.size(), 0.0);
+            for (int i = comp.geo_from; i <= comp.geo_to; ++i)
+            {
+                const auto idx = static_cast<std::size_t>(i);
+                if (i < first) mass_const[c] += m_scale * w[idx] * m_concentrations[idx];
+                else           row[idx] = m_scale * w[idx];
+            }
+            mass_rows[c] = rom.project(row);
+        }
+
+        std::vector<double> z;
+        double              sink_value = 0.0;
         for (int t = 1; t <= m_sim_time; ++t)
         {
             if (testForStop(t))
             {
-                return Result::Stopped;
+                return false;
             }
             progressCallback(t);
 
-            for (int ts = 1; ts <= n_ts; ++ts)
+            if (!shouldLogAt(t)) continue;
+
+            const auto td = static_cast<double>(t);
+            rom.modal(td, z, sink_value);
+            m_concentrations[static_cast<std::size_t>(m_sink.geo_from)] = sink_value;
+            for (std::size_t c = 0; c < m_compartments.size(); ++c)
+            {
+                const auto orig = static_cast<std::size_t>(m_active_to_orig[c]);
+                if (m_mass_series[orig].should_log(td))
+                {
+                    double m = mass_const[c];
+                    for (std::size_t k = 0; k < z.size(); ++k) m += mass_rows[c][k] * z[k];
+                    m_mass_series[orig].record(td, m);
+                }
+                if (m_cdp_series[orig].should_log(td))
+                {
+                    const auto& comp = m_compartments[c];
+                    rom.expand(z, comp.geo_from, comp.geo_to, m_concentrations);
+                    m_cdp_series[orig].record(
+                        td, sampleProfile(comp, m_concentrations, m_K_per_cell, m_scale));
+                }
+            }
+            if (m_sink_mass.should_log(td))
             {
-                algorithm::crankNicolsonStepIP(rhs_matrix, lhs_matrix, m_concentrations);
+                m_sink_mass.record(td, sinkMassValue(m_sink, m_geometry, m_concentrations,
+                                                     m_K_per_cell, m_scale));
             }
+        }
+
+        const auto t_end = static_cast<double>(m_sim_time);
+        rom.evaluate(t_end, m_concentrations);
+        const auto err = rom.sinkErrorEstimate(t_end);
+        if (err >= 0.0)
+        {
+            const auto sink_ss = m_geometry.spaceSteps()[static_cast<std::size_t>(m_sink.geo_from)];
+            m_reduced_error    = err * sink_ss * m_sink.area_um2 * m_scale;
+        }
+        return true;
+    }
+
+    bool System::runBrick()
+    {
+        for (int t = 1; t <= m_sim_time; ++t)
+        {
+            if (testForStop(t))
+            {
+                return false;
+            }
+            progressCallback(t);
 
-            if (must_replace && !vehicle_removed && t > 1 && t % m_replace_after == 0)
+            m_brick.advanceMinute(m_concentrations);
+            if (shouldLogAt(t))
             {
-                replaceTopCompartment();
+                m_brick.project(m_concentrations);
+                recordAt(static_cast<double>(t));
             }
+        }
+        m_brick.project(m_concentrations);
+        return true;
+    }
 
-            if (must_remove && t == m_remove_at)
+    bool System::runPathways()
+    {
+        for (int t = 1; t <= m_sim_time; ++t)
+        {
+            if (testForStop(t))
             {
-                vehicle_removed = true;
-                removeTopCompartment();
-                rhs_matrix = m_matrix_builder.matrixRhs();
-                lhs_matrix = m_matrix_builder.matrixLhs();
-                n_ts       = m_matrix_builder.timesteps();
+                return false;
             }
+            progressCallback(t);
 
+            m_pathways.advanceMinute(m_concentrations);
+            applyEvents(t);
             recordAt(static_cast<double>(t));
         }
+        return true;
+    }
+
+    System::Result System::run()
+    {
+        const auto result = runFromStart();
+        syncCdpStores();
+        return result;
+    }
+
+    System::Result System::resume(const Checkpoint& cp)
+    {
+        const auto result = resumeFrom(cp);
+        syncCdpStores();
+        return result;
+    }
+
+    void System::syncCdpStores()
+    {
+        for (auto& cdp : m_cdp_series)
+        {
+            if (cdp.store) cdp.store->sync();
+        }
+    }
+
+    System::Result System::runFromStart()
+    {
+        if (!initRun())
+        {
+            return Result::Failed;
+        }
+
+        loadStepMatrices();
+        m_vehicle_removed = false;
+        m_checkpoint_t    = -1;
+        m_steady_state_at = -1;
+        m_stop_time       = -1.0;
+        m_stop_index      = -1;
+        m_reduced_order   = -1;
+        m_reduced_error   = -1.0;
+        m_periodic_periods  = -1;
+        m_periodic_residual = -1.0;
+        m_periodic_flux     = -1.0;
+
+        // A brick-and-mortar layer takes over its 1-D cells, which from
+        // here on only carry its lateral average for logging.
+        const auto brick = m_brick_layer >= 0;
+        if (brick)
+        {
+            const auto layer = static_cast<std::size_t>(m_brick_layer);
+            if (!m_brick.build(m_parameters.layers[layer - 1].brick, m_compartments, layer,
+                               m_geometry, m_sink, m_matrix_builder.matrixOperator(), m_n_ts,
+                               m_parameters.sys.max_module, m_parameters.sys.n_threads))
+            {
+                return Result::Failed;
+            }
+            m_brick.init(m_concentrations);
+            m_brick.project(m_concentrations);
+        }
+
+        if (m_parameters.sys.periodic_tol > 0.0 && !solvePeriodic())
+        {
+            return Result::Stopped;
+        }
+
+        recordAt(0.0);
+        m_metrics = MetricsAccumulator{};
+        if (m_parameters.metrics.enabled)
+        {
+            m_metrics.start(m_parameters.metrics, m_sim_time,
+                            metricsSample(0.0, m_concentrations));
+        }
+
+        const auto p0 = probeStop(m_concentrations);
+        m_donor_mg0   = p0.donor_mg;
+        m_sink_mg0    = p0.sink_mg;
+        for (std::size_t i = 0; i < m_parameters.stop.size(); ++i)
+        {
+            if (stopMargin(m_parameters.stop[i], p0) >= 0.0)
+            {
+                m_stop_time  = 0.0;
+                m_stop_index = static_cast<int>(i);
+                break;
+            }
+        }
+
+        // The dose goes on with the fill shift of the compact scheme (and
+        // so does the one of each period of a periodic solve).
+        shiftFill(m_concentrations);
+
+        // The reduced-order model replaces time stepping altogether.
+        const auto reduced = m_parameters.sys.reduced_order > 0;
+        if (reduced && !runReduced())
+        {
+            return Result::Stopped;
+        }
+
+        if (brick && !runBrick())
+        {
+            return Result::Stopped;
+        }
+
+        const auto pathways = !m_pathways.empty();
+        if (pathways && !runPathways())
+        {
+            return Result::Stopped;
+        }
+
+        if (!(reduced || brick || pathways) && !stepFrom(0))
+        {
+            return Result::Stopped;
+        }
 
         if (!tearDownRun())
         {
             return Result::Failed;
         }
+        const auto resumable = !(reduced || brick || pathways) &&
+                               m_parameters.sys.periodic_tol <= 0.0 && m_stop_time < 0.0;
+        m_checkpoint_t = resumable ? m_sim_time : -1;
         return Result::Executed;
     }
+
+    bool System::stepFrom(int t)
+    {
+        // Stop conditions are checked minute by minute, which Parareal's
+        // slice-parallel fine runs cannot do -- they force serial stepping.
+        const auto parareal = m_parameters.sys.parareal() && m_parameters.stop.empty();
+        while (t < m_sim_time && m_stop_time < 0.0)
+        {
+            // Parareal works segment by segment between donor events; the
+            // serial path simply runs to the end.
+            const auto t_next = parareal ? nextEventTime(t) : m_sim_time;
+            const auto ok     = parareal ? runParareal(t, t_next) : stepSerial(t, t_next);
+            if (!ok)
+            {
+                return false;
+            }
+            t = t_next;
+        }
+        return true;
+    }
+
+    std::optional<std::string> System::resumeError(const Checkpoint& cp) const
+    {
+        const auto& sys = m_parameters.sys;
+        if (sys.reduced_order > 0 || m_brick_layer >= 0 || !m_pathways.empty() ||
+            sys.periodic_tol > 0.0)
+        {
+            return "resume does not support sys.reduced_order, brick-and-mortar layers, "
+                   "pathways or sys.periodic_tol";
+        }
+        if (m_parameters.metrics.enabled)
+        {
+            return "resume does not support metrics";
+        }
+        if (cp.t < 0 || cp.t >= m_sim_time)
+        {
+            return "checkpoint time not before sys.simulation_time";
+        }
+        if (cp.names != m_compartment_names || cp.mass.size() != m_mass_series.size() ||
+            cp.cdp.size() != m_cdp_series.size())
+        {
+            return "checkpoint of a different compartment list";
+        }
+
+        // The mesh after the checkpoint's events: without the donor's
+        // cells if it was removed.
+        auto steps = m_geometry.spaceSteps();
+        if (cp.vehicle_removed && !m_vehicle_removed)
+        {
+            const auto top = m_compartments.front();
+            steps.erase(steps.begin() + top.geo_from, steps.begin() + top.geo_to + 1);
+        }
+        if (cp.space_steps != steps || cp.state.size() != steps.size())
+        {
+            return "checkpoint of a different mesh";
+        }
+        return std::nullopt;
+    }
+
+    System::Result System::resumeFrom(const Checkpoint& cp)
+    {
+        if (resumeError(cp) || !initRun())
+        {
+            return Result::Failed;
+        }
+
+        m_vehicle_removed = false;
+        if (cp.vehicle_removed)
+        {
+            m_vehicle_removed = true;
+            removeTopCompartment();
+        }
+        loadStepMatrices();
+        m_concentrations  = cp.state;
+        m_steady_state_at = cp.steady_state_at;
+        m_stop_time       = -1.0;
+        m_stop_index      = -1;
+        m_donor_mg0       = cp.donor_mg0;
+        m_sink_mg0        = cp.sink_mg0;
+        m_checkpoint_t    = -1;
+        m_metrics         = MetricsAccumulator{};
+
+        // The series keep this run's settings and take over the values.
+        for (std::size_t i = 0; i < m_mass_series.size(); ++i)
+        {
+            m_mass_series[i].times        = cp.mass[i].times;
+            m_mass_series[i].values       = cp.mass[i].values;
+            auto& cdp = m_cdp_series[i];
+            if (cdp.store)
+            {
+                // The checkpoint may have been logged at a finer interval:
+                // the store is opened afresh with room for its profiles.
+                const auto path = cdp.store->path();
+                cdp.store.reset();
+                cdp.store = std::make_shared<CdpStore>(
+                    path, cdp.depths_um, cp.cdp[i].times.size() + cdpStoreCapacity(cp.t));
+                cdp.times.clear();
+                for (std::size_t k = 0; k < cp.cdp[i].times.size(); ++k)
+                {
+                    cdp.record(cp.cdp[i].times[k], cp.cdp[i].conc_per_time[k]);
+                }
+            }
+            else
+            {
+                cdp.times         = cp.cdp[i].times;
+                cdp.conc_per_time = cp.cdp[i].conc_per_time;
+            }
+        }
+        m_sink_mass.times  = cp.sink_mass.times;
+        m_sink_mass.values = cp.sink_mass.values;
+        m_plasma.times     = cp.plasma.times;
+        m_plasma.values    = cp.plasma.values;
+
+        if (!stepFrom(cp.t))
+        {
+            return Result::Stopped;
+        }
+        if (!tearDownRun())
+        {
+            return Result::Failed;
+        }
+        m_checkpoint_t = m_stop_time < 0.0 ? m_sim_time : -1;
+        return Result::Executed;
+    }
+
+    System::LoggedSeries System::takeSeries()
+    {
+        LoggedSeries out;
+        out.names     = m_compartment_names;
+        out.mass      = std::move(m_mass_series);
+        out.sink_mass = std::move(m_sink_mass);
+        out.cdp       = std::move(m_cdp_series);
+        m_mass_series.clear();
+        m_sink_mass = MassSeries{};
+        m_cdp_series.clear();
+        return out;
+    }
+
+    std::optional<Checkpoint> System::checkpoint() const
+    {
+        if (m_checkpoint_t < 0) return std::nullopt;
+
+        Checkpoint cp;
+        cp.t               = m_checkpoint_t;
+        cp.vehicle_removed = m_vehicle_removed;
+        cp.state           = m_concentrations;
+        cp.space_steps     = m_geometry.spaceSteps();
+        cp.names           = m_compartment_names;
+        cp.mass            = m_mass_series;
+        cp.cdp             = m_cdp_series;
+        // A checkpoint carries its profiles itself.
+        for (auto& cdp : cp.cdp)
+        {
+            if (!cdp.store) continue;
+            for (std::size_t k = 0; k < cdp.times.size(); ++k)
+            {
+                cdp.conc_per_time.push_back(cdp.profile(k));
+            }
+            cdp.store.reset();
+        }
+        cp.sink_mass       = m_sink_mass;
+        cp.plasma          = m_plasma;
+        cp.donor_mg0       = m_donor_mg0;
+        cp.sink_mg0        = m_sink_mg0;
+        cp.steady_state_at = m_steady_state_at;
+        return cp;
+    }
 }
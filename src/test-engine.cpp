@@ -1,11 +1,25 @@
+#include "api.h"
+#include "autoresolution.h"
+#include "batchstore.h"
+#include "cdpstore.h"
 #include "geometry.h"
+#include "matrixbuilder.h"
 #include "parameter.h"
+#include "population.h"
+#include "sensitivity.h"
 #include "system.h"
 
 #include <testthat.h>
 
+#include <algorithm>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 using namespace sc;
@@ -83,6 +97,26 @@ context("Geometry")
         expect_true(g.minSpaceStep() <= 0.26);    // 0.25 with rounding tol
         expect_true(g.maxSpaceStep() >= 0.49);    // 0.5
     }
+
+    test_that("a lumped compartment is one cell and does not set D_min")
+    {
+        Parameters p = trivialParams();
+        std::vector<Compartment> comps;
+        comps.push_back(Compartment{p.vehicle.height, /*D=*/0.01, 1.0,
+                                    p.vehicle.app_area * 1e8, p.vehicle.name});
+        comps.front().lumped = true;
+        comps.push_back(Compartment{p.layers[0].height, p.layers[0].D, p.layers[0].K,
+                                    p.vehicle.app_area * 1e8, p.layers[0].name});
+        Sink s;
+
+        Geometry g;
+        g.create(comps, 1, &s);
+        // 1 vehicle node + 20 SC cells at dx = 1 + 1 sink cell.
+        expect_true(g.size() == 22);
+        expect_true(comps[0].geo_from == 0 && comps[0].geo_to == 0);
+        expect_true(g.spaceSteps()[0] == 30.0);
+        expect_true(g.spaceSteps()[1] == 1.0);
+    }
 }
 
 context("System mass conservation")
@@ -138,6 +172,31 @@ context("System mass conservation")
         }
     }
 
+    test_that("a lumped vehicle conserves mass and matches the well-mixed limit")
+    {
+        Parameters p = trivialParams(240);
+        p.vehicle.height = 300;
+        p.vehicle.D      = 1e6;   // meshed, but effectively well stirred
+        System meshed(p);
+        meshed.run();
+
+        p.vehicle.lumped = true;
+        System lumped(p);
+        expect_true(lumped.run() == System::Result::Executed);
+        const auto& donor = lumped.compartments().front();
+        expect_true(donor.geo_from == donor.geo_to);
+
+        const auto& m  = lumped.compartmentMass();
+        const auto& sm = lumped.sinkMass();
+        const auto total0 = m[0].values.front() + m[1].values.front() + sm.values.front();
+        const auto total1 = m[0].values.back() + m[1].values.back() + sm.values.back();
+        expect_true(std::abs(total1 - total0) <= 1e-10 * total0);
+
+        const auto a = meshed.sinkMass().values.back();
+        const auto b = sm.values.back();
+        expect_true(std::abs(a - b) <= 1e-3 * a);
+    }
+
     test_that("CDP profiles are recorded when enabled")
     {
         Parameters p = trivialParams();
@@ -162,6 +221,1651 @@ context("System mass conservation")
     }
 }
 
+context("Parareal stepping")
+{
+    test_that("parareal reproduces the serial run")
+    {
+        Parameters p = trivialParams(240);
+        p.vehicle.finite_dose = false;
+        System serial(p);
+        serial.run();
+
+        p.sys.parareal_slices      = 6;
+        p.sys.parareal_coarse_step = 10;
+        p.sys.parareal_tol         = 1e-12;
+        p.sys.n_threads            = 3;
+        System par(p);
+        expect_true(par.run() == System::Result::Executed);
+
+        const auto& a = serial.sinkMass();
+        const auto& b = par.sinkMass();
+        expect_true(a.times == b.times);
+        for (std::size_t i = 0; i < a.values.size(); ++i)
+        {
+            expect_true(std::abs(a.values[i] - b.values[i]) <=
+                        1e-9 * std::max(1e-30, std::abs(a.values.back())));
+        }
+    }
+
+    test_that("parareal respects donor events")
+    {
+        Parameters p = trivialParams(180);
+        p.vehicle.replace_after = 50;
+        p.vehicle.remove_at     = 120;
+        System serial(p);
+        serial.run();
+
+        p.sys.parareal_slices      = 4;
+        p.sys.parareal_coarse_step = 15;
+        p.sys.parareal_tol         = 1e-12;
+        System par(p);
+        par.run();
+
+        const auto& a = serial.compartmentMass();
+        const auto& b = par.compartmentMass();
+        expect_true(a.size() == b.size());
+        for (std::size_t c = 0; c < a.size(); ++c)
+        {
+            expect_true(a[c].times == b[c].times);
+            for (std::size_t i = 0; i < a[c].values.size(); ++i)
+            {
+                expect_true(std::abs(a[c].values[i] - b[c].values[i]) <= 1e-9);
+            }
+        }
+    }
+}
+
+context("Steady-state fast-forward")
+{
+    test_that("fast-forward matches the stepped infinite-dose run")
+    {
+        Parameters p = trivialParams(3000);
+        p.vehicle.finite_dose = false;
+        System full(p);
+        full.run();
+        expect_true(full.steadyStateTime() < 0);
+
+        p.sys.steady_state_tol = 1e-9;
+        System fast(p);
+        expect_true(fast.run() == System::Result::Executed);
+        expect_true(fast.steadyStateTime() > 0);
+        expect_true(fast.steadyStateTime() < 3000);
+
+        const auto& a = full.sinkMass();
+        const auto& b = fast.sinkMass();
+        expect_true(a.times == b.times);
+        expect_true(std::abs(a.values.back() - b.values.back()) <=
+                    1e-6 * std::abs(a.values.back()));
+    }
+
+    test_that("the detector is rejected where only serial stepping could honour it")
+    {
+        Parameters p = trivialParams(600);
+        p.vehicle.finite_dose  = false;
+        p.sys.steady_state_tol = 1e-9;
+        expect_false(validate(p).has_value());
+
+        auto q = p;
+        q.sys.parareal_slices = 4;
+        expect_true(validate(q).has_value());
+
+        q = p;
+        q.layers[0].brick.enabled = true;
+        expect_true(validate(q).has_value());
+
+        q = p;
+        PathwayParams shunt;
+        shunt.name = "Follicle";
+        shunt.layers.push_back(p.layers[0]);
+        shunt.layers[0].name = "Follicle SC";
+        q.pathways.push_back(shunt);
+        expect_true(validate(q).has_value());
+    }
+
+    test_that("finite-dose runs are never fast-forwarded")
+    {
+        Parameters p = trivialParams(600);
+        p.sys.steady_state_tol = 1e-3;
+        System sys(p);
+        sys.run();
+        expect_true(sys.steadyStateTime() < 0);
+    }
+}
+
+context("Active window")
+{
+    test_that("windowed stepping matches full sweeps while the front advances")
+    {
+        for (const auto finite : {true, false})
+        {
+            Parameters p = trivialParams(240, 20);
+            p.vehicle.finite_dose = finite;
+            p.vehicle.remove_at   = finite ? 120 : 0;
+            LayerParams deep = p.layers[0];
+            deep.name   = "Dermis";
+            deep.height = 300;
+            deep.D      = 4.0;
+            p.layers.push_back(deep);
+            System full(p);
+            full.run();
+
+            p.sys.active_window_tol = 1e-14;
+            System active(p);
+            expect_true(active.run() == System::Result::Executed);
+            for (std::size_t i = 0; i < full.compartmentMass().size(); ++i)
+            {
+                const auto a = full.compartmentMass()[i].values.back();
+                const auto b = active.compartmentMass()[i].values.back();
+                expect_true(std::abs(a - b) <= 1e-12 * std::abs(a) + 1e-300);
+            }
+        }
+    }
+
+    test_that("the sink joins the window once the front reaches it")
+    {
+        Parameters p = trivialParams(300, 10);
+        p.vehicle.finite_dose = false;
+        System full(p);
+        full.run();
+
+        p.sys.active_window_tol = 1e-14;
+        System active(p);
+        active.run();
+        const auto a = full.sinkMass().values.back();
+        const auto b = active.sinkMass().values.back();
+        expect_true(a > 0.0);
+        expect_true(std::abs(a - b) <= 1e-12 * a);
+    }
+}
+
+context("Fused sweeps")
+{
+    test_that("fused sub-steps match single sweeps")
+    {
+        Parameters p = trivialParams(120, 40);
+        p.sys.resolution = 2;
+        System plain(p);
+        plain.run();
+
+        p.sys.fused_sweeps = true;
+        System fused(p);
+        expect_true(fused.run() == System::Result::Executed);
+        for (std::size_t i = 0; i < plain.compartmentMass().size(); ++i)
+        {
+            const auto a = plain.compartmentMass()[i].values.back();
+            const auto b = fused.compartmentMass()[i].values.back();
+            expect_true(std::abs(a - b) <= 1e-12 * std::abs(a));
+        }
+        const auto a = plain.sinkMass().values.back();
+        expect_true(a > 0.0);
+        expect_true(std::abs(a - fused.sinkMass().values.back()) <= 1e-12 * a);
+    }
+}
+
+context("Packed operator")
+{
+    test_that("the packed operator matches the band kernels in every stepper")
+    {
+        for (int mode = 0; mode < 4; ++mode)
+        {
+            Parameters p = trivialParams(240, 20);
+            p.sys.resolution      = 2;
+            p.vehicle.finite_dose = mode != 1;
+            if (mode == 1) p.sys.active_window_tol = 1e-14;
+            if (mode == 2) p.sys.fused_sweeps      = true;
+            if (mode == 3) p.sys.compact_scheme    = true;
+            System bands(p);
+            bands.run();
+
+            p.sys.packed_operator = true;
+            System packed(p);
+            expect_true(packed.run() == System::Result::Executed);
+            const auto a = bands.sinkMass().values.back();
+            expect_true(a > 0.0 && std::abs(a - packed.sinkMass().values.back()) <= 1e-12 * a);
+        }
+    }
+}
+
+context("Mixed precision")
+{
+    test_that("single-precision sub-steps match double and conserve mass")
+    {
+        Parameters p = trivialParams(240, 20);
+        p.sys.resolution = 2;
+        LayerParams deep = p.layers[0];
+        deep.name   = "Dermis";
+        deep.height = 200;
+        deep.D      = 5.0;
+        deep.K      = 0.5;
+        p.layers.push_back(deep);
+        System full(p);
+        full.run();
+
+        p.sys.mixed_precision = true;
+        System mixed(p);
+        expect_true(mixed.run() == System::Result::Executed);
+        double total = mixed.sinkMass().values.back();
+        for (std::size_t i = 0; i < full.compartmentMass().size(); ++i)
+        {
+            const auto a = full.compartmentMass()[i].values.back();
+            const auto b = mixed.compartmentMass()[i].values.back();
+            expect_true(std::abs(a - b) <= 1e-6 * std::abs(a));
+            total += b;
+        }
+        const auto a = full.sinkMass().values.back();
+        expect_true(std::abs(a - mixed.sinkMass().values.back()) <= 1e-5 * a);
+
+        const auto m0 = mixed.compartmentMass().front().values.front();
+        expect_true(std::abs(total - m0) <= 1e-8 * m0);
+    }
+}
+
+context("Compact scheme")
+{
+    test_that("a uniform mesh gets the (1, 10, 1) / 12 mass rows")
+    {
+        Parameters p = trivialParams();
+        std::vector<Compartment> comps;
+        comps.push_back(Compartment{p.vehicle.height, p.vehicle.D, 1.0,
+                                    p.vehicle.app_area * 1e8, p.vehicle.name});
+        comps.push_back(Compartment{p.layers[0].height, p.layers[0].D, p.layers[0].K,
+                                    p.vehicle.app_area * 1e8, p.layers[0].name});
+        Sink s;
+        s.area_um2 = p.vehicle.app_area * 1e8;
+        s.Vd       = 1.0;
+        Geometry g;
+        g.create(comps, 1, &s);
+
+        MatrixBuilder mb;
+        mb.setCompact(true);
+        expect_true(mb.buildMatrix(comps, g, &s));
+        const auto& m = mb.matrixMass();
+        for (int i : {10, 29, 30, 40})
+        {
+            expect_true(std::abs(m.diag(i) - 10.0 / 12.0) < 1e-14);
+            expect_true(std::abs(m.lower(i - 1) - 1.0 / 12.0) < 1e-14);
+            expect_true(std::abs(m.upper(i) - 1.0 / 12.0) < 1e-14);
+        }
+        expect_true(mb.fillShift() > 0.0);
+    }
+
+    test_that("a coarse compact mesh beats the standard one by orders of magnitude")
+    {
+        auto sink = [](int resolution, bool compact) {
+            Parameters p = trivialParams(120, 20);
+            LayerParams deep = p.layers[0];
+            deep.name   = "Dermis";
+            deep.height = 40;
+            deep.D      = 0.5;
+            deep.K      = 2.0;
+            p.layers.push_back(deep);
+            p.sys.resolution     = resolution;
+            p.sys.max_module     = 0.02 * resolution * resolution;
+            p.sys.compact_scheme = compact;
+            System sys(p);
+            sys.run();
+            double total = sys.sinkMass().values.back();
+            for (const auto& m : sys.compartmentMass()) total += m.values.back();
+            const auto m0 = sys.compartmentMass().front().values.front();
+            expect_true(std::abs(total - m0) <= 1e-11 * m0);
+            return sys.sinkMass().values.back();
+        };
+        const auto ref      = sink(8, true);
+        const auto standard = sink(1, false);
+        const auto compact  = sink(1, true);
+        expect_true(std::abs(compact - ref) <= 1e-2 * std::abs(standard - ref));
+    }
+
+    test_that("unsupported combinations are rejected")
+    {
+        Parameters p = trivialParams();
+        p.sys.compact_scheme = true;
+        expect_false(validate(p).has_value());
+        p.sys.fused_sweeps = true;
+        expect_true(validate(p).has_value());
+        p.sys.fused_sweeps  = false;
+        p.sys.reduced_order = 10;
+        expect_true(validate(p).has_value());
+    }
+}
+
+context("Automatic resolution")
+{
+    test_that("the chosen mesh meets the tolerance it predicts")
+    {
+        Parameters p = trivialParams(240, 20);
+        p.layers[0].D = 0.1;
+        p.layers[0].K = 2.0;
+        LayerParams deep = p.layers[0];
+        deep.name   = "Dermis";
+        deep.height = 100;
+        deep.D      = 5.0;
+        deep.K      = 0.5;
+        p.layers.push_back(deep);
+
+        Parameters fine = p;
+        fine.sys.resolution     = 8;
+        fine.sys.max_module     = 0.5;
+        fine.sys.compact_scheme = true;
+        System ref(fine);
+        ref.run();
+        const auto exact = ref.sinkMass().values.back();
+
+        p.sys.auto_resolution_tol = 1e-3;
+        const auto loose = chooseResolution(p);
+        expect_true(loose.resolution > 1);
+        expect_true(loose.sink_error <= 1e-3 && loose.cdp_error <= 1e-3);
+
+        p.sys.resolution = loose.resolution;
+        p.sys.max_module = loose.max_module;
+        System sys(p);
+        expect_true(sys.run() == System::Result::Executed);
+        const auto err = std::abs(sys.sinkMass().values.back() - exact) / exact;
+        expect_true(err <= 2e-3);
+
+        p.sys.resolution = 1;
+        p.sys.max_module = 50.0;
+        p.sys.auto_resolution_tol = 1e-4;
+        expect_true(chooseResolution(p).resolution > loose.resolution);
+    }
+
+    test_that("unsupported combinations are rejected")
+    {
+        Parameters p = trivialParams();
+        p.sys.auto_resolution_tol = 1e-3;
+        expect_false(validate(p).has_value());
+        p.sys.reduced_order = 10;
+        expect_true(validate(p).has_value());
+        p.sys.reduced_order = 0;
+        p.sys.auto_resolution_tol = 1.0;
+        expect_true(validate(p).has_value());
+    }
+}
+
+context("Checkpoint and resume")
+{
+    test_that("a resumed run reproduces the straight run, events included")
+    {
+        Parameters p = trivialParams(240, 20);
+        p.vehicle.replace_after = 60;
+        p.layers[0].log_cdp     = true;
+        System straight(p);
+        straight.run();
+
+        Parameters prefix = p;
+        prefix.sys.simulation_time = 100;
+        System first(prefix);
+        expect_true(first.run() == System::Result::Executed);
+        const auto cp = first.checkpoint();
+        expect_true(cp.has_value() && cp->t == 100);
+
+        System rest(p);
+        expect_false(rest.resumeError(*cp).has_value());
+        expect_true(rest.resume(*cp) == System::Result::Executed);
+        expect_true(rest.sinkMass().values == straight.sinkMass().values);
+        expect_true(rest.sinkMass().times == straight.sinkMass().times);
+        expect_true(rest.cdp()[1].conc_per_time == straight.cdp()[1].conc_per_time);
+        expect_true(rest.checkpoint().has_value());
+    }
+
+    test_that("one prefix forks into continuations with different removals")
+    {
+        Parameters p = trivialParams(240, 20);
+        Parameters prefix = p;
+        prefix.sys.simulation_time = 90;
+        System first(prefix);
+        first.run();
+        const auto cp = *first.checkpoint();
+
+        for (int remove_at : {0, 150, 200})
+        {
+            Parameters q = p;
+            q.vehicle.remove_at = remove_at;
+            System straight(q);
+            straight.run();
+            System fork(q);
+            expect_true(fork.resume(cp) == System::Result::Executed);
+            expect_true(fork.sinkMass().values == straight.sinkMass().values);
+            expect_true(fork.compartmentMass()[0].values ==
+                        straight.compartmentMass()[0].values);
+        }
+
+        // A checkpoint past the removal carries it.
+        p.vehicle.remove_at = 60;
+        System straight(p);
+        straight.run();
+        prefix.vehicle.remove_at = 60;
+        System removed(prefix);
+        removed.run();
+        p.vehicle.remove_at = 0;
+        System fork(p);
+        expect_true(fork.resume(*removed.checkpoint()) == System::Result::Executed);
+        expect_true(fork.sinkMass().values == straight.sinkMass().values);
+    }
+
+    test_that("checkpoints round-trip through the binary form")
+    {
+        Parameters p = trivialParams(120, 20);
+        Parameters prefix = p;
+        prefix.sys.simulation_time = 50;
+        System first(prefix);
+        first.run();
+        const auto cp = *first.checkpoint();
+
+        std::stringstream buf;
+        writeCheckpoint(buf, cp);
+        const auto bytes = buf.str();
+        const auto back  = readCheckpoint(buf);
+        expect_true(back.has_value());
+        expect_true(back->state == cp.state && back->names == cp.names);
+        expect_true(back->mass[0].values == cp.mass[0].values);
+
+        System a(p), b(p);
+        a.resume(cp);
+        b.resume(*back);
+        expect_true(a.sinkMass().values == b.sinkMass().values);
+
+        std::stringstream cut(bytes.substr(0, bytes.size() - 3));
+        expect_false(readCheckpoint(cut).has_value());
+        std::stringstream junk("not a checkpoint");
+        expect_false(readCheckpoint(junk).has_value());
+    }
+
+    test_that("mismatched checkpoints are refused")
+    {
+        Parameters p = trivialParams(120, 20);
+        System first(p);
+        first.run();
+        const auto cp = *first.checkpoint();
+
+        System same_end(p);
+        expect_true(same_end.resumeError(cp).has_value());
+        expect_true(same_end.resume(cp) == System::Result::Failed);
+
+        p.sys.simulation_time = 200;
+        p.sys.resolution      = 2;
+        System finer(p);
+        expect_true(finer.resumeError(cp).has_value());
+
+        p.sys.resolution   = 1;
+        p.stop.push_back(StopCondition{StopKind::DonorFractionBelow, 0.99});
+        System stopped(p);
+        stopped.run();
+        expect_false(stopped.checkpoint().has_value());
+    }
+}
+
+context("Pipelined logging")
+{
+    // Every series of `b` equals that of `a` bit for bit.
+    auto sameSeries = [](const System& a, const System& b) {
+        bool same = a.sinkMass().times == b.sinkMass().times &&
+                    a.sinkMass().values == b.sinkMass().values &&
+                    a.plasma().values == b.plasma().values;
+        for (std::size_t i = 0; i < a.compartmentMass().size(); ++i)
+        {
+            same = same && a.compartmentMass()[i].times == b.compartmentMass()[i].times &&
+                   a.compartmentMass()[i].values == b.compartmentMass()[i].values &&
+                   a.cdp()[i].times == b.cdp()[i].times &&
+                   a.cdp()[i].conc_per_time == b.cdp()[i].conc_per_time;
+        }
+        return same;
+    };
+
+    test_that("the logging thread reproduces the series exactly")
+    {
+        Parameters p = trivialParams(240, 20);
+        p.vehicle.replace_after = 50;
+        p.vehicle.remove_at     = 170;
+        p.layers[0].log_cdp     = true;
+        p.log.cdp_log_interval  = 7;
+        System plain(p);
+        plain.run();
+
+        for (int slots : {1, 4})
+        {
+            p.sys.log_buffer = slots;
+            System piped(p);
+            expect_true(piped.run() == System::Result::Executed);
+            expect_true(sameSeries(plain, piped));
+        }
+    }
+
+    test_that("stop conditions and fast-forward drain the pipeline first")
+    {
+        Parameters p = trivialParams(600);
+        p.stop.push_back(StopCondition{StopKind::PermeatedFraction, 0.2});
+        System plain(p);
+        plain.run();
+        p.sys.log_buffer = 2;
+        System piped(p);
+        piped.run();
+        expect_true(piped.stopTime() == plain.stopTime());
+        expect_true(sameSeries(plain, piped));
+
+        Parameters q = trivialParams(3000);
+        q.vehicle.finite_dose  = false;
+        q.sys.steady_state_tol = 1e-9;
+        System steady(q);
+        steady.run();
+        q.sys.log_buffer = 3;
+        System fast(q);
+        fast.run();
+        expect_true(fast.steadyStateTime() == steady.steadyStateTime());
+        expect_true(sameSeries(steady, fast));
+    }
+
+    test_that("a negative log buffer is rejected")
+    {
+        Parameters p = trivialParams();
+        p.sys.log_buffer = -1;
+        expect_true(validate(p).has_value());
+    }
+
+    test_that("runs that do not step serially reject a log buffer")
+    {
+        Parameters p = trivialParams(600);
+        p.sys.log_buffer = 2;
+        expect_false(validate(p).has_value());
+
+        auto q = p;
+        q.sys.parareal_slices = 4;
+        expect_true(validate(q).has_value());
+
+        q = p;
+        q.sys.reduced_order = 12;
+        expect_true(validate(q).has_value());
+
+        q = p;
+        q.layers[0].brick.enabled = true;
+        expect_true(validate(q).has_value());
+
+        q = p;
+        PathwayParams shunt;
+        shunt.name = "Follicle";
+        shunt.layers.push_back(p.layers[0]);
+        shunt.layers[0].name = "Follicle SC";
+        q.pathways.push_back(shunt);
+        expect_true(validate(q).has_value());
+    }
+}
+
+context("Series interpolation")
+{
+    test_that("mass series interpolate linearly and hold their end values")
+    {
+        MassSeries s;
+        s.record(0.0, 0.0);
+        s.record(10.0, 5.0);
+        s.record(20.0, 20.0);
+        expect_true(s.at(-3.0) == 0.0 && s.at(0.0) == 0.0);
+        expect_true(s.at(5.0) == 2.5 && s.at(10.0) == 5.0 && s.at(15.0) == 12.5);
+        expect_true(s.at(20.0) == 20.0 && s.at(90.0) == 20.0);
+        expect_true(std::isnan(s.at(std::nan(""))));
+        expect_true(std::isnan(MassSeries{}.at(1.0)));
+    }
+
+    test_that("profiles interpolate per depth between the logged times")
+    {
+        Parameters p = trivialParams(120, 20);
+        p.layers[0].log_cdp    = true;
+        p.log.cdp_log_interval = 10;
+        System sys(p);
+        sys.run();
+        const auto& s = sys.cdp()[1];
+        expect_true(s.profileAt(s.times[3]) == s.conc_per_time[3]);
+        expect_true(s.profileAt(-5.0) == s.conc_per_time.front());
+        expect_true(s.profileAt(1e6) == s.conc_per_time.back());
+
+        const auto mid = s.profileAt(0.5 * (s.times[3] + s.times[4]));
+        bool halfway = mid.size() == s.depths_um.size();
+        for (std::size_t d = 0; halfway && d < mid.size(); ++d)
+        {
+            const auto a = s.conc_per_time[3][d], b = s.conc_per_time[4][d];
+            halfway = std::abs(mid[d] - 0.5 * (a + b)) <= 1e-12 * (1.0 + std::abs(a + b));
+        }
+        expect_true(halfway);
+    }
+
+    test_that("the series move out of a finished run intact")
+    {
+        Parameters p = trivialParams(120, 20);
+        p.layers[0].log_cdp = true;
+        System sys(p);
+        sys.run();
+        const auto mass = sys.compartmentMass();
+        const auto sink = sys.sinkMass().values;
+        const auto cdp  = sys.cdp()[1].conc_per_time;
+
+        const auto logged = sys.takeSeries();
+        expect_true(logged.names == sys.compartmentNames());
+        expect_true(logged.mass.size() == mass.size() && logged.mass[1].values == mass[1].values);
+        expect_true(logged.sink_mass.values == sink && logged.cdp[1].conc_per_time == cdp);
+        expect_true(sys.compartmentMass().empty() && sys.cdp().empty() &&
+                    sys.sinkMass().values.empty());
+    }
+}
+
+context("On-disk CDP store")
+{
+    namespace fs = std::filesystem;
+    const auto dir = fs::temp_directory_path() / "skindiff-test-cdp-store";
+
+    // Every profile of `stored` equals the in-memory one of `plain`, read
+    // back through the store and through a mapping of its file.
+    auto sameProfiles = [](const System& plain, const System& stored) {
+        bool same = true;
+        for (std::size_t i = 0; i < plain.cdp().size(); ++i)
+        {
+            const auto& a = plain.cdp()[i];
+            const auto& b = stored.cdp()[i];
+            same = same && a.times == b.times && b.conc_per_time.empty();
+            if (!a.enabled || !same) continue;
+            const auto map = CdpMapping::open(b.store->path());
+            same = same && map && map->times() == a.times.size() &&
+                   map->depths() == a.depths_um.size() &&
+                   std::equal(a.depths_um.begin(), a.depths_um.end(), map->depth()) &&
+                   std::equal(a.times.begin(), a.times.end(), map->time());
+            for (std::size_t k = 0; same && k < a.times.size(); ++k)
+            {
+                same = b.profile(k) == a.conc_per_time[k] &&
+                       std::equal(a.conc_per_time[k].begin(), a.conc_per_time[k].end(),
+                                  map->data() + k * a.depths_um.size());
+            }
+        }
+        return same;
+    };
+
+    test_that("stored profiles equal the in-memory series, pipelined or not")
+    {
+        fs::create_directories(dir);
+        Parameters p = trivialParams(240, 20);
+        p.vehicle.remove_at    = 170;
+        p.vehicle.log_cdp      = true;
+        p.layers[0].log_cdp    = true;
+        p.log.cdp_log_interval = 7;
+        System plain(p);
+        plain.run();
+
+        p.log.cdp_dir = dir.string();
+        for (int slots : {0, 3})
+        {
+            p.sys.log_buffer = slots;
+            System stored(p);
+            expect_true(stored.run() == System::Result::Executed);
+            expect_true(sameProfiles(plain, stored));
+        }
+
+        // A stop crossing adds an off-interval profile.
+        Parameters q = trivialParams(600);
+        q.layers[0].log_cdp = true;
+        q.stop.push_back(StopCondition{StopKind::PermeatedFraction, 0.2});
+        System stopped(q);
+        stopped.run();
+        q.log.cdp_dir = dir.string();
+        System stopped_stored(q);
+        stopped_stored.run();
+        expect_true(sameProfiles(stopped, stopped_stored));
+        fs::remove_all(dir);
+    }
+
+    test_that("checkpoints carry stored profiles and resume into a store")
+    {
+        fs::create_directories(dir);
+        Parameters p = trivialParams(240, 20);
+        p.layers[0].log_cdp = true;
+        System straight(p);
+        straight.run();
+
+        Parameters prefix = p;
+        prefix.sys.simulation_time = 100;
+        prefix.log.cdp_dir         = (dir / "prefix").string();
+        fs::create_directories(prefix.log.cdp_dir);
+        System first(prefix);
+        first.run();
+        const auto cp = first.checkpoint();
+        expect_true(cp.has_value() && !cp->cdp[1].store &&
+                    cp->cdp[1].conc_per_time.size() == cp->cdp[1].times.size());
+
+        p.log.cdp_dir = dir.string();
+        System rest(p);
+        expect_true(rest.resume(*cp) == System::Result::Executed);
+        expect_true(sameProfiles(straight, rest));
+        fs::remove_all(dir);
+    }
+
+    test_that("a resume at a coarser interval makes room for the finer profiles")
+    {
+        fs::create_directories(dir);
+        Parameters prefix = trivialParams(100, 20);
+        prefix.layers[0].log_cdp    = true;
+        prefix.log.cdp_log_interval = 1;
+        System first(prefix);
+        first.run();
+        const auto cp = first.checkpoint();
+
+        Parameters p = trivialParams(600, 20);
+        p.layers[0].log_cdp    = true;
+        p.log.cdp_log_interval = 60;
+        System in_memory(p);
+        expect_true(in_memory.resume(*cp) == System::Result::Executed);
+
+        p.log.cdp_dir = dir.string();
+        System stored(p);
+        expect_true(stored.resume(*cp) == System::Result::Executed);
+        expect_true(stored.cdp()[1].times.size() == 101 + 9);
+        expect_true(sameProfiles(in_memory, stored));
+        fs::remove_all(dir);
+    }
+
+    test_that("a mapping sees the profiles synced so far")
+    {
+        fs::create_directories(dir);
+        const auto path = (dir / "synced.cdp").string();
+        {
+            CdpStore store(path, {0.0, 1.0}, 4);
+            store.append(0.0, {1.0, 2.0});
+            store.append(1.0, {3.0, 4.0});
+            expect_true(CdpMapping::open(path)->times() == 0);
+            store.sync();
+            expect_true(CdpMapping::open(path)->times() == 2);
+            store.append(2.0, {5.0, 6.0});
+        }
+        const auto map = CdpMapping::open(path);
+        expect_true(map->times() == 3 && map->data()[5] == 6.0);
+        fs::remove_all(dir);
+    }
+
+    test_that("a missing directory throws and other files do not map")
+    {
+        Parameters p = trivialParams();
+        p.layers[0].log_cdp = true;
+        p.log.cdp_dir = (dir / "missing").string();
+        bool threw = false;
+        try
+        {
+            System sys(p);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        expect_true(threw);
+
+        fs::create_directories(dir);
+        const auto other = (dir / "other.cdp").string();
+        std::ofstream(other) << "not a profile store, but long enough to hold a header";
+        expect_true(CdpMapping::open(other) == nullptr);
+        expect_true(CdpMapping::open((dir / "missing.cdp").string()) == nullptr);
+        fs::remove_all(dir);
+    }
+}
+
+context("Columnar batch files")
+{
+    namespace fs = std::filesystem;
+    const auto path = (fs::temp_directory_path() / "skindiff-test-batch.bin").string();
+    const std::vector<BatchColumn> columns = {
+        {"scenario", BatchColumn::Kind::Int},
+        {"D", BatchColumn::Kind::Double},
+        {"mass", BatchColumn::Kind::Series}};
+
+    // Scenario k has D = k / 2 and k + 1 mass values 10 k, 10 k + 1, ...
+    auto rowOf = [](int k) {
+        BatchRow row;
+        row.ints    = {k};
+        row.doubles = {0.5 * k};
+        std::vector<double> mass;
+        for (int j = 0; j <= k; ++j) mass.push_back(10.0 * k + j);
+        row.series = {mass};
+        return row;
+    };
+
+    test_that("rows written over several chunks read back in any subset")
+    {
+        {
+            BatchWriter writer(path, columns, 3);
+            for (int k = 0; k < 8; ++k) writer.add(rowOf(k));
+            expect_true(writer.rows() == 8);
+        }   // the destructor closes it
+
+        auto reader = BatchReader::open(path);
+        expect_true(reader != nullptr);
+        expect_true(reader->rows() == 8 && reader->columns().size() == 3);
+        expect_true(reader->find("mass") == 2 && reader->find("nope") == -1);
+
+        const std::vector<std::size_t> rows = {7, 0, 4, 5};
+        const auto ids  = reader->ints(0, rows);
+        const auto d    = reader->doubles(1, rows);
+        const auto mass = reader->series(2, rows);
+        bool same = true;
+        for (std::size_t j = 0; j < rows.size(); ++j)
+        {
+            const auto expected = rowOf(static_cast<int>(rows[j]));
+            same = same && ids[j] == expected.ints[0] && d[j] == expected.doubles[0] &&
+                   mass[j] == expected.series[0];
+        }
+        expect_true(same);
+        expect_true(reader->series(2, {}).empty());
+    }
+
+    test_that("mismatched rows, wrong kinds and unfinished files are refused")
+    {
+        bool threw = false;
+        {
+            BatchWriter writer(path, columns, 4);
+            try
+            {
+                writer.add(BatchRow{});
+            }
+            catch (const std::invalid_argument&)
+            {
+                threw = true;
+            }
+            writer.add(rowOf(1));
+        }
+        expect_true(threw);
+
+        auto reader = BatchReader::open(path);
+        expect_true(reader != nullptr && reader->rows() == 1);
+        threw = false;
+        try
+        {
+            (void)reader->doubles(0, {0});
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        expect_true(threw);
+
+        // Cut before the chunk index: the header never got its offset.
+        const auto size = fs::file_size(path);
+        fs::resize_file(path, size / 2);
+        std::ofstream(path, std::ios::binary | std::ios::in | std::ios::out).seekp(16)
+            .write("\0\0\0\0\0\0\0\0", 8);
+        expect_true(BatchReader::open(path) == nullptr);
+        fs::remove(path);
+        expect_true(BatchReader::open(path) == nullptr);
+    }
+}
+
+context("Streaming metrics")
+{
+    // Least-squares slope of a logged series over [from, to].
+    auto slope = [](const MassSeries& s, double from, double to) {
+        double n = 0, st = 0, sq = 0, stt = 0, stq = 0;
+        for (std::size_t i = 0; i < s.times.size(); ++i)
+        {
+            const auto t = s.times[i];
+            if (t < from || t > to) continue;
+            n += 1; st += t; sq += s.values[i]; stt += t * t; stq += t * s.values[i];
+        }
+        return (n * stq - st * sq) / (n * stt - st * st);
+    };
+
+    test_that("metrics agree with the logged series and leave the run unchanged")
+    {
+        Parameters p = trivialParams(1500, 20);
+        p.layers[0].D     = 0.5;
+        p.sink.pk.enabled = true;
+        p.sink.pk.V1      = 50.0;
+        p.sink.pk.CL      = 0.5;
+        System plain(p);
+        plain.run();
+
+        p.metrics.enabled   = true;
+        p.metrics.permeated = {0.1, 0.5, 2.0};
+        System sys(p);
+        expect_true(sys.run() == System::Result::Executed);
+        expect_true(sys.sinkMass().values == plain.sinkMass().values);
+
+        const auto m    = sys.metrics();
+        const auto& q   = plain.sinkMass();
+        const auto dose = plain.compartmentMass()[0].values.front();
+        expect_true(m.samples == 1 + 1500 * sys.matrixBuilder().timesteps());
+        expect_true(m.q_total == q.values.back());
+        expect_true(std::abs(m.j_ss - slope(q, 1050.0, 1500.0)) <= 1e-3 * m.j_ss);
+        expect_true(m.r2_ss > 0.9 && m.r2_ss <= 1.0);
+
+        // The crossing lies in the logged minute that brackets it.
+        const auto k = static_cast<std::size_t>(std::ceil(m.t_permeated[0]));
+        expect_true(q.values[k - 1] < 0.1 * dose && q.values[k] >= 0.1 * dose);
+        expect_true(std::isnan(m.t_permeated[2]));
+
+        // Plasma peak and AUC against the per-minute log.
+        const auto& c = plain.plasma();
+        const auto peak = std::max_element(c.values.begin(), c.values.end());
+        double auc = 0.0;
+        for (std::size_t i = 1; i < c.values.size(); ++i)
+        {
+            auc += 0.5 * (c.values[i - 1] + c.values[i]) * (c.times[i] - c.times[i - 1]);
+        }
+        expect_true(m.c_max >= *peak);
+        expect_true(std::abs(m.t_max - c.times[static_cast<std::size_t>(peak - c.values.begin())]) <= 1.0);
+        expect_true(std::abs(m.auc - auc) <= 1e-4 * auc);
+        expect_true(m.t_donor_half > 0.0 && m.depletion > 0.5 && m.depletion < 1.0);
+    }
+
+    test_that("sampling sub-steps leaves every stepper's result unchanged")
+    {
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            Parameters p = trivialParams(240, 20);
+            p.vehicle.finite_dose = mode != 0;
+            if (mode == 0) p.sys.active_window_tol = 1e-14;
+            if (mode == 1) p.sys.compact_scheme    = true;
+            if (mode == 2) p.sys.fused_sweeps      = true;
+            System plain(p);
+            plain.run();
+            p.metrics.enabled = true;
+            System sampled(p);
+            sampled.run();
+            expect_true(sampled.sinkMass().values == plain.sinkMass().values);
+            expect_true(sampled.metrics().q_total == plain.sinkMass().values.back());
+        }
+    }
+
+    test_that("a run without logging still reports its metrics")
+    {
+        Parameters p = trivialParams(600);
+        p.metrics.enabled     = true;
+        p.metrics.permeated   = {0.2};
+        p.vehicle.replace_after = 200;
+        System logged(p);
+        logged.run();
+        p.log.enabled = false;
+        System quiet(p);
+        expect_true(quiet.run() == System::Result::Executed);
+        expect_true(quiet.sinkMass().values.empty());
+        expect_true(quiet.compartmentMass()[0].values.empty());
+        const auto a = logged.metrics(), b = quiet.metrics();
+        expect_true(a.q_total == b.q_total && a.j_ss == b.j_ss && a.auc == b.auc);
+        expect_true(a.t_permeated == b.t_permeated);
+    }
+
+    test_that("a stop condition ends the metrics at the crossing")
+    {
+        Parameters p = trivialParams(600);
+        p.stop.push_back(StopCondition{StopKind::PermeatedFraction, 0.2});
+        p.metrics.enabled   = true;
+        p.metrics.permeated = {0.2};
+        System sys(p);
+        sys.run();
+        const auto m = sys.metrics();
+        expect_true(m.q_total == sys.sinkMass().values.back());
+        expect_true(std::abs(m.t_permeated[0] - sys.stopTime()) <= 1e-6);
+
+        Parameters q = trivialParams(3000);
+        q.vehicle.finite_dose  = false;
+        q.sys.steady_state_tol = 1e-9;
+        q.metrics.enabled      = true;
+        System fast(q);
+        fast.run();
+        expect_true(fast.metrics().q_total == fast.sinkMass().values.back());
+        expect_true(std::isnan(fast.metrics().t_donor_half));
+    }
+
+    test_that("metrics need a single serial stepper and a valid window")
+    {
+        Parameters p = trivialParams();
+        p.metrics.enabled = true;
+        expect_false(validate(p).has_value());
+        p.metrics.ss_from = 1.0;
+        expect_true(validate(p).has_value());
+        p.metrics.ss_from = 0.5;
+        p.sys.parareal_slices = 4;
+        expect_true(validate(p).has_value());
+    }
+}
+
+context("Sensitivity analysis")
+{
+    auto rejects = [](auto&& f) {
+        try
+        {
+            f();
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    test_that("the Sobol' sequence matches the reference points and stratifies")
+    {
+        SobolSequence seq(2);
+        const std::vector<double> x = {0, .5, .75, .25, .375, .875, .625, .125};
+        const std::vector<double> y = {0, .5, .25, .75, .375, .875, .125, .625};
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            const auto pt = seq.point(i);
+            expect_true(pt[0] == x[i] && pt[1] == y[i]);
+        }
+
+        // Each of the first 4^k points sits in its own 2^-k x 2^-k cell.
+        std::vector<int> cells(16, 0);
+        for (std::uint64_t i = 0; i < 16; ++i)
+        {
+            const auto pt = seq.point(i);
+            ++cells[static_cast<std::size_t>(pt[0] * 4) * 4 + static_cast<std::size_t>(pt[1] * 4)];
+        }
+        expect_true(std::all_of(cells.begin(), cells.end(), [](int c) { return c == 1; }));
+
+        // So does every dimension on its own, up to the last.
+        SobolSequence wide(SobolSequence::kMaxDims);
+        for (std::size_t d = 0; d < wide.dims(); ++d)
+        {
+            std::vector<int> bins(32, 0);
+            for (std::uint64_t i = 0; i < 32; ++i)
+                ++bins[static_cast<std::size_t>(wide.point(i)[d] * 32)];
+            expect_true(std::all_of(bins.begin(), bins.end(), [](int c) { return c == 1; }));
+        }
+
+        expect_true(rejects([] { SobolSequence s(0); }));
+        expect_true(rejects([] { SobolSequence s(SobolSequence::kMaxDims + 1); }));
+    }
+
+    test_that("the Ishigami indices are recovered, whatever the thread count")
+    {
+        // f = sin x1 + 7 sin^2 x2 + 0.1 x3^4 sin x1 on [-pi, pi]^3.
+        const double pi = 3.14159265358979323846;
+        SobolModel ishigami = [pi](const std::vector<double>& u) {
+            const double x1 = pi * (2 * u[0] - 1), x2 = pi * (2 * u[1] - 1),
+                         x3 = pi * (2 * u[2] - 1);
+            const double s2 = std::sin(x2);
+            return std::vector<double>{std::sin(x1) + 7 * s2 * s2 +
+                                       0.1 * std::pow(x3, 4) * std::sin(x1)};
+        };
+        int chunks = 0;
+        const auto one = sobolIndices(3, 1, 4096, ishigami, 1, 256, [&] { ++chunks; });
+        const auto many = sobolIndices(3, 1, 4096, ishigami, 3, 256);
+        expect_true(chunks == 16);
+        expect_true(one.samples(0) == 4096);
+
+        const double first[] = {0.3139, 0.4424, 0.0};
+        const double total[] = {0.5576, 0.4424, 0.2437};
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            expect_true(std::abs(one.first(j, 0) - first[j]) < 0.03);
+            expect_true(std::abs(one.total(j, 0) - total[j]) < 0.03);
+            expect_true(one.first(j, 0) == many.first(j, 0));
+            expect_true(one.total(j, 0) == many.total(j, 0));
+        }
+        expect_true(std::abs(one.mean(0) - 3.5) < 0.05);
+    }
+
+    test_that("parameter indices separate the factors that matter from those that do not")
+    {
+        Parameters p = trivialParams(60, 20);
+        const std::vector<SensitivityFactor> factors = {
+            {"layers.SC.D", 0.1, 10.0, true},
+            {"vehicle.c_init", 0.5, 2.0, false},
+            {"vehicle.app_area", 0.5, 2.0, false}};
+        const std::vector<SensitivityOutput> outputs = {
+            {SensitivityOutput::Kind::Permeated, 30.0}, {SensitivityOutput::Kind::QTotal, 0.0}};
+        expect_false(sensitivityError(p, factors, outputs).has_value());
+
+        const auto one  = parameterSensitivity(p, factors, outputs, 32, 1, 8);
+        const auto many = parameterSensitivity(p, factors, outputs, 32, 2, 8);
+        for (std::size_t o = 0; o < outputs.size(); ++o)
+        {
+            expect_true(one.samples(o) == 32);
+            expect_true(one.variance(o) > 0);
+            // D spans two decades and dominates; the area only rescales a
+            // per-area output.
+            expect_true(one.total(0, o) > 0.5);
+            expect_true(one.total(1, o) > 0.01);
+            expect_true(std::abs(one.total(2, o)) < 1e-6);
+            for (std::size_t j = 0; j < factors.size(); ++j)
+                expect_true(one.total(j, o) == many.total(j, o));
+        }
+    }
+
+    test_that("an analysis that cannot run is reported")
+    {
+        Parameters p = trivialParams(60, 20);
+        const std::vector<SensitivityOutput> q = {{SensitivityOutput::Kind::QTotal, 0.0}};
+        expect_true(sensitivityError(p, {{"layers.VE.D", 0.1, 1.0, false}}, q).has_value());
+        expect_true(sensitivityError(p, {{"layers.SC.D", 1.0, 1.0, false}}, q).has_value());
+        expect_true(sensitivityError(p, {{"layers.SC.D", -1.0, 1.0, true}}, q).has_value());
+        expect_true(sensitivityError(p, {{"layers.SC.D", -1.0, 1.0, false}}, q).has_value());
+        expect_true(sensitivityError(p, {{"layers.SC.D", 0.1, 1.0, false}},
+                                     {{SensitivityOutput::Kind::Permeated, 90.0}})
+                        .has_value());
+        expect_true(sensitivityError(p, {}, q).has_value());
+        expect_true(rejects([&] {
+            parameterSensitivity(p, {{"vehicle.nope", 0.1, 1.0, false}}, q, 4, 1, 4);
+        }));
+
+        expect_true(setParameter(p, "layers.SC.height", 12.6));
+        expect_true(p.layers[0].height == 13);
+        expect_true(setParameter(p, "sink.pk.CL", 0.2) && p.sink.pk.CL == 0.2);
+        expect_false(setParameter(p, "layers.SC.name", 1.0));
+        expect_false(setParameter(p, "sys.simulation_time", 10.0));
+    }
+}
+
+context("Virtual populations")
+{
+    test_that("t-digest quantiles are close and tight in the tails, merged or not")
+    {
+        std::uint64_t state = 12345;
+        auto next = [&state] {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<double>(state >> 11) * 0x1.0p-53;
+        };
+        std::vector<double> xs(100000);
+        for (auto& x : xs) x = std::exp(3.0 * next());
+
+        TDigest whole, left, right;
+        for (std::size_t i = 0; i < xs.size(); ++i)
+        {
+            whole.add(xs[i]);
+            (i % 3 == 0 ? left : right).add(xs[i]);
+        }
+        left.merge(right);
+        expect_true(whole.count() == 100000.0 && left.count() == 100000.0);
+        expect_true(whole.centroids() <= 100);
+
+        std::sort(xs.begin(), xs.end());
+        // Rank error: the fraction of values below the estimate, less q.
+        auto error = [&](double v, double q) {
+            return std::abs(static_cast<double>(std::lower_bound(xs.begin(), xs.end(), v) -
+                                                xs.begin()) / static_cast<double>(xs.size()) -
+                            q);
+        };
+        for (const double q : {0.001, 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99, 0.999})
+        {
+            const auto tol = q <= 0.01 || q >= 0.99 ? 1e-3 : 3e-3;
+            expect_true(error(whole.quantile(q), q) <= tol);
+            expect_true(error(left.quantile(q), q) <= tol);
+        }
+        expect_true(whole.quantile(0.0) == xs.front() && whole.quantile(1.0) == xs.back());
+
+        TDigest empty;
+        expect_true(std::isnan(empty.quantile(0.5)));
+        empty.add(std::nan(""));
+        expect_true(empty.count() == 0.0);
+    }
+
+    test_that("subjects are drawn reproducibly with the declared correlation")
+    {
+        const std::vector<PopulationFactor> factors = {
+            {"layers.SC.D", PopulationFactor::Dist::LogNormal, 0.0, 0.5},
+            {"layers.SC.K", PopulationFactor::Dist::Uniform, 0.5, 2.0},
+            {"vehicle.c_init", PopulationFactor::Dist::Normal, 1.0, 0.1}};
+        const std::vector<double> corr = {1.0, 0.8, 0.0, 0.8, 1.0, 0.0, 0.0, 0.0, 1.0};
+        const PopulationSampler sampler(factors, corr, 7);
+        expect_true(sampler.draw(42) == PopulationSampler(factors, corr, 7).draw(42));
+        expect_true(sampler.draw(42) != PopulationSampler(factors, corr, 8).draw(42));
+
+        const std::size_t n = 20000;
+        double s0 = 0, s1 = 0, s00 = 0, s11 = 0, s01 = 0, below = 0;
+        bool   in_range = true;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const auto x  = sampler.draw(i);
+            const auto z0 = std::log(x[0]);
+            s0 += z0; s1 += x[1]; s00 += z0 * z0; s11 += x[1] * x[1]; s01 += z0 * x[1];
+            in_range = in_range && x[1] > 0.5 && x[1] < 2.0;
+            below += x[2] < 1.0;
+        }
+        expect_true(in_range);
+        const auto m0 = s0 / n, m1 = s1 / n;
+        const auto r  = (s01 / n - m0 * m1) /
+                       std::sqrt((s00 / n - m0 * m0) * (s11 / n - m1 * m1));
+        expect_true(std::abs(m0) < 0.02);
+        expect_true(std::abs(std::sqrt(s00 / n - m0 * m0) - 0.5) < 0.02);
+        expect_true(std::abs(m1 - 1.25) < 0.02);
+        // Pearson on the uniform scale is a little below the normal one.
+        expect_true(r > 0.7 && r < 0.8);
+        expect_true(std::abs(below / n - 0.5) < 0.02);
+
+        bool threw = false;
+        try
+        {
+            PopulationSampler bad(factors, {1.0, 0.9, 0.9, 0.9, 1.0, -0.9, 0.9, -0.9, 1.0}, 1);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+        expect_true(threw);
+    }
+
+    test_that("population bands bracket the runs and do not depend on the thread count")
+    {
+        Parameters p = trivialParams(60, 20);
+        const std::vector<PopulationFactor> factors = {
+            {"layers.SC.D", PopulationFactor::Dist::LogUniform, 0.2, 5.0}};
+        const std::vector<PopulationSeries> series = {
+            {PopulationSeries::Kind::Permeated, ""},
+            {PopulationSeries::Kind::Compartment, "SC"}};
+        const std::vector<double> times = {0.0, 30.0, 60.0};
+        int chunks = 0;
+        const auto one  = simulatePopulation(p, factors, {}, series, times, 40, 3, 1, 16, 100.0,
+                                             [&] { ++chunks; });
+        const auto many = simulatePopulation(p, factors, {}, series, times, 40, 3, 3, 16);
+        expect_true(chunks == 3);
+        expect_true(one.subjects == 40 && one.failed == 0);
+        expect_true(one.sketches.size() == 6);
+
+        // Permeation rises with D, so its quantiles are those of the
+        // runs at the quantiles of D.
+        const PopulationSampler sampler(factors, {}, 3);
+        std::vector<double> d;
+        for (std::size_t i = 0; i < 40; ++i) d.push_back(sampler.draw(i)[0]);
+        std::sort(d.begin(), d.end());
+        Parameters lo = p, hi = p;
+        lo.layers[0].D = d.front();
+        hi.layers[0].D = d.back();
+        System slow(lo), fast(hi);
+        slow.run();
+        fast.run();
+        expect_true(std::abs(one.at(0, 2).quantile(0.0) - slow.sinkMass().at(60.0)) <= 1e-12);
+        expect_true(std::abs(one.at(0, 2).quantile(1.0) - fast.sinkMass().at(60.0)) <= 1e-12);
+        expect_true(one.at(0, 0).quantile(0.5) == 0.0);
+        expect_true(one.at(1, 1).quantile(0.05) < one.at(1, 1).quantile(0.95));
+
+        for (std::size_t c = 0; c < one.sketches.size(); ++c)
+        {
+            for (const double q : {0.05, 0.5, 0.95})
+                expect_true(one.sketches[c].quantile(q) == many.sketches[c].quantile(q));
+        }
+    }
+
+    test_that("a population that cannot run is reported")
+    {
+        Parameters p = trivialParams(60, 20);
+        const std::vector<PopulationFactor> d = {
+            {"layers.SC.D", PopulationFactor::Dist::LogNormal, 0.0, 0.3}};
+        const std::vector<PopulationSeries> q = {{PopulationSeries::Kind::Permeated, ""}};
+        expect_false(populationError(p, d, {}, q, {60.0}).has_value());
+        expect_true(populationError(p, d, {}, q, {61.0}).has_value());
+        expect_true(populationError(p, d, {1.0, 0.0}, q, {60.0}).has_value());
+        expect_true(populationError(p, d, {}, {{PopulationSeries::Kind::Plasma, ""}}, {60.0})
+                        .has_value());
+        expect_true(populationError(p, d, {}, {{PopulationSeries::Kind::Compartment, "VE"}},
+                                    {60.0})
+                        .has_value());
+        expect_true(populationError(
+                        p, {{"layers.SC.D", PopulationFactor::Dist::LogUniform, -1.0, 1.0}}, {},
+                        q, {60.0})
+                        .has_value());
+        expect_true(
+            populationError(p, {{"layers.SC.D", PopulationFactor::Dist::Normal, 1.0, 0.0}}, {},
+                            q, {60.0})
+                .has_value());
+        expect_true(populationError(p, {{"sys.resolution", PopulationFactor::Dist::Normal, 1.0,
+                                         0.1}},
+                                    {}, q, {60.0})
+                        .has_value());
+    }
+}
+
+context("Periodic steady state")
+{
+    test_that("the GMRES periodic state matches many repeated periods")
+    {
+        const int period = 120, n_periods = 160;
+        Parameters p = trivialParams(period * n_periods, 20);
+        p.vehicle.replace_after = period;
+        p.layers[0].D = 0.05;
+        p.layers[0].K = 2.0;
+        System brute(p);
+        brute.run();
+        const auto& sink = brute.sinkMass().values;
+        const auto  at   = static_cast<std::size_t>(period * (n_periods - 1));
+        const auto  flux = sink.back() - sink[at];
+        const auto  skin = brute.compartmentMass()[1].values[at];
+
+        p.sys.simulation_time = period;
+        p.sys.periodic_tol    = 1e-10;
+        System pss(p);
+        expect_true(pss.run() == System::Result::Executed);
+        expect_true(pss.periodicPeriods() > 0 && pss.periodicPeriods() < 20);
+        expect_true(pss.periodicResidual() < 1e-8);
+        expect_true(std::abs(pss.periodicFlux() - flux) <= 1e-7 * flux);
+        expect_true(std::abs(pss.compartmentMass()[1].values.front() - skin) <= 1e-7 * skin);
+        const auto logged = pss.sinkMass().values.back() - pss.sinkMass().values.front();
+        expect_true(std::abs(logged - pss.periodicFlux()) <= 1e-12 * flux);
+    }
+}
+
+context("Systemic PK")
+{
+    test_that("plasma follows a two-compartment model driven by the sink")
+    {
+        Parameters p = trivialParams(1500, 20);
+        p.layers[0].D   = 0.5;
+        p.sink.pk.enabled = true;
+        p.sink.pk.V1  = 50.0;
+        p.sink.pk.CL  = 0.5;
+        p.sink.pk.k12 = 0.02;
+        p.sink.pk.k21 = 0.005;
+        System sys(p);
+        expect_true(sys.run() == System::Result::Executed);
+        const auto& sink   = sys.sinkMass().values;
+        const auto& plasma = sys.plasma().values;
+        expect_true(plasma.size() == sink.size());
+
+        // RK4 on the compartments, with the sink's per-minute gain as a
+        // constant input over each minute.
+        const auto ke = p.sink.pk.CL / p.sink.pk.V1;
+        const auto k12 = p.sink.pk.k12, k21 = p.sink.pk.k21;
+        const int  m  = 100;
+        const auto h  = 1.0 / m;
+        double c = 0.0, q = 0.0, err = 0.0, peak = 0.0;
+        for (std::size_t n = 1; n < sink.size(); ++n)
+        {
+            const auto J = sink[n] - sink[n - 1];
+            auto rate = [&](double c_, double q_, double& dc, double& dq) {
+                dc = J - (ke + k12) * c_ + k21 * q_;
+                dq = k12 * c_ - k21 * q_;
+            };
+            for (int k = 0; k < m; ++k)
+            {
+                double c1, q1, c2, q2, c3, q3, c4, q4;
+                rate(c, q, c1, q1);
+                rate(c + h / 2 * c1, q + h / 2 * q1, c2, q2);
+                rate(c + h / 2 * c2, q + h / 2 * q2, c3, q3);
+                rate(c + h * c3, q + h * q3, c4, q4);
+                c += h / 6 * (c1 + 2 * c2 + 2 * c3 + c4);
+                q += h / 6 * (q1 + 2 * q2 + 2 * q3 + q4);
+            }
+            peak = std::max(peak, c / p.sink.pk.V1);
+            err  = std::max(err, std::abs(c / p.sink.pk.V1 - plasma[n]));
+        }
+        expect_true(peak > 0.0);
+        expect_true(err <= 1e-4 * peak);
+    }
+
+    test_that("the sink's initial mass is eliminated at CL / V1")
+    {
+        Parameters p = trivialParams(600);
+        p.vehicle.c_init  = 0.0;
+        p.sink.c_init     = 2.0;
+        p.sink.Vd         = 3.0;
+        p.sink.pk.enabled = true;
+        p.sink.pk.V1      = 50.0;
+        p.sink.pk.CL      = 0.5;
+        System sys(p);
+        sys.run();
+        const auto& plasma = sys.plasma().values;
+        expect_true(std::abs(plasma.front() - 6.0 / 50.0) <= 1e-12);
+        const auto exact = 6.0 / 50.0 * std::exp(-0.01 * 600.0);
+        expect_true(std::abs(plasma.back() - exact) <= 1e-4 * exact);
+    }
+}
+
+context("Stop conditions")
+{
+    test_that("permeated-fraction stop ends the run at the crossing")
+    {
+        Parameters p = trivialParams(600);
+        System full(p);
+        full.run();
+        const auto dose = full.compartmentMass()[0].values.front();
+        const auto& sink = full.sinkMass();
+
+        p.stop.push_back(StopCondition{StopKind::PermeatedFraction, 0.2});
+        System sys(p);
+        expect_true(sys.run() == System::Result::Executed);
+        expect_true(sys.stopIndex() == 0);
+
+        // Bracket in the per-minute reference series.
+        std::size_t k = 0;
+        while (k < sink.values.size() && sink.values[k] < 0.2 * dose) ++k;
+        expect_true(k > 0 && k < sink.values.size());
+        expect_true(sys.stopTime() > sink.times[k - 1]);
+        expect_true(sys.stopTime() <= sink.times[k]);
+
+        // The final logged point sits at the crossing, on the threshold.
+        const auto& s = sys.sinkMass();
+        expect_true(s.times.back() == sys.stopTime());
+        expect_true(std::abs(s.values.back() - 0.2 * dose) <= 1e-4 * dose);
+        expect_true(sys.compartmentMass()[0].times.back() == sys.stopTime());
+    }
+
+    test_that("donor-fraction stop picks the earliest of several conditions")
+    {
+        Parameters p = trivialParams(600);
+        p.stop.push_back(StopCondition{StopKind::PermeatedFraction, 0.9});
+        p.stop.push_back(StopCondition{StopKind::DonorFractionBelow, 0.7});
+        System sys(p);
+        sys.run();
+        expect_true(sys.stopIndex() == 1);
+        const auto& donor = sys.compartmentMass()[0];
+        expect_true(std::abs(donor.values.back() - 0.7 * donor.values.front()) <=
+                    1e-4 * donor.values.front());
+        expect_true(sys.stopTime() < 600.0);
+    }
+
+    test_that("unmet conditions let the run finish")
+    {
+        Parameters p = trivialParams(60);
+        p.stop.push_back(StopCondition{StopKind::ReceptorConcAbove, 1e6});
+        System sys(p);
+        expect_true(sys.run() == System::Result::Executed);
+        expect_true(sys.stopTime() < 0.0);
+        expect_true(sys.sinkMass().times.back() == 60.0);
+    }
+
+    test_that("a receptor concentration stop is rejected with a PK sink")
+    {
+        Parameters p = trivialParams(60);
+        p.stop.push_back(StopCondition{StopKind::ReceptorConcAbove, 0.1});
+        expect_false(validate(p).has_value());
+        p.sink.pk.enabled = true;
+        p.sink.pk.V1      = 50.0;
+        expect_true(validate(p).has_value());
+        p.stop[0].kind = StopKind::PermeatedFraction;
+        expect_false(validate(p).has_value());
+    }
+
+    test_that("stop conditions also apply during steady-state fast-forward")
+    {
+        Parameters p = trivialParams(6000);
+        p.vehicle.finite_dose  = false;
+        p.sys.steady_state_tol = 1e-9;
+        p.stop.push_back(StopCondition{StopKind::PermeatedFraction, 2.0});
+        System sys(p);
+        sys.run();
+        const auto dose = sys.compartmentMass()[0].values.front();
+        expect_true(sys.steadyStateTime() > 0);
+        expect_true(sys.stopTime() > sys.steadyStateTime());
+        expect_true(std::abs(sys.sinkMass().values.back() - 2.0 * dose) <= 1e-6 * dose);
+    }
+}
+
+context("Reduced-order model")
+{
+    test_that("reduced runs match the stepped run for finite and infinite dose")
+    {
+        for (const bool finite : {true, false})
+        {
+            Parameters p = trivialParams(600);
+            p.vehicle.finite_dose = finite;
+            System full(p);
+            full.run();
+            expect_true(full.reducedOrder() < 0);
+
+            p.sys.reduced_order = 20;
+            System rom(p);
+            expect_true(rom.run() == System::Result::Executed);
+            expect_true(rom.reducedOrder() > 0);
+            expect_true(rom.reducedOrder() <= 20);
+            expect_true(rom.reducedErrorEstimate() >= 0.0);
+
+            const auto& a = full.sinkMass();
+            const auto& b = rom.sinkMass();
+            expect_true(a.times == b.times);
+            double err = 0.0;
+            for (std::size_t i = 0; i < a.values.size(); ++i)
+                err = std::max(err, std::abs(a.values[i] - b.values[i]));
+            expect_true(err <= 1e-4 * a.values.back());
+
+            const auto& ma = full.compartmentMass()[1].values;
+            const auto& mb = rom.compartmentMass()[1].values;
+            expect_true(ma.size() == mb.size());
+            expect_true(std::abs(ma.back() - mb.back()) <= 1e-4 * std::abs(ma.back()));
+        }
+    }
+}
+
+context("Brick-and-mortar layer")
+{
+    test_that("bricks with the mortar's D and K reproduce the 1-D layer")
+    {
+        Parameters p = trivialParams(300, 15);
+        p.layers[0].K = 2.0;
+        LayerParams dsl;
+        dsl.name          = "DSL";
+        dsl.height        = 40;
+        dsl.D             = 5.0;
+        dsl.K             = 0.5;
+        dsl.cross_section = 0.8;
+        p.layers.push_back(dsl);
+
+        for (const auto finite : {true, false})
+        {
+            p.vehicle.finite_dose = finite;
+            p.layers[0].brick     = BrickParams{};
+            System flat(p);
+            flat.run();
+
+            p.layers[0].brick.enabled = true;
+            p.layers[0].brick.D_brick = p.layers[0].D;
+            p.layers[0].brick.K_brick = p.layers[0].K;
+            System brick(p);
+            expect_true(brick.run() == System::Result::Executed);
+            expect_true(brick.brickLayer() != nullptr);
+            expect_true(brick.brickLayerIndex() == 1);
+
+            const auto a = flat.sinkMass().values.back();
+            const auto b = brick.sinkMass().values.back();
+            expect_true(std::abs(a - b) <= 1e-3 * a);
+        }
+    }
+
+    test_that("a heterogeneous brick layer conserves mass and slows permeation")
+    {
+        Parameters p = trivialParams(300, 15);
+        System flat(p);
+        flat.run();
+
+        p.layers[0].brick.enabled = true;
+        p.layers[0].brick.D_brick = 0.05;
+        p.layers[0].brick.K_brick = 0.5;
+        System brick(p);
+        expect_true(brick.run() == System::Result::Executed);
+
+        const auto& m  = brick.compartmentMass();
+        const auto& sm = brick.sinkMass();
+        const auto total0 = m[0].values.front() + m[1].values.front() + sm.values.front();
+        const auto total1 = m[0].values.back() + m[1].values.back() + sm.values.back();
+        expect_true(std::abs(total1 - total0) <= 1e-10 * total0);
+        expect_true(m[1].values.back() > 0.0);
+        expect_true(sm.values.back() < 0.5 * flat.sinkMass().values.back());
+    }
+
+    test_that("parallel line sweeps match the serial ones")
+    {
+        Parameters p = trivialParams(3, 10);
+        p.layers[0].brick.enabled       = true;
+        p.layers[0].brick.D_brick       = 0.05;
+        p.layers[0].brick.lateral_cells = 100;
+        p.layers[0].brick.mortar_cells  = 4;
+        p.sys.n_threads = 1;
+        System serial(p);
+        serial.run();
+        expect_true(serial.brickLayer()->rows() * serial.brickLayer()->cols() >= 2 * 4096);
+
+        p.sys.n_threads = 3;
+        System par(p);
+        par.run();
+        expect_true(serial.brickLayer()->concentrations() == par.brickLayer()->concentrations());
+        expect_true(serial.sinkMass().values == par.sinkMass().values);
+    }
+}
+
+context("Parallel pathways")
+{
+    test_that("a pathway copying the main stack matches one stack of twice the area")
+    {
+        for (const auto mode : {0, 1, 2})
+        {
+            Parameters p = trivialParams(240, 15);
+            p.vehicle.finite_dose = mode != 1;
+            p.vehicle.lumped      = mode == 2;
+            p.layers[0].K = 2.0;
+            System single(p);
+            single.run();
+
+            p.layers[0].cross_section = 0.5;
+            PathwayParams shunt;
+            shunt.name = "Follicle";
+            shunt.layers.push_back(p.layers[0]);
+            shunt.layers[0].name = "Follicle SC";
+            p.pathways.push_back(shunt);
+            System split(p);
+            expect_true(split.run() == System::Result::Executed);
+            expect_false(split.pathways().empty());
+            expect_true(split.compartmentNames().back() == "Follicle SC");
+
+            // Exact unless the vehicle has a resistance of its own: the
+            // main stack's top face sees the full vehicle area.
+            const auto tol = mode == 0 ? 1e-2 : 1e-9;
+            const auto a = single.sinkMass().values.back();
+            const auto b = split.sinkMass().values.back();
+            expect_true(std::abs(a - b) <= tol * a);
+            const auto& m = split.compartmentMass();
+            const auto sc = single.compartmentMass()[1].values.back();
+            expect_true(std::abs(m[1].values.back() + m[2].values.back() - sc) <= tol * sc);
+        }
+    }
+
+    test_that("a heterogeneous shunt conserves mass and speeds up permeation")
+    {
+        Parameters p = trivialParams(300, 15);
+        p.layers[0].D = 0.1;
+        System single(p);
+        single.run();
+
+        PathwayParams shunt;
+        shunt.name = "Follicle";
+        for (const auto& [name, D, K] : {std::tuple{"Sebum", 5.0, 3.0},
+                                         std::tuple{"Follicle wall", 1.0, 0.5}})
+        {
+            LayerParams l;
+            l.name          = name;
+            l.height        = 10;
+            l.D             = D;
+            l.K             = K;
+            l.cross_section = 0.01;
+            shunt.layers.push_back(l);
+        }
+        p.pathways.push_back(shunt);
+        System split(p);
+        expect_true(split.run() == System::Result::Executed);
+
+        const auto& m  = split.compartmentMass();
+        const auto& sm = split.sinkMass();
+        expect_true(m.size() == 4);
+        double total0 = sm.values.front(), total1 = sm.values.back();
+        for (const auto& s : m)
+        {
+            total0 += s.values.front();
+            total1 += s.values.back();
+        }
+        expect_true(std::abs(total1 - total0) <= 1e-10 * total0);
+        expect_true(m[3].values.back() > 0.0);
+        expect_true(sm.values.back() > 1.2 * single.sinkMass().values.back());
+    }
+}
+
 context("Parameter validation")
 {
     test_that("default Parameters is valid (no layers, single vehicle)")
@@ -172,6 +1876,17 @@ context("Parameter validation")
         expect_false(static_cast<bool>(validate(p)));
     }
 
+    test_that("the steady-state detector is rejected in reduced-order runs")
+    {
+        Parameters p = trivialParams(600);
+        p.vehicle.finite_dose  = false;
+        p.sys.steady_state_tol = 1e-9;
+        expect_false(validate(p).has_value());
+        p.sys.reduced_order = 12;
+        const auto err = validate(p);
+        expect_true(err.has_value() && err->find("sys.reduced_order") != std::string::npos);
+    }
+
     test_that("removing the vehicle without any layer is rejected")
     {
         Parameters p;
@@ -190,4 +1905,132 @@ context("Parameter validation")
         const auto err = validate(p);
         expect_true(static_cast<bool>(err));
     }
+
+    test_that("a lumped vehicle without any layer is rejected")
+    {
+        Parameters p;
+        p.vehicle.lumped = true;
+        const auto err = validate(p);
+        expect_true(static_cast<bool>(err));
+    }
+
+    test_that("pathways with duplicate names or stop conditions are rejected")
+    {
+        Parameters p = trivialParams(600);
+        PathwayParams shunt;
+        shunt.name = "Follicle";
+        shunt.layers.push_back(p.layers[0]);
+        p.pathways.push_back(shunt);
+        expect_true(static_cast<bool>(validate(p)));
+        p.pathways[0].layers[0].name = "Follicle SC";
+        expect_false(static_cast<bool>(validate(p)));
+        p.stop.push_back(StopCondition{});
+        expect_true(static_cast<bool>(validate(p)));
+    }
+
+    test_that("a reduced-order model with donor events is rejected")
+    {
+        Parameters p = trivialParams(600);
+        p.sys.reduced_order = 10;
+        expect_false(static_cast<bool>(validate(p)));
+        p.vehicle.remove_at = 60;
+        expect_true(static_cast<bool>(validate(p)));
+    }
+
+    test_that("brick layers reject bad geometry, a second brick layer and donor events")
+    {
+        Parameters p = trivialParams(60, 10);
+        p.layers[0].brick.enabled = true;
+        expect_false(static_cast<bool>(validate(p)));
+
+        auto q = p;
+        q.layers[0].brick.width = 0.05;   // narrower than the mortar gap
+        expect_true(static_cast<bool>(validate(q)));
+
+        q = p;
+        q.layers[0].brick.thickness = 9.9;
+        expect_true(static_cast<bool>(validate(q)));
+
+        q = p;
+        q.layers.push_back(p.layers[0]);
+        expect_true(static_cast<bool>(validate(q)));
+
+        q = p;
+        q.vehicle.replace_after = 30;
+        expect_true(static_cast<bool>(validate(q)));
+    }
+
+    test_that("mixed precision rejects fused sweeps and the active window")
+    {
+        Parameters p = trivialParams(60);
+        p.sys.mixed_precision = true;
+        expect_false(static_cast<bool>(validate(p)));
+        auto q = p;
+        q.sys.fused_sweeps = true;
+        expect_true(static_cast<bool>(validate(q)));
+        q = p;
+        q.sys.active_window_tol = 1e-14;
+        expect_true(static_cast<bool>(validate(q)));
+    }
+
+    test_that("the periodic solver needs a replaced vehicle and no removal")
+    {
+        Parameters p = trivialParams(600);
+        p.sys.periodic_tol = 1e-8;
+        expect_true(static_cast<bool>(validate(p)));
+        p.vehicle.replace_after = 120;
+        expect_false(static_cast<bool>(validate(p)));
+        p.vehicle.remove_at = 300;
+        expect_true(static_cast<bool>(validate(p)));
+    }
+
+    test_that("donor-fraction stop outside (0, 1) is rejected")
+    {
+        Parameters p;
+        p.stop.push_back(StopCondition{StopKind::DonorFractionBelow, 1.0});
+        const auto err = validate(p);
+        expect_true(static_cast<bool>(err));
+    }
+}
+
+context("C-callable API")
+{
+    test_that("a System run through the callables matches a direct run")
+    {
+        expect_true(skindiff_api_version() == SKINDIFF_API_VERSION);
+
+        Parameters p = trivialParams(120);
+        System direct(p);
+        direct.run();
+
+        char error[128] = {};
+        auto* sys = skindiff_system_new(&p, nullptr, nullptr, error, sizeof(error));
+        expect_true(sys != nullptr);
+        expect_true(skindiff_system_run(sys, error, sizeof(error)) ==
+                    static_cast<int>(System::Result::Executed));
+        expect_true(sys->sinkMass().values == direct.sinkMass().values);
+        skindiff_system_delete(sys);
+    }
+
+    test_that("the stop hook ends the run and invalid parameters are reported")
+    {
+        Parameters p = trivialParams(120);
+        int last = 0;
+        auto hook = [](int t, void* data) {
+            *static_cast<int*>(data) = t;
+            return t >= 30;
+        };
+        char error[128] = {};
+        auto* sys = skindiff_system_new(&p, hook, &last, error, sizeof(error));
+        expect_true(skindiff_system_run(sys, error, sizeof(error)) ==
+                    static_cast<int>(System::Result::Stopped));
+        expect_true(last == 30);
+        skindiff_system_delete(sys);
+
+        p.sys.simulation_time = 0;
+        char small[8] = {};
+        expect_true(skindiff_system_new(&p, nullptr, nullptr, small, sizeof(small)) == nullptr);
+        expect_false(skindiff_validate(&p, small, sizeof(small)));
+        expect_true(std::string(small) == std::string("sys.sim"));
+    }
 }
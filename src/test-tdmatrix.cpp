@@ -1,9 +1,11 @@
 #include "algorithms.h"
+#include "cnoperator.h"
 #include "tdmatrix.h"
 
 #include <testthat.h>
 
 #include <cmath>
+#include <utility>
 #include <vector>
 
 using namespace sc;
@@ -151,3 +153,103 @@ context("Thomas solver")
         }
     }
 }
+
+context("Fused Crank-Nicolson sub-steps")
+{
+    // A CN pair (2 -/+ A) for a non-symmetric A, so the LU and UL sweeps
+    // see different coefficients.
+    auto pair = [](int n) {
+        TDMatrix rhs(n), lhs(n);
+        for (int i = 0; i < n; ++i)
+        {
+            const double d = 1.0 + 0.1 * (i % 7);
+            rhs.diag(i) = 2.0 - d;
+            lhs.diag(i) = 2.0 + d;
+        }
+        for (int i = 0; i < n - 1; ++i)
+        {
+            const double l = 0.4 + 0.05 * (i % 3);
+            const double u = 0.3 + 0.02 * (i % 5);
+            rhs.lower(i) = l;   lhs.lower(i) = -l;
+            rhs.upper(i) = u;   lhs.upper(i) = -u;
+        }
+        return std::make_pair(rhs, lhs);
+    };
+
+    test_that("alternating LU / UL sweeps match repeated single steps")
+    {
+        for (const int n_steps : {1, 2, 3, 8})
+        {
+            auto [rhs, lhs] = pair(40);
+            TDMatrix ul = lhs;
+            algorithm::prepareThomasUL(ul);
+            algorithm::prepareThomas(lhs);
+            expect_true(ul.isPreparedUL() && !ul.isPrepared());
+
+            std::vector<double> ref(40), fused(40);
+            for (std::size_t i = 0; i < ref.size(); ++i)
+            {
+                ref[i] = fused[i] = std::sin(0.3 * static_cast<double>(i)) + 1.0;
+            }
+            for (int k = 0; k < n_steps; ++k)
+            {
+                algorithm::crankNicolsonStepIP(rhs, static_cast<const TDMatrix&>(lhs), ref);
+            }
+            algorithm::crankNicolsonStepsIP(rhs, lhs, ul, fused, n_steps);
+            for (std::size_t i = 0; i < ref.size(); ++i)
+            {
+                expect_true(approxEqual(fused[i], ref[i], 1e-13));
+            }
+        }
+    }
+
+    test_that("the packed operator matches the band kernels")
+    {
+        auto [rhs, lhs] = pair(40);
+        CnOperator op;
+        op.build(rhs, lhs, true);
+        TDMatrix lu = lhs;
+        algorithm::prepareThomas(lu);
+        expect_true(op.size() == 40 && op.hasUL());
+
+        auto start = [] {
+            std::vector<double> v(40);
+            for (std::size_t i = 0; i < v.size(); ++i)
+            {
+                v[i] = std::cos(0.2 * static_cast<double>(i)) + 1.5;
+            }
+            return v;
+        };
+        for (const int n_steps : {1, 2, 5})
+        {
+            auto ref = start(), packed = start();
+            for (int k = 0; k < n_steps; ++k)
+            {
+                algorithm::crankNicolsonStepIP(rhs, static_cast<const TDMatrix&>(lu), ref);
+            }
+            op.steps(packed, n_steps);
+            for (std::size_t i = 0; i < ref.size(); ++i)
+            {
+                expect_true(approxEqual(packed[i], ref[i], 1e-13));
+            }
+        }
+
+        // A window below identity rows, as for a clamped donor.
+        for (int i = 0; i < 5; ++i)
+        {
+            rhs.diag(i) = lhs.diag(i) = 2.0;
+            if (i > 0) rhs.lower(i - 1) = lhs.lower(i - 1) = 0.0;
+            rhs.upper(i) = lhs.upper(i) = 0.0;
+        }
+        op.build(rhs, lhs);
+        lu = lhs;
+        algorithm::prepareThomas(lu);
+        auto ref = start(), packed = start();
+        algorithm::crankNicolsonStepIP(rhs, static_cast<const TDMatrix&>(lu), ref, 5, 30);
+        op.step(packed, 5, 30);
+        for (std::size_t i = 0; i < ref.size(); ++i)
+        {
+            expect_true(approxEqual(packed[i], ref[i], 1e-13));
+        }
+    }
+}